@@ -51,7 +51,7 @@ BasicWayFeatureFactory::BasicWayFeatureFactory(const OSMDatabase& db): m_db(db),
 
 const std::string BasicWayFeatureFactory::s_noname("<noname>");
 
-const std::string& BasicWayFeatureFactory::name(const OSMWay& w) const
+std::string BasicWayFeatureFactory::name(const OSMWay& w) const
 {
 	unsigned val=-1U;
 	if ((val = w.getValueForKey(m_kiNameEn)) != -1U)
@@ -59,7 +59,7 @@ const std::string& BasicWayFeatureFactory::name(const OSMWay& w) const
 	else if ((val = w.getValueForKey(m_kiName)) != -1U)
 		{}
 
-	return val == -1U ? s_noname : m_db.wayTags().getValue(val);
+	return val == -1U ? s_noname : m_db.wayTags().getValue(val).to_string();
 }
 
 boost::optional<Feature> BasicWayFeatureFactory::operator()(const OSMWay& w) const
@@ -161,7 +161,7 @@ boost::optional<Feature> BasicWayFeatureFactory::operator()(const OSMWay& w) con
 	if (type == Unknown)
 		return boost::optional<Feature>();
 
-	std::vector<LatLon> pts = m_db.extractPoly(w);
+	std::vector<FixedLatLon> pts = m_db.extractFixedPoly(w);
 
 	Feature f(w.id(),OSMEntityType::Way,type,std::move(n),std::move(pts));
 
@@ -23,7 +23,7 @@ public:
 
 private:
 	const OSMDatabase& m_db;
-	const std::string& name(const OSMWay& w) const;
+	std::string name(const OSMWay& w) const;
 
 	static const std::string s_noname;
 
@@ -13,13 +13,11 @@
 
 
 #include <boost/iostreams/filtering_streambuf.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
 
-#ifndef NO_BZIP2
-#include <boost/iostreams/filter/bzip2.hpp>
-#endif
+#include <memory>
 
-#include <fstream>
+#include "InputFormat.hpp"
+#include "ReadAheadSource.hpp"
 
 template<class BoostInputStreamType>class BoostInputStream : public xercesc::BinInputStream
 {
@@ -59,67 +57,43 @@ private:
 	BoostInputStreamType 	m_inputStream;
 };
 
-class BoostFilteredFileStream : public BoostInputStream<boost::iostreams::filtering_streambuf<boost::iostreams::input>>
-{
-public:
-	BoostFilteredFileStream(){}
-	virtual ~BoostFilteredFileStream(){}
-
-	template<typename T>void push(T&& filter)
-	{
-		stream().push(filter);
-	}
-
-	void open(const std::string fn)
-	{
-		m_is.open(fn.c_str(),std::ios_base::in | std::ios_base::binary);
-		if (!m_is.good())
-			throw std::ios_base::failure("File does not exist in CompressedFileInputSource");
-		stream().push(m_is);
-	}
-
-private:
-	std::ifstream 			m_is;
-};
-
-
+/** Xerces input source for plain or compressed (gzip, bzip2, zstd, xz, lz4) .osm files; the compression is detected
+ * from the file's leading bytes.
+ *
+ * With nThreads != 1, gzip & bzip2 decompression runs on a ParallelDecompressor worker pool (nThreads=0 -> hardware
+ * concurrency), everything else through a single-threaded Boost.Iostreams filter chain (see DecompressingReader).
+ *
+ * Unless disabled with readAhead(false), reading & decompression run on a producer thread which fills a ring of large
+ * buffers (ReadAheadSource) while Xerces parses, so the stages overlap. stats() shows which side had to wait.
+ */
 
 class CompressedFileInputSource : public xercesc::InputSource {
 public:
-	CompressedFileInputSource(const std::string fn) : m_fn(fn) {}
+	CompressedFileInputSource(const std::string fn,unsigned nThreads=0) : m_fn(fn),m_nThreads(nThreads) {}
 
 	virtual 	~CompressedFileInputSource (){}
 
 	virtual xercesc::BinInputStream* 	makeStream () const
 	{
-		// create the streambuf
-		auto sb = new BoostFilteredFileStream();
-
-		std::size_t pos = m_fn.find_last_of('.');
-		std::string sfx;
-
-		if (pos == std::string::npos)
-			throw std::logic_error("Invalid file extension in CompressedFileInputSource::makeStream");
-		else
-			sfx = m_fn.substr(pos+1,-1U);
-
-		// set up the filtering streambuf for reading
-		if (sfx == "gz")
-			sb->push(boost::iostreams::gzip_decompressor());
-#ifndef NO_BZIP2
-		else if (sfx == "bz2")
-			sb->push(boost::iostreams::bzip2_decompressor());
-#endif
-		else
-		{
-			delete sb;
-			throw std::logic_error("Invalid file extension in CompressedFileInputSource::makeStream");
-		}
+		std::unique_ptr<xercesc::BinInputStream> up(makeUpstream());
+
+		if (!m_readAhead)
+			return up.release();
+
+		std::shared_ptr<xercesc::BinInputStream> sp(up.release());
+		return new BoostInputStream<ReadAheadSource>(ReadAheadSource(
+				[sp](char* s,std::streamsize n)
+				{
+					XMLSize_t N = sp->readBytes(reinterpret_cast<XMLByte*>(s),n);
+					return N == 0 && n > 0 ? std::streamsize(-1) : std::streamsize(N);
+				},
+				m_stats));
+	}
 
-		sb->open(m_fn);
+	void readAhead(bool e){ m_readAhead=e; }
 
-		return sb;
-	}
+	/// Buffer stall counters for the read-ahead stage (all zero if read-ahead is disabled)
+	const ReadAheadStats& stats() const { return *m_stats; }
 
 	//virtual const XMLCh * 	getEncoding () const
 	//virtual const XMLCh * 	getPublicId () const
@@ -132,7 +106,21 @@ public:
 	//virtual void 	setIssueFatalErrorIfNotFound (const bool flag)
 
 private:
+	/// Creates the stream which reads & decompresses the file synchronously
+	xercesc::BinInputStream* makeUpstream() const
+	{
+		return new BoostInputStream<DecompressingReaderSource>(
+				DecompressingReaderSource(std::make_shared<DecompressingReader>(
+						m_fn,
+						detectInputFormat(m_fn).compression,
+						m_nThreads)));
+	}
+
 	std::string 	m_fn;
+	unsigned 		m_nThreads=0;
+	bool 			m_readAhead=true;
+
+	std::shared_ptr<ReadAheadStats> m_stats=std::make_shared<ReadAheadStats>();
 };
 
 
@@ -0,0 +1,118 @@
+/*
+ * ExtractFeatures.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "ExtractFeatures.hpp"
+
+#include "OSMDatabase.hpp"
+#include "NodePOIFilter.hpp"
+#include "MultipolyCloser.hpp"
+#include "BasicWayFeatureFactory.hpp"
+#include "BasicRelationFeatureFactory.hpp"
+
+#include <iostream>
+#include <utility>
+
+using namespace std;
+
+std::vector<POI> extractPOIs(const OSMDatabase& db)
+{
+	NodePOIFilter poiFilt(db.nodeTags());
+
+	std::vector<POI> pois;
+
+	for(const auto n : db.nodes())
+	{
+		auto optPOI = poiFilt(n);
+		if (optPOI)
+			pois.push_back(*optPOI);
+	}
+
+	return pois;
+}
+
+std::vector<Feature> extractFeatures(const OSMDatabase& db)
+{
+	bool mapIsIsland=true;
+
+	cout << "INFO: Starting on assumption that map is an island" << endl;
+
+	vector<Feature> features;
+	BasicWayFeatureFactory WF(db);
+	for(const auto& w : db.ways())
+	{
+		auto feat = WF(w);
+
+		if (feat)
+			features.emplace_back(std::move(*feat));
+	}
+
+	BasicRelationFeatureFactory FF(db);
+	for(const auto& r : db.relations())
+	{
+		// call the factory
+		auto feats = FF(r);
+		for(const auto f : feats)
+		{
+			cout << "  Created feature (" << asString(f.type()) << ") from relation ID " << r.id() << endl;
+
+			if (!f.bounded() && f.isWater())
+			{
+				mapIsIsland=false;
+				cout << "INFO: Found an unbounded water feature, so we conclude this is not an island" << endl;
+			}
+			features.emplace_back(std::move(f));
+		}
+	}
+
+
+
+	vector<const OSMWay*> coastline;
+	unsigned m_kiNatural=db.wayTags().getIndexForKeyString("natural");
+	unsigned m_viCoastline=db.wayTags().getIndexForValueString("coastline");
+
+
+	// extract coastlines
+	for(const auto& w : db.ways())
+		if (w.hasTagWithValue(m_kiNatural,m_viCoastline))
+			coastline.push_back(&w);
+
+	cout << "Extracted " << coastline.size() << " ways with coastline tag" << endl;
+
+	MultipolyCloser C(db,coastline);
+	C.direction(MultipolyCloser::CCW);
+	vector<pair<vector<LatLon>,bool>> F = C.loops(MultipolyCloser::All);
+
+	mapIsIsland &= coastline.size()>0;
+
+	for(const auto& poly : F)
+		mapIsIsland &= poly.second;		// if none of the coastlines is unbounded, then we're looking at an island
+
+	if (F.size() == 0)
+	{
+		cout << "INFO: No coastlines, so I conclude this is not an island" << endl;
+		mapIsIsland=false;
+	}
+
+	if (mapIsIsland)
+		cout << "INFO: There are " << F.size() << " coastline ways, none unbounded so I still think the map is an island" << endl;
+
+	if (mapIsIsland)
+	{
+		cout << "INFO: Concluded the map is an island for lack of contradictory evidence" << endl;
+		features.emplace_back(0,Relation,Lake,"<big ocean>",db.corners());
+	}
+
+	for(auto& poly : F)
+	{
+		if (poly.second)	// was originally closed
+			features.emplace_back(0,Way,Island,"<unspecified>",std::move(poly.first));
+		else
+			features.emplace_back(0,Way,Lake,"<unspecified>",std::move(poly.first));
+	}
+
+	return features;
+}
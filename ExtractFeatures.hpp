@@ -0,0 +1,30 @@
+/*
+ * ExtractFeatures.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef EXTRACTFEATURES_HPP_
+#define EXTRACTFEATURES_HPP_
+
+#include <vector>
+
+#include "POI.hpp"
+#include "Feature.h"
+
+class OSMDatabase;
+
+/** The non-road content of a StreetsDatabase, extracted from an OSMDatabase (shared by osm2bin and osmApplyChange).
+ * Each is one pass over the database, with no dependence on the road network.
+ */
+
+/// Points of interest among the nodes (NodePOIFilter), in node order
+std::vector<POI> extractPOIs(const OSMDatabase& db);
+
+/** Features from ways (BasicWayFeatureFactory) and relations (BasicRelationFeatureFactory), then the coastline loops
+ * closed by MultipolyCloser, and a surrounding ocean if the map appears to be an island
+ */
+std::vector<Feature> extractFeatures(const OSMDatabase& db);
+
+#endif /* EXTRACTFEATURES_HPP_ */
@@ -14,6 +14,8 @@
 
 #include "LatLon.h"
 
+#include <boost/serialization/version.hpp>
+
 #include "OSMEntityType.h"
 
 enum FeatureType {
@@ -38,13 +40,24 @@ public:
     Feature() {
     }
 
+    Feature(OSMID id, OSMEntityType osmType, FeatureType type, std::string&& name, std::vector<FixedLatLon>&& pts, bool bounded = true) :
+    m_id(id),
+    m_osmType(osmType),
+    m_name(name),
+    m_points(std::move(pts)),
+    m_type(type),
+    m_bounded(bounded) {
+    }
+
     Feature(OSMID id, OSMEntityType osmType, FeatureType type, std::string&& name, std::vector<LatLon>&& pts, bool bounded = true) :
     m_id(id),
     m_osmType(osmType),
     m_name(name),
-    m_points(pts),
     m_type(type),
     m_bounded(bounded) {
+        m_points.reserve(pts.size());
+        for (const LatLon ll : pts)
+            m_points.push_back(FixedLatLon(ll));
     }
 
     unsigned pointCount() const {
@@ -55,7 +68,13 @@ public:
         return m_points.at(i);
     }
 
-    const std::vector<LatLon>& points() const {
+    /// Points converted to LatLon
+    std::vector<LatLon> points() const {
+        return std::vector<LatLon>(m_points.begin(), m_points.end());
+    }
+
+    /// Points as stored (1e-7 degree fixed point)
+    const std::vector<FixedLatLon>& fixedPoints() const {
         return m_points;
     }
 
@@ -83,18 +102,30 @@ private:
     OSMID m_id = -1ULL;
     OSMEntityType m_osmType = Invalid;
     std::string m_name = "";
-    std::vector<LatLon> m_points;
+    std::vector<FixedLatLon> m_points;
     FeatureType m_type;
 
     bool m_bounded = true;
 
+    // version 0 archives hold float LatLon points
     template<class Archive>void serialize(Archive& ar, const unsigned ver) {
-        ar & m_id & m_name & m_points & m_type & m_osmType;
+        ar & m_id & m_name;
+        if (ver == 0) {
+            std::vector<LatLon> pts;
+            ar & pts;
+            m_points.clear();
+            for (const LatLon ll : pts)
+                m_points.push_back(FixedLatLon(ll));
+        } else
+            ar & m_points;
+        ar & m_type & m_osmType;
     }
 
     friend class boost::serialization::access;
 };
 
+BOOST_CLASS_VERSION(Feature, 1)
+
 
 
 
@@ -12,7 +12,7 @@
 
 const std::string FeatureFactory::s_noname="<noname>";
 
-const std::string& FeatureFactory::name(const OSMEntity* e) const
+std::string FeatureFactory::name(const OSMEntity* e) const
 {
 	unsigned val=-1U;
 	if ((val = e->getValueForKey(m_kiNameEn)) != -1U)
@@ -20,5 +20,5 @@ const std::string& FeatureFactory::name(const OSMEntity* e) const
 	else if ((val = e->getValueForKey(m_kiName)) != -1U)
 		{}
 
-	return val == -1U ? s_noname : m_kvtTags.getValue(val);
+	return val == -1U ? s_noname : m_kvtTags.getValue(val).to_string();
 }
@@ -30,7 +30,7 @@ public:
 protected:
 	const OSMDatabase& m_db;
 
-	const std::string& name(const OSMEntity* e) const;
+	std::string name(const OSMEntity* e) const;
 
 private:
 	const KeyValueTable& m_kvtTags;				// key-value table for the tags
@@ -0,0 +1,233 @@
+/*
+ * FlatFile.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "FlatFile.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+const std::uint64_t FlatStringTable::s_zero = 0;
+constexpr std::uint32_t FlatFileHeader::s_byteOrderMark;
+
+unsigned FlatStringTable::indexOf(boost::string_ref s) const {
+    for (unsigned i = 0; i < size(); ++i)
+        if ((*this)[i] == s)
+            return i;
+    return -1U;
+}
+
+
+
+MappedFile::MappedFile(const std::string& fn) {
+    int fd = ::open(fn.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("MappedFile: failed to open " + fn);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("MappedFile: failed to stat " + fn);
+    }
+
+    size_ = st.st_size;
+
+    if (size_ > 0) {
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("MappedFile: failed to map " + fn);
+        }
+        p_ = static_cast<const char*> (p);
+    }
+
+    // mapping remains valid after the descriptor is closed
+    ::close(fd);
+}
+
+MappedFile::MappedFile(MappedFile&& rhs) : p_(rhs.p_), size_(rhs.size_) {
+    rhs.p_ = nullptr;
+    rhs.size_ = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs) {
+    if (this != &rhs) {
+        unmap();
+        p_ = rhs.p_;
+        size_ = rhs.size_;
+        rhs.p_ = nullptr;
+        rhs.size_ = 0;
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+void MappedFile::unmap() {
+    if (p_)
+        munmap(const_cast<char*> (p_), size_);
+    p_ = nullptr;
+    size_ = 0;
+}
+
+
+
+bool flatFileHasMagic(const std::string& fn, const char* magic) {
+    ifstream is(fn.c_str(), ios_base::in | ios_base::binary);
+    char buf[8];
+    return is.read(buf, 8) && memcmp(buf, magic, 8) == 0;
+}
+
+
+
+FlatFileWriter::FlatFileWriter(const std::string& fn, const char* magic, std::uint32_t version) :
+file_(new ofstream(fn.c_str(), ios_base::out | ios_base::binary | ios_base::trunc)),
+fn_(fn),
+os_(file_.get()) {
+    if (!os_->good())
+        throw std::ios_base::failure("FlatFileWriter: failed to open " + fn);
+    writeHeader(magic, version);
+}
+
+FlatFileWriter::FlatFileWriter(std::ostream& os, const char* magic, std::uint32_t version) : os_(&os) {
+    writeHeader(magic, version);
+}
+
+void FlatFileWriter::writeHeader(const char* magic, std::uint32_t version) {
+    memset(&header_, 0, sizeof (header_));
+    memcpy(header_.magic, magic, 8);
+    header_.version = version;
+    header_.byteOrder = FlatFileHeader::s_byteOrderMark;
+
+    // placeholder, rewritten by close()
+    os_->write(reinterpret_cast<const char*> (&header_), sizeof (header_));
+    open_ = true;
+}
+
+FlatFileWriter::~FlatFileWriter() {
+    // unfinished: discard rather than write a header over what may be a truncated file
+    if (open_ && file_) {
+        file_->close();
+        std::remove(fn_.c_str());
+    }
+}
+
+void FlatFileWriter::pad() {
+    static const char zeros[8] = {0};
+    std::uint64_t pos = os_->tellp();
+    if (pos % 8)
+        os_->write(zeros, 8 - pos % 8);
+}
+
+void FlatFileWriter::addSectionBytes(std::uint32_t id, std::uint32_t elementSize, const void* p, std::size_t n) {
+    pad();
+
+    FlatSectionEntry s;
+    s.id = id;
+    s.elementSize = elementSize;
+    s.offset = os_->tellp();
+    s.count = n;
+
+    if (n > 0)
+        os_->write(static_cast<const char*> (p), std::streamsize(n) * elementSize);
+
+    sections_.push_back(s);
+}
+
+void FlatFileWriter::addStringTable(std::uint32_t offsetsID, std::uint32_t charsID, const std::vector<std::string>& strs) {
+    vector<std::uint64_t> offsets = csrOffsets(strs, [](const std::string & s) {
+        return s.size(); });
+
+    string chars;
+    chars.reserve(offsets.back());
+    for (const auto& s : strs)
+        chars += s;
+
+    addSection(offsetsID, offsets);
+    addSection(charsID, chars.data(), chars.size());
+}
+
+void FlatFileWriter::addStringTable(std::uint32_t offsetsID, std::uint32_t charsID, const FlatStringTable& strs) {
+    addSection(offsetsID, strs.offsets().data(), strs.offsets().size());
+    addSection(charsID, strs.chars().data(), strs.offsets().back());
+}
+
+void FlatFileWriter::close() {
+    pad();
+    header_.sectionTableOffset = os_->tellp();
+    header_.sectionCount = sections_.size();
+
+    os_->write(reinterpret_cast<const char*> (sections_.data()), sections_.size() * sizeof (FlatSectionEntry));
+
+    const std::streampos end = os_->tellp();
+    os_->seekp(0);
+    os_->write(reinterpret_cast<const char*> (&header_), sizeof (header_));
+    os_->seekp(end);
+    open_ = false;
+
+    if (file_)
+        file_->close();
+
+    if (os_->fail())
+        throw std::ios_base::failure("FlatFileWriter: write failed");
+}
+
+
+
+FlatFileReader::FlatFileReader(const std::string& fn, const char* magic, std::uint32_t version) :
+file_(fn),
+data_(file_.data()),
+size_(file_.size()) {
+    validate(fn, magic, version);
+}
+
+FlatFileReader::FlatFileReader(std::string&& image, const char* magic, std::uint32_t version) :
+image_(new std::string(std::move(image))),
+data_(image_->data()),
+size_(image_->size()) {
+    validate("<in-memory image>", magic, version);
+}
+
+void FlatFileReader::validate(const std::string& fn, const char* magic, std::uint32_t version) {
+    if (size_ < sizeof (FlatFileHeader) || memcmp(header().magic, magic, 8) != 0)
+        throw std::runtime_error("FlatFileReader: " + fn + " is not a flat file of the expected type");
+
+    if (header().byteOrder != FlatFileHeader::s_byteOrderMark)
+        throw std::runtime_error("FlatFileReader: " + fn + " was written with a different byte order");
+
+    if (header().version > version)
+        throw std::runtime_error("FlatFileReader: " + fn + " has format version " + std::to_string(header().version) +
+            " (newer than supported version " + std::to_string(version) + ")");
+
+    const std::uint64_t tableEnd = header().sectionTableOffset + std::uint64_t(header().sectionCount) * sizeof (FlatSectionEntry);
+    if (tableEnd > size_)
+        throw std::runtime_error("FlatFileReader: " + fn + " is truncated (section table)");
+
+    sections_ = FlatArray<FlatSectionEntry>(
+            reinterpret_cast<const FlatSectionEntry*> (data_ + header().sectionTableOffset),
+            header().sectionCount);
+
+    for (const auto& s : sections_)
+        if (s.offset + s.count * s.elementSize > size_)
+            throw std::runtime_error("FlatFileReader: " + fn + " is truncated (section " + std::to_string(s.id) + ")");
+}
+
+const FlatSectionEntry* FlatFileReader::find(std::uint32_t id) const {
+    for (const auto& s : sections_)
+        if (s.id == id)
+            return &s;
+    return nullptr;
+}
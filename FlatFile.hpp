@@ -0,0 +1,298 @@
+/*
+ * FlatFile.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef FLATFILE_HPP_
+#define FLATFILE_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+#include <boost/utility/string_ref.hpp>
+
+/** Support for flat, section-based binary files which are mmap'ed and used in place (.osm.bin, .streets.bin).
+ *
+ * Layout: a FlatFileHeader, then each section's raw array data (8-byte aligned), then the section table.
+ * Each section is a plain array of fixed-size elements identified by a format-specific integer ID. Data is stored in
+ * native byte order; the header records the order so a mismatched file is rejected rather than misread.
+ */
+
+struct FlatFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder; // written as s_byteOrderMark
+    std::uint64_t sectionTableOffset;
+    std::uint32_t sectionCount;
+    std::uint32_t reserved;
+
+    static constexpr std::uint32_t s_byteOrderMark = 0x01020304;
+};
+
+struct FlatSectionEntry {
+    std::uint32_t id;
+    std::uint32_t elementSize;
+    std::uint64_t offset; // bytes from start of file
+    std::uint64_t count; // number of elements
+};
+
+/** Read-only array view into mapped (or otherwise externally-owned) memory */
+
+template<typename T>class FlatArray {
+public:
+
+    FlatArray() {
+    }
+
+    FlatArray(const T* p, std::size_t n) : p_(p), n_(n) {
+    }
+
+    typedef const T* const_iterator;
+    typedef const T* iterator;
+    typedef T value_type;
+
+    const T* begin() const {
+        return p_;
+    }
+
+    const T* end() const {
+        return p_ + n_;
+    }
+
+    std::size_t size() const {
+        return n_;
+    }
+
+    bool empty() const {
+        return n_ == 0;
+    }
+
+    const T& operator[](std::size_t i) const {
+        return p_[i];
+    }
+
+    const T& at(std::size_t i) const {
+        if (i >= n_)
+            throw std::out_of_range("FlatArray::at");
+        return p_[i];
+    }
+
+    const T& front() const {
+        return p_[0];
+    }
+
+    const T& back() const {
+        return p_[n_ - 1];
+    }
+
+    const T* data() const {
+        return p_;
+    }
+
+    /// Elements [b,e) as a sub-array
+    FlatArray slice(std::size_t b, std::size_t e) const {
+        return FlatArray(p_ + b, e - b);
+    }
+
+private:
+    const T* p_ = nullptr;
+    std::size_t n_ = 0;
+};
+
+/** Strings stored as one character blob plus N+1 offsets; string i is chars[offsets[i],offsets[i+1]) */
+
+class FlatStringTable {
+public:
+
+    FlatStringTable() {
+    }
+
+    FlatStringTable(FlatArray<std::uint64_t> offsets, FlatArray<char> chars) : offsets_(offsets), chars_(chars) {
+        if (offsets_.empty() || offsets_.back() > chars_.size())
+            throw std::runtime_error("FlatStringTable: inconsistent offsets");
+    }
+
+    std::size_t size() const {
+        return offsets_.size() - 1;
+    }
+
+    boost::string_ref operator[](std::size_t i) const {
+        return boost::string_ref(chars_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]);
+    }
+
+    boost::string_ref at(std::size_t i) const {
+        if (i + 1 >= offsets_.size())
+            throw std::out_of_range("FlatStringTable::at");
+        return (*this)[i];
+    }
+
+    /// Linear-time search for a string, returning -1U if not present
+    unsigned indexOf(boost::string_ref s) const;
+
+    const FlatArray<std::uint64_t>& offsets() const {
+        return offsets_;
+    }
+
+    const FlatArray<char>& chars() const {
+        return chars_;
+    }
+
+private:
+    FlatArray<std::uint64_t> offsets_ = FlatArray<std::uint64_t>(&s_zero, 1);
+    FlatArray<char> chars_;
+
+    static const std::uint64_t s_zero;
+};
+
+/** RAII read-only memory mapping of a whole file */
+
+class MappedFile {
+public:
+    MappedFile() {
+    }
+
+    explicit MappedFile(const std::string& fn);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& rhs);
+    MappedFile& operator=(MappedFile&& rhs);
+
+    ~MappedFile();
+
+    const char* data() const {
+        return p_;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+private:
+    void unmap();
+
+    const char* p_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+/** Returns true if the file exists and starts with the given 8-byte magic */
+
+bool flatFileHasMagic(const std::string& fn, const char* magic);
+
+/** Writes a flat file section by section; the section table and header are finalized by close(), which must be called
+ * explicitly to commit the file. A writer destroyed without close() (eg. during stack unwinding) does not finalize or
+ * throw: a file it opened itself is closed and removed, and a caller-supplied stream is left as is.
+ * The stream variant must be seekable (eg. std::ostringstream, to build an image in memory).
+ */
+
+class FlatFileWriter {
+public:
+    FlatFileWriter(const std::string& fn, const char* magic, std::uint32_t version);
+    FlatFileWriter(std::ostream& os, const char* magic, std::uint32_t version);
+    ~FlatFileWriter();
+
+    template<typename T>void addSection(std::uint32_t id, const T* p, std::size_t n) {
+        addSectionBytes(id, sizeof(T), p, n);
+    }
+
+    template<typename T>void addSection(std::uint32_t id, const std::vector<T>& v) {
+        addSection(id, v.data(), v.size());
+    }
+
+    /// Writes a string table as an offsets section and a character section
+    void addStringTable(std::uint32_t offsetsID, std::uint32_t charsID, const std::vector<std::string>& strs);
+
+    /// As above for strings already held as offsets & chars (eg. a ValueTable), written in bulk
+    void addStringTable(std::uint32_t offsetsID, std::uint32_t charsID, const FlatStringTable& strs);
+
+    void close();
+
+private:
+    void writeHeader(const char* magic, std::uint32_t version);
+    void addSectionBytes(std::uint32_t id, std::uint32_t elementSize, const void* p, std::size_t n);
+    void pad();
+
+    std::unique_ptr<std::ofstream> file_; // set if we opened the file ourselves
+    std::string fn_;
+    std::ostream* os_ = nullptr;
+    FlatFileHeader header_;
+    std::vector<FlatSectionEntry> sections_;
+    bool open_ = false;
+};
+
+/** Maps a flat file and provides its sections as FlatArray views. version is the newest format version the caller
+ * understands; older files are accepted so that sections added later can be treated as optional.
+ *
+ * A reader can also take ownership of an in-memory image (as produced by FlatFileWriter on a std::ostringstream).
+ *
+ * Throws std::runtime_error if the magic or byte order does not match, the file is newer than version, or if a requested
+ * section is missing or has the wrong element size.
+ */
+
+class FlatFileReader {
+public:
+
+    FlatFileReader() {
+    }
+
+    FlatFileReader(const std::string& fn, const char* magic, std::uint32_t version);
+    FlatFileReader(std::string&& image, const char* magic, std::uint32_t version);
+
+    bool hasSection(std::uint32_t id) const {
+        return find(id) != nullptr;
+    }
+
+    template<typename T>FlatArray<T> section(std::uint32_t id) const {
+        const FlatSectionEntry* s = find(id);
+        if (!s)
+            throw std::runtime_error("FlatFileReader: missing section " + std::to_string(id));
+        if (s->elementSize != sizeof (T))
+            throw std::runtime_error("FlatFileReader: element size mismatch in section " + std::to_string(id));
+        return FlatArray<T>(reinterpret_cast<const T*> (data_ + s->offset), s->count);
+    }
+
+    FlatStringTable stringTable(std::uint32_t offsetsID, std::uint32_t charsID) const {
+        return FlatStringTable(section<std::uint64_t>(offsetsID), section<char>(charsID));
+    }
+
+    std::uint32_t version() const {
+        return header().version;
+    }
+
+private:
+    const FlatFileHeader& header() const {
+        return *reinterpret_cast<const FlatFileHeader*> (data_);
+    }
+
+    void validate(const std::string& name, const char* magic, std::uint32_t version);
+    const FlatSectionEntry* find(std::uint32_t id) const;
+
+    MappedFile file_;
+    std::unique_ptr<const std::string> image_;
+
+    const char* data_ = nullptr; // points into file_ or image_
+    std::size_t size_ = 0;
+
+    FlatArray<FlatSectionEntry> sections_;
+};
+
+/** Offsets for compressed-sparse-row (CSR) storage; elements of row i are [offsets[i],offsets[i+1]) */
+
+template<typename Range, typename SizeFunction>std::vector<std::uint64_t> csrOffsets(const Range& r, SizeFunction f) {
+    std::vector<std::uint64_t> offsets;
+    offsets.reserve(r.size() + 1);
+    offsets.push_back(0);
+    for (const auto& e : r)
+        offsets.push_back(offsets.back() + f(e));
+    return offsets;
+}
+
+#endif /* FLATFILE_HPP_ */
@@ -0,0 +1,433 @@
+/*
+ * FlatOSMDatabase.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "FlatOSMDatabase.hpp"
+#include "OSMDatabase.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+
+#include <boost/range/adaptor/transformed.hpp>
+
+using namespace std;
+
+const char FlatOSMDatabase::s_magic[8] = {'O', 'S', 'M', '2', 'B', 'I', 'N', '\0'};
+constexpr std::uint32_t FlatOSMDatabase::s_version;
+
+namespace {
+
+template<typename T>FlatArray<T> csrRow(const FlatArray<T>& a, const FlatArray<std::uint64_t>& offsets, unsigned i) {
+    return a.slice(offsets.at(i), offsets.at(i + 1));
+}
+
+void checkCSR(const FlatArray<std::uint64_t>& offsets, std::size_t nRows, std::size_t nElements, const char* what) {
+    if (offsets.size() != nRows + 1 || offsets.back() != nElements)
+        throw std::runtime_error(std::string("FlatOSMDatabase: inconsistent ") + what + " offsets");
+}
+
+/// Number of rows of a CSR offsets section (which must hold at least the leading 0)
+std::size_t csrRows(const FlatArray<std::uint64_t>& offsets, const char* what) {
+    if (offsets.empty())
+        throw std::runtime_error(std::string("FlatOSMDatabase: empty ") + what + " offsets");
+    return offsets.size() - 1;
+}
+
+
+
+// DeltaVarint coding
+
+void putSVarint(vector<std::uint8_t>& out, std::int64_t x) {
+    std::uint64_t u = (std::uint64_t(x) << 1) ^ std::uint64_t(x >> 63);
+    for (; u >= 0x80; u >>= 7)
+        out.push_back(std::uint8_t(u) | 0x80);
+    out.push_back(std::uint8_t(u));
+}
+
+/** Decodes exactly n zigzag varints from [p,end), calling f(v) for each. While at least 10 bytes (one maximal varint)
+ * remain, bytes are read without bounds checks; the tail is checked. Throws if the data is truncated or has bytes left.
+ */
+
+template<class UnaryFunction>void decodeSVarints(const std::uint8_t* p, const std::uint8_t* const end, std::size_t n,
+        const char* what, UnaryFunction f) {
+    for (; n > 0 && end - p >= 10; --n) {
+        std::uint64_t u = *p & 0x7f;
+        for (unsigned shift = 7; *p++ & 0x80; shift += 7) {
+            if (shift >= 64)
+                throw std::runtime_error(std::string("FlatOSMDatabase: corrupt ") + what + " section");
+            u |= std::uint64_t(*p & 0x7f) << shift;
+        }
+        f(std::int64_t(u >> 1) ^ -std::int64_t(u & 1));
+    }
+
+    for (; n > 0; --n) {
+        std::uint64_t u = 0;
+        unsigned shift = 0;
+        std::uint8_t b;
+        do {
+            if (p == end || shift >= 64)
+                throw std::runtime_error(std::string("FlatOSMDatabase: corrupt ") + what + " section");
+            b = *p++;
+            u |= std::uint64_t(b & 0x7f) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        f(std::int64_t(u >> 1) ^ -std::int64_t(u & 1));
+    }
+
+    if (p != end)
+        throw std::runtime_error(std::string("FlatOSMDatabase: trailing data in ") + what + " section");
+}
+
+template<class IDRange>vector<std::uint8_t> encodeIDs(const IDRange& ids) {
+    vector<std::uint8_t> b;
+    b.reserve(ids.size() * 2);
+    OSMID prev = 0;
+    for (const OSMID id : ids) {
+        putSVarint(b, std::int64_t(id - prev));
+        prev = id;
+    }
+    return b;
+}
+
+vector<OSMID> decodeIDs(const FlatArray<std::uint8_t>& b, std::size_t n, const char* what) {
+    vector<OSMID> ids(n);
+    OSMID* o = ids.data();
+    OSMID prev = 0;
+    decodeSVarints(b.begin(), b.end(), n, what, [&](std::int64_t d) {
+        *o++ = prev += d; });
+    return ids;
+}
+
+vector<std::uint8_t> encodeCoords(const vector<FixedLatLon>& coords) {
+    vector<std::uint8_t> b;
+    b.reserve(coords.size() * 4);
+    std::int64_t lat = 0, lon = 0;
+    for (const FixedLatLon ll : coords) {
+        putSVarint(b, ll.lat - lat);
+        putSVarint(b, ll.lon - lon);
+        lat = ll.lat;
+        lon = ll.lon;
+    }
+    return b;
+}
+
+vector<FixedLatLon> decodeCoords(const FlatArray<std::uint8_t>& b, std::size_t n) {
+    vector<FixedLatLon> coords(n);
+    std::int64_t q[2] = {0, 0};
+    unsigned k = 0;
+    FixedLatLon* o = coords.data();
+    decodeSVarints(b.begin(), b.end(), 2 * n, "node coordinate", [&](std::int64_t d) {
+        q[k] += d;
+        if (k == 1) {
+            *o++ = FixedLatLon(std::int32_t(q[0]), std::int32_t(q[1]));
+            k = 0;
+        } else
+            k = 1;
+    });
+    return coords;
+}
+
+/// Float coordinates of a pre-version 3 file, rounded to fixed point
+vector<FixedLatLon> convertCoords(const FlatArray<LatLon>& ll) {
+    vector<FixedLatLon> coords;
+    coords.reserve(ll.size());
+    for (const LatLon p : ll)
+        coords.push_back(FixedLatLon(p));
+    return coords;
+}
+
+}
+
+unsigned FlatOSMDatabase::EntityRef::getValueForKey(unsigned ki) const {
+    const auto it = std::lower_bound(tags_.begin(), tags_.end(), ki, [](FlatTag t, unsigned k) {
+        return t.key < k; });
+    return (it == tags_.end() || it->key != ki) ? -1U : it->value;
+}
+
+FlatOSMDatabase::FlatOSMDatabase(const std::string& fn) :
+FlatOSMDatabase(FlatFileReader(fn, s_magic, s_version)) {
+}
+
+FlatOSMDatabase::FlatOSMDatabase(FlatFileReader&& file) :
+file_(std::move(file)) {
+    FlatArray<LatLon> b = file_.section<LatLon>(OSMBin::Bounds);
+    if (b.size() != 2)
+        throw std::runtime_error("FlatOSMDatabase: invalid bounds section");
+    bounds_ = make_pair(b[0], b[1]);
+
+    nodeTagOffsets_ = file_.section<std::uint64_t>(OSMBin::NodeTagOffsets);
+    nodeTagArray_ = file_.section<FlatTag>(OSMBin::NodeTags);
+    if (file_.hasSection(OSMBin::NodeIDsDelta)) {
+        const std::size_t n = csrRows(nodeTagOffsets_, "node tag");
+        decodedNodeIDs_ = decodeIDs(file_.section<std::uint8_t>(OSMBin::NodeIDsDelta), n, "node ID");
+        decodedNodeCoords_ = decodeCoords(file_.section<std::uint8_t>(OSMBin::NodeCoordsDelta), n);
+        nodeIDs_ = FlatArray<OSMID>(decodedNodeIDs_.data(), n);
+        nodeCoords_ = FlatArray<FixedLatLon>(decodedNodeCoords_.data(), n);
+    } else {
+        nodeIDs_ = file_.section<OSMID>(OSMBin::NodeIDs);
+        if (file_.hasSection(OSMBin::NodeCoordsFixed))
+            nodeCoords_ = file_.section<FixedLatLon>(OSMBin::NodeCoordsFixed);
+        else {
+            decodedNodeCoords_ = convertCoords(file_.section<LatLon>(OSMBin::NodeCoords));
+            nodeCoords_ = FlatArray<FixedLatLon>(decodedNodeCoords_.data(), decodedNodeCoords_.size());
+        }
+    }
+    if (file_.hasSection(OSMBin::NodeIDOrder))
+        nodeIDOrder_ = file_.section<std::uint32_t>(OSMBin::NodeIDOrder);
+
+    wayIDs_ = file_.section<OSMID>(OSMBin::WayIDs);
+    wayNdRefOffsets_ = file_.section<std::uint64_t>(OSMBin::WayNdRefOffsets);
+    if (file_.hasSection(OSMBin::WayNdRefsDelta)) {
+        if (wayNdRefOffsets_.empty())
+            throw std::runtime_error("FlatOSMDatabase: empty way node ref offsets");
+        decodedWayNdRefs_ = decodeIDs(file_.section<std::uint8_t>(OSMBin::WayNdRefsDelta), wayNdRefOffsets_.back(), "way node ref");
+        wayNdRefs_ = FlatArray<OSMID>(decodedWayNdRefs_.data(), decodedWayNdRefs_.size());
+    } else
+        wayNdRefs_ = file_.section<OSMID>(OSMBin::WayNdRefs);
+    wayTagOffsets_ = file_.section<std::uint64_t>(OSMBin::WayTagOffsets);
+    wayTagArray_ = file_.section<FlatTag>(OSMBin::WayTags);
+    if (file_.hasSection(OSMBin::WayIDOrder))
+        wayIDOrder_ = file_.section<std::uint32_t>(OSMBin::WayIDOrder);
+
+    relationIDs_ = file_.section<OSMID>(OSMBin::RelationIDs);
+    relationMemberOffsets_ = file_.section<std::uint64_t>(OSMBin::RelationMemberOffsets);
+    relationMembers_ = file_.section<FlatMember>(OSMBin::RelationMembers);
+    relationTagOffsets_ = file_.section<std::uint64_t>(OSMBin::RelationTagOffsets);
+    relationTagArray_ = file_.section<FlatTag>(OSMBin::RelationTags);
+    if (file_.hasSection(OSMBin::RelationIDOrder))
+        relationIDOrder_ = file_.section<std::uint32_t>(OSMBin::RelationIDOrder);
+
+    nodeTags_ = FlatKeyValueTable(
+            file_.stringTable(OSMBin::NodeKeyOffsets, OSMBin::NodeKeyChars),
+            file_.stringTable(OSMBin::NodeValueOffsets, OSMBin::NodeValueChars));
+    wayTags_ = FlatKeyValueTable(
+            file_.stringTable(OSMBin::WayKeyOffsets, OSMBin::WayKeyChars),
+            file_.stringTable(OSMBin::WayValueOffsets, OSMBin::WayValueChars));
+    relationTags_ = FlatKeyValueTable(
+            file_.stringTable(OSMBin::RelationKeyOffsets, OSMBin::RelationKeyChars),
+            file_.stringTable(OSMBin::RelationValueOffsets, OSMBin::RelationValueChars));
+    roles_ = file_.stringTable(OSMBin::RoleOffsets, OSMBin::RoleChars);
+
+    // cheap O(1) consistency checks so that a corrupt file fails here rather than on access
+    if (nodeCoords_.size() != nodeIDs_.size())
+        throw std::runtime_error("FlatOSMDatabase: node ID/coordinate count mismatch");
+    checkCSR(nodeTagOffsets_, nodeIDs_.size(), nodeTagArray_.size(), "node tag");
+    checkCSR(wayNdRefOffsets_, wayIDs_.size(), wayNdRefs_.size(), "way node ref");
+    checkCSR(wayTagOffsets_, wayIDs_.size(), wayTagArray_.size(), "way tag");
+    checkCSR(relationMemberOffsets_, relationIDs_.size(), relationMembers_.size(), "relation member");
+    checkCSR(relationTagOffsets_, relationIDs_.size(), relationTagArray_.size(), "relation tag");
+}
+
+FlatOSMDatabase::NodeRef FlatOSMDatabase::node(unsigned i) const {
+    return NodeRef(nodeIDs_.at(i), csrRow(nodeTagArray_, nodeTagOffsets_, i), nodeCoords_[i]);
+}
+
+FlatOSMDatabase::WayRef FlatOSMDatabase::way(unsigned i) const {
+    return WayRef(wayIDs_.at(i), csrRow(wayTagArray_, wayTagOffsets_, i), csrRow(wayNdRefs_, wayNdRefOffsets_, i));
+}
+
+FlatOSMDatabase::RelationRef FlatOSMDatabase::relation(unsigned i) const {
+    return RelationRef(relationIDs_.at(i), csrRow(relationTagArray_, relationTagOffsets_, i), csrRow(relationMembers_, relationMemberOffsets_, i));
+}
+
+unsigned FlatOSMDatabase::indexFromID(const FlatArray<OSMID>& ids, const FlatArray<std::uint32_t>& order, OSMID id) {
+    if (order.empty()) {
+        // IDs ascending in file order
+        const auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        return (it == ids.end() || *it != id) ? -1U : unsigned(it - ids.begin());
+    } else {
+        const auto it = std::lower_bound(order.begin(), order.end(), id, [&ids](std::uint32_t i, OSMID x) {
+            return ids[i] < x; });
+        return (it == order.end() || ids[*it] != id) ? -1U : *it;
+    }
+}
+
+unsigned FlatOSMDatabase::nodeIndexFromID(OSMID id) const {
+    return indexFromID(nodeIDs_, nodeIDOrder_, id);
+}
+
+unsigned FlatOSMDatabase::wayIndexFromID(OSMID id) const {
+    return indexFromID(wayIDs_, wayIDOrder_, id);
+}
+
+unsigned FlatOSMDatabase::relationIndexFromID(OSMID id) const {
+    return indexFromID(relationIDs_, relationIDOrder_, id);
+}
+
+namespace {
+
+KeyValueTable copyKeyValueTable(const FlatKeyValueTable& f) {
+    return KeyValueTable(ValueTable(f.keys()), ValueTable(f.values()));
+}
+
+template<class Entity>void copyTags(Entity& e, const FlatArray<FlatTag>& tags) {
+    for (const FlatTag t : tags)
+        e.addTag(t.key, t.value);
+}
+
+}
+
+OSMDatabase FlatOSMDatabase::toOSMDatabase() const {
+    // same columns as the file, taken in ID order
+    OSMNodeTable nodes;
+    nodes.reserve(nodeCount(), nodeTagArray_.size());
+    for (unsigned k = 0; k < nodeCount(); ++k) {
+        const unsigned i = nodeIDOrder_.empty() ? k : nodeIDOrder_[k];
+        const FlatArray<FlatTag> tags = csrRow(nodeTagArray_, nodeTagOffsets_, i);
+        nodes.push_back(nodeIDs_[i], nodeCoords_[i], tags | boost::adaptors::transformed([](FlatTag t) {
+            return make_pair(unsigned(t.key), unsigned(t.value)); }));
+    }
+
+    // ways & relations in file order with their refs & members copied in bulk; the OSMDatabase sorts them if need be
+    vector<OSMWay> ways;
+    ways.reserve(wayCount());
+    for (unsigned i = 0; i < wayCount(); ++i) {
+        const WayRef w = way(i);
+        ways.emplace_back(w.id());
+        copyTags(ways.back(), w.tags());
+    }
+
+    vector<OSMRelation> relations;
+    relations.reserve(relationCount());
+    for (unsigned i = 0; i < relationCount(); ++i) {
+        const RelationRef r = relation(i);
+        relations.emplace_back(r.id());
+        copyTags(relations.back(), r.tags());
+    }
+
+    vector<OSMRelation::Member> members;
+    members.reserve(relationMembers_.size());
+    for (const FlatMember m : relationMembers_)
+        members.push_back(OSMRelation::Member{m.id, OSMRelation::MemberType(m.type), m.role});
+
+    return OSMDatabase(
+            bounds_,
+            std::move(nodes),
+            copyKeyValueTable(nodeTags_),
+            std::move(ways),
+            vector<unsigned long long>(wayNdRefs_.begin(), wayNdRefs_.end()),
+            vector<std::uint64_t>(wayNdRefOffsets_.begin(), wayNdRefOffsets_.end()),
+            copyKeyValueTable(wayTags_),
+            std::move(relations),
+            std::move(members),
+            vector<std::uint64_t>(relationMemberOffsets_.begin(), relationMemberOffsets_.end()),
+            copyKeyValueTable(relationTags_),
+            ValueTable(roles_));
+}
+
+
+
+namespace {
+
+/// Returns the permutation sorting entities by ID, or an empty vector if they are already in ascending order
+template<class EntityRange>vector<std::uint32_t> idOrder(const EntityRange& R) {
+    bool sorted = std::is_sorted(R.begin(), R.end(), OSMEntity::osmIDLess);
+    if (sorted)
+        return vector<std::uint32_t>();
+
+    vector<std::uint32_t> order(R.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&R](std::uint32_t a, std::uint32_t b) {
+        return R[a].id() < R[b].id(); });
+    return order;
+}
+
+template<class EntityRange>void writeIDsAndTags(FlatFileWriter& w, const EntityRange& R, OSMBin::Section idS, OSMBin::Section tagOffsetS, OSMBin::Section tagS, OSMBin::Section orderS) {
+    vector<OSMID> ids;
+    vector<FlatTag> tags;
+
+    ids.reserve(R.size());
+    for (const auto& e : R) {
+        ids.push_back(e.id());
+        for (const auto& t : e.tags())
+            tags.push_back(FlatTag{t.first, t.second});
+    }
+
+    w.addSection(idS, ids);
+    w.addSection(tagOffsetS, csrOffsets(R, [](const OSMEntity & e) {
+        return e.tags().size(); }));
+    w.addSection(tagS, tags);
+
+    vector<std::uint32_t> order = idOrder(R);
+    if (!order.empty())
+        w.addSection(orderS, order);
+}
+
+void writeKeyValueTable(FlatFileWriter& w, const KeyValueTable& kvt, OSMBin::Section keyOffsetS, OSMBin::Section keyCharS, OSMBin::Section valueOffsetS, OSMBin::Section valueCharS) {
+    w.addStringTable(keyOffsetS, keyCharS, kvt.keys());
+    w.addStringTable(valueOffsetS, valueCharS, kvt.values());
+}
+
+void writeSections(FlatFileWriter& w, const OSMDatabase& db, OSMBin::Encoding enc) {
+    const bool delta = enc == OSMBin::DeltaVarint;
+
+    const LatLon bounds[2] = {db.bounds().first, db.bounds().second};
+    w.addSection(OSMBin::Bounds, bounds, 2);
+
+    // nodes: the table's columns are the sections (IDs ascending, so no order permutation)
+    {
+        const OSMNodeTable& nodes = db.nodes();
+        vector<FlatTag> tags;
+        tags.reserve(nodes.tagArray().size());
+        for (const auto& t : nodes.tagArray())
+            tags.push_back(FlatTag{t.first, t.second});
+
+        if (delta) {
+            w.addSection(OSMBin::NodeIDsDelta, encodeIDs(nodes.ids()));
+            w.addSection(OSMBin::NodeCoordsDelta, encodeCoords(nodes.coords()));
+        } else {
+            w.addSection(OSMBin::NodeIDs, nodes.ids());
+            w.addSection(OSMBin::NodeCoordsFixed, nodes.coords());
+        }
+        w.addSection(OSMBin::NodeTagOffsets, nodes.tagOffsets());
+        w.addSection(OSMBin::NodeTags, tags);
+    }
+
+    // ways
+    writeIDsAndTags(w, db.ways(), OSMBin::WayIDs, OSMBin::WayTagOffsets, OSMBin::WayTags, OSMBin::WayIDOrder);
+    w.addSection(OSMBin::WayNdRefOffsets, db.wayNdRefOffsets());
+    if (delta)
+        w.addSection(OSMBin::WayNdRefsDelta, encodeIDs(db.wayNdRefs()));
+    else
+        w.addSection(OSMBin::WayNdRefs, db.wayNdRefs());
+
+    // relations
+    writeIDsAndTags(w, db.relations(), OSMBin::RelationIDs, OSMBin::RelationTagOffsets, OSMBin::RelationTags, OSMBin::RelationIDOrder);
+    {
+        vector<FlatMember> members;
+        members.reserve(db.relationMembers().size());
+        for (const auto& m : db.relationMembers())
+            members.push_back(FlatMember{m.id, std::uint32_t(m.type), m.role});
+        w.addSection(OSMBin::RelationMemberOffsets, db.relationMemberOffsets());
+        w.addSection(OSMBin::RelationMembers, members);
+    }
+
+    // string tables
+    writeKeyValueTable(w, db.nodeTags(), OSMBin::NodeKeyOffsets, OSMBin::NodeKeyChars, OSMBin::NodeValueOffsets, OSMBin::NodeValueChars);
+    writeKeyValueTable(w, db.wayTags(), OSMBin::WayKeyOffsets, OSMBin::WayKeyChars, OSMBin::WayValueOffsets, OSMBin::WayValueChars);
+    writeKeyValueTable(w, db.relationTags(), OSMBin::RelationKeyOffsets, OSMBin::RelationKeyChars, OSMBin::RelationValueOffsets, OSMBin::RelationValueChars);
+    w.addStringTable(OSMBin::RoleOffsets, OSMBin::RoleChars, db.relationRoles().values());
+}
+}
+
+void writeFlatOSMDatabase(const OSMDatabase& db, const std::string& fn, OSMBin::Encoding enc) {
+    FlatFileWriter w(fn, FlatOSMDatabase::s_magic, FlatOSMDatabase::s_version);
+    writeSections(w, db, enc);
+    w.close();
+}
+
+void writeFlatOSMDatabase(const OSMDatabase& db, std::ostream& os, OSMBin::Encoding enc) {
+    FlatFileWriter w(os, FlatOSMDatabase::s_magic, FlatOSMDatabase::s_version);
+    writeSections(w, db, enc);
+    w.close();
+}
+
+FlatOSMDatabase toFlatOSMDatabase(const OSMDatabase& db) {
+    std::ostringstream os;
+    writeFlatOSMDatabase(db, os);
+    return FlatOSMDatabase(FlatFileReader(os.str(), FlatOSMDatabase::s_magic, FlatOSMDatabase::s_version));
+}
@@ -0,0 +1,342 @@
+/*
+ * FlatOSMDatabase.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef FLATOSMDATABASE_HPP_
+#define FLATOSMDATABASE_HPP_
+
+#include "FlatFile.hpp"
+#include "LatLon.h"
+#include "OSMEntityType.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+class OSMDatabase;
+
+/** Section IDs of the flat .osm.bin format (version 3). Numbers are part of the file format: append, never renumber.
+ *
+ * Each entity type (node/way/relation) has an ID array, tags in CSR form (N+1 offsets into a FlatTag array), and
+ * optionally an IDOrder permutation (omitted when IDs are already ascending, as they are in OSM dumps). Ways & relations
+ * store node refs / members in CSR form. Tag key/value strings and relation roles are string tables.
+ *
+ * Version 2 adds an optional compact encoding (in the spirit of PBF DenseNodes) for the three largest arrays: the
+ * Delta sections replace NodeIDs, NodeCoords and WayNdRefs with byte streams of zigzag varints. IDs and node refs are
+ * delta-coded along the array; coordinates are 1e-7 degree fixed point, lat & lon interleaved, each delta-coded against
+ * the previous node. Element counts come from the matching offsets sections.
+ *
+ * Version 3 stores plain coordinates as NodeCoordsFixed (int32 1e-7 degree, see FixedLatLon) instead of float NodeCoords;
+ * the delta coding was already exact in those units. Older files with NodeCoords are still read and converted.
+ */
+
+namespace OSMBin {
+enum Section : std::uint32_t {
+    Bounds = 1,
+
+    NodeIDs = 10,
+    NodeCoords = 11,
+    NodeTagOffsets = 12,
+    NodeTags = 13,
+    NodeIDOrder = 14,
+    NodeIDsDelta = 15,
+    NodeCoordsDelta = 16,
+    NodeCoordsFixed = 17,
+
+    WayIDs = 20,
+    WayNdRefOffsets = 21,
+    WayNdRefs = 22,
+    WayTagOffsets = 23,
+    WayTags = 24,
+    WayIDOrder = 25,
+    WayNdRefsDelta = 26,
+
+    RelationIDs = 30,
+    RelationMemberOffsets = 31,
+    RelationMembers = 32,
+    RelationTagOffsets = 33,
+    RelationTags = 34,
+    RelationIDOrder = 35,
+
+    NodeKeyOffsets = 40,
+    NodeKeyChars = 41,
+    NodeValueOffsets = 42,
+    NodeValueChars = 43,
+    WayKeyOffsets = 44,
+    WayKeyChars = 45,
+    WayValueOffsets = 46,
+    WayValueChars = 47,
+    RelationKeyOffsets = 48,
+    RelationKeyChars = 49,
+    RelationValueOffsets = 50,
+    RelationValueChars = 51,
+    RoleOffsets = 52,
+    RoleChars = 53
+};
+
+enum Encoding {
+    Plain, // arrays stored raw, used in place from the mapping
+    DeltaVarint // NodeIDs, NodeCoords and WayNdRefs delta/varint coded; decoded into memory when opened
+};
+}
+
+struct FlatTag {
+    std::uint32_t key;
+    std::uint32_t value;
+};
+
+struct FlatMember {
+    std::uint64_t id;
+    std::uint32_t type; // OSMRelation::MemberType
+    std::uint32_t role; // index into relation roles
+};
+
+/** Key and value string tables for one entity type, as stored in the flat file */
+
+class FlatKeyValueTable {
+public:
+
+    FlatKeyValueTable() {
+    }
+
+    FlatKeyValueTable(FlatStringTable keys, FlatStringTable values) : keys_(keys), values_(values) {
+    }
+
+    boost::string_ref getKey(unsigned ki) const {
+        return keys_.at(ki);
+    }
+
+    boost::string_ref getValue(unsigned vi) const {
+        return values_.at(vi);
+    }
+
+    std::pair<boost::string_ref, boost::string_ref> getKeyValue(FlatTag t) const {
+        return std::make_pair(getKey(t.key), getValue(t.value));
+    }
+
+    unsigned getIndexForKeyString(boost::string_ref s) const {
+        return keys_.indexOf(s);
+    }
+
+    unsigned getIndexForValueString(boost::string_ref s) const {
+        return values_.indexOf(s);
+    }
+
+    const FlatStringTable& keys() const {
+        return keys_;
+    }
+
+    const FlatStringTable& values() const {
+        return values_;
+    }
+
+private:
+    FlatStringTable keys_;
+    FlatStringTable values_;
+};
+
+/** Read-only OSM database used in place from a memory-mapped flat .osm.bin file.
+ *
+ * Opening costs O(number of sections) regardless of map size: nothing is deserialized and no per-entity memory is
+ * allocated, and several processes mapping the same file share one page-cache copy (except for a DeltaVarint file,
+ * whose node IDs, coordinates and way node refs are decoded into memory on opening). Entities are returned as
+ * lightweight value references with the same tag-lookup semantics as OSMEntity.
+ *
+ * Use toOSMDatabase() where a mutable, heap-allocated OSMDatabase is needed, and toFlatOSMDatabase() to query an
+ * OSMDatabase (eg. one read from a legacy archive) through this interface.
+ */
+
+class FlatOSMDatabase {
+public:
+    static const char s_magic[8];
+    static constexpr std::uint32_t s_version = 3;
+
+    class EntityRef {
+    public:
+
+        OSMID id() const {
+            return id_;
+        }
+
+        const FlatArray<FlatTag>& tags() const {
+            return tags_;
+        }
+
+        /// Binary search for the value index of key ki; -1U if absent
+        unsigned getValueForKey(unsigned ki) const;
+
+        bool hasTag(unsigned ki) const {
+            return getValueForKey(ki) != -1U;
+        }
+
+        bool hasTagWithValue(unsigned ki, unsigned vi) const {
+            return vi != -1U && getValueForKey(ki) == vi;
+        }
+
+    protected:
+
+        EntityRef(OSMID id, FlatArray<FlatTag> tags) : id_(id), tags_(tags) {
+        }
+
+    private:
+        OSMID id_;
+        FlatArray<FlatTag> tags_;
+    };
+
+    class NodeRef : public EntityRef {
+    public:
+
+        NodeRef(OSMID id, FlatArray<FlatTag> tags, FixedLatLon coords) : EntityRef(id, tags), coords_(coords) {
+        }
+
+        LatLon coords() const {
+            return coords_;
+        }
+
+        FixedLatLon fixedCoords() const {
+            return coords_;
+        }
+
+    private:
+        FixedLatLon coords_;
+    };
+
+    class WayRef : public EntityRef {
+    public:
+
+        WayRef(OSMID id, FlatArray<FlatTag> tags, FlatArray<OSMID> ndrefs) : EntityRef(id, tags), ndrefs_(ndrefs) {
+        }
+
+        const FlatArray<OSMID>& ndrefs() const {
+            return ndrefs_;
+        }
+
+        bool isClosed() const {
+            return !ndrefs_.empty() && ndrefs_.front() == ndrefs_.back();
+        }
+
+    private:
+        FlatArray<OSMID> ndrefs_;
+    };
+
+    class RelationRef : public EntityRef {
+    public:
+
+        RelationRef(OSMID id, FlatArray<FlatTag> tags, FlatArray<FlatMember> members) : EntityRef(id, tags), members_(members) {
+        }
+
+        const FlatArray<FlatMember>& members() const {
+            return members_;
+        }
+
+    private:
+        FlatArray<FlatMember> members_;
+    };
+
+    explicit FlatOSMDatabase(const std::string& fn);
+
+    /// Uses the sections of an already-opened file or in-memory image
+    explicit FlatOSMDatabase(FlatFileReader&& file);
+
+    FlatOSMDatabase(FlatOSMDatabase&&) = default;
+    FlatOSMDatabase& operator=(FlatOSMDatabase&&) = default;
+
+    std::pair<LatLon, LatLon> bounds() const {
+        return bounds_;
+    }
+
+    std::size_t nodeCount() const {
+        return nodeIDs_.size();
+    }
+
+    std::size_t wayCount() const {
+        return wayIDs_.size();
+    }
+
+    std::size_t relationCount() const {
+        return relationIDs_.size();
+    }
+
+    NodeRef node(unsigned i) const;
+    WayRef way(unsigned i) const;
+    RelationRef relation(unsigned i) const;
+
+    /// ID lookups by binary search; return -1U if not found
+    unsigned nodeIndexFromID(OSMID id) const;
+    unsigned wayIndexFromID(OSMID id) const;
+    unsigned relationIndexFromID(OSMID id) const;
+
+    const FlatKeyValueTable& nodeTags() const {
+        return nodeTags_;
+    }
+
+    const FlatKeyValueTable& wayTags() const {
+        return wayTags_;
+    }
+
+    const FlatKeyValueTable& relationTags() const {
+        return relationTags_;
+    }
+
+    const FlatStringTable& relationRoles() const {
+        return roles_;
+    }
+
+    /// Copies the whole database into a conventional OSMDatabase
+    OSMDatabase toOSMDatabase() const;
+
+private:
+    static unsigned indexFromID(const FlatArray<OSMID>& ids, const FlatArray<std::uint32_t>& order, OSMID id);
+
+    FlatFileReader file_;
+
+    // decoded arrays of a DeltaVarint (or pre-version 3) file (the matching FlatArrays point into them)
+    std::vector<OSMID> decodedNodeIDs_;
+    std::vector<FixedLatLon> decodedNodeCoords_;
+    std::vector<OSMID> decodedWayNdRefs_;
+
+    std::pair<LatLon, LatLon> bounds_;
+
+    FlatArray<OSMID> nodeIDs_;
+    FlatArray<FixedLatLon> nodeCoords_;
+    FlatArray<std::uint64_t> nodeTagOffsets_;
+    FlatArray<FlatTag> nodeTagArray_;
+    FlatArray<std::uint32_t> nodeIDOrder_;
+
+    FlatArray<OSMID> wayIDs_;
+    FlatArray<std::uint64_t> wayNdRefOffsets_;
+    FlatArray<OSMID> wayNdRefs_;
+    FlatArray<std::uint64_t> wayTagOffsets_;
+    FlatArray<FlatTag> wayTagArray_;
+    FlatArray<std::uint32_t> wayIDOrder_;
+
+    FlatArray<OSMID> relationIDs_;
+    FlatArray<std::uint64_t> relationMemberOffsets_;
+    FlatArray<FlatMember> relationMembers_;
+    FlatArray<std::uint64_t> relationTagOffsets_;
+    FlatArray<FlatTag> relationTagArray_;
+    FlatArray<std::uint32_t> relationIDOrder_;
+
+    FlatKeyValueTable nodeTags_;
+    FlatKeyValueTable wayTags_;
+    FlatKeyValueTable relationTags_;
+    FlatStringTable roles_;
+};
+
+/** Writes an OSMDatabase in the flat .osm.bin format. DeltaVarint typically makes the file much smaller (less I/O when
+ * distributing maps) at the cost of decoding those arrays when it is opened.
+ */
+
+void writeFlatOSMDatabase(const OSMDatabase& db, const std::string& fn, OSMBin::Encoding enc = OSMBin::Plain);
+
+/// As above, to a seekable stream (eg. std::ostringstream)
+void writeFlatOSMDatabase(const OSMDatabase& db, std::ostream& os, OSMBin::Encoding enc = OSMBin::Plain);
+
+/// Builds the flat image of db in memory and opens it; the inverse of FlatOSMDatabase::toOSMDatabase
+FlatOSMDatabase toFlatOSMDatabase(const OSMDatabase& db);
+
+#endif /* FLATOSMDATABASE_HPP_ */
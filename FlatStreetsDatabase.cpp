@@ -0,0 +1,269 @@
+/*
+ * FlatStreetsDatabase.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "FlatStreetsDatabase.hpp"
+#include "StreetsDatabase.h"
+
+#include <sstream>
+#include <unordered_map>
+
+using namespace std;
+
+const char FlatStreetsDatabase::s_magic[8] = {'S', 'T', 'R', '2', 'B', 'I', 'N', '\0'};
+constexpr std::uint32_t FlatStreetsDatabase::s_version;
+
+namespace {
+
+void checkCSR(const FlatArray<std::uint64_t>& offsets, std::size_t nRows, std::size_t nElements, const char* what) {
+    if (offsets.size() != nRows + 1 || offsets.back() != nElements)
+        throw std::runtime_error(std::string("FlatStreetsDatabase: inconsistent ") + what + " offsets");
+}
+
+std::string toFlatImage(const StreetsDatabase& sdb) {
+    ostringstream os;
+    writeFlatStreetsDatabase(sdb, os);
+    return os.str();
+}
+
+}
+
+FlatStreetsDatabase::FlatStreetsDatabase(const std::string& fn) :
+file_(fn, s_magic, s_version) {
+    mapSections();
+}
+
+FlatStreetsDatabase::FlatStreetsDatabase(const StreetsDatabase& sdb) :
+file_(toFlatImage(sdb), s_magic, s_version) {
+    mapSections();
+}
+
+void FlatStreetsDatabase::mapSections() {
+    if (file_.version() < s_version)
+        throw std::runtime_error("FlatStreetsDatabase: format version " + std::to_string(file_.version()) +
+            " stores float coordinates; regenerate the .streets.bin with osm2bin");
+
+    intersections_ = file_.section<FlatIntersection>(StreetsBin::Intersections);
+    intersectionSegmentOffsets_ = file_.section<std::uint64_t>(StreetsBin::IntersectionSegmentOffsets);
+    intersectionSegments_ = file_.section<std::uint32_t>(StreetsBin::IntersectionSegments);
+
+    segments_ = file_.section<FlatStreetSegment>(StreetsBin::Segments);
+    curvePointOffsets_ = file_.section<std::uint64_t>(StreetsBin::CurvePointOffsets);
+    curvePoints_ = file_.section<FixedLatLon>(StreetsBin::CurvePoints);
+
+    streets_ = file_.section<std::uint32_t>(StreetsBin::Streets);
+
+    pois_ = file_.section<FlatPOI>(StreetsBin::POIs);
+
+    features_ = file_.section<FlatFeature>(StreetsBin::Features);
+    featurePointOffsets_ = file_.section<std::uint64_t>(StreetsBin::FeaturePointOffsets);
+    featurePoints_ = file_.section<FixedLatLon>(StreetsBin::FeaturePoints);
+
+    strings_ = file_.stringTable(StreetsBin::StringOffsets, StreetsBin::StringChars);
+
+    checkCSR(intersectionSegmentOffsets_, intersections_.size(), intersectionSegments_.size(), "intersection segment");
+    checkCSR(curvePointOffsets_, segments_.size(), curvePoints_.size(), "curve point");
+    checkCSR(featurePointOffsets_, features_.size(), featurePoints_.size(), "feature point");
+}
+
+StreetsDatabase FlatStreetsDatabase::toStreetsDatabase() const {
+    // adding the edges in segment order makes edges(G), and so the street segment indices, come out the same
+    PathNetwork G(intersectionCount());
+
+    for (unsigned i = 0; i < intersectionCount(); ++i) {
+        G[i].osmid = intersections_[i].osmid;
+        G[i].latlon = intersections_[i].latlon;
+    }
+
+    for (unsigned i = 0; i < segmentCount(); ++i) {
+        const FlatStreetSegment& s = segments_[i];
+        const FlatArray<FixedLatLon> pts = curvePoints(i);
+
+        EdgeProperties p;
+        p.curvePoints.assign(pts.begin(), pts.end());
+        p.wayOSMID = s.wayOSMID;
+        p.streetVectorIndex = s.streetID;
+        p.maxspeed = s.maxspeed;
+        p.oneWay = EdgeProperties::Oneway(s.oneWay);
+
+        add_edge(s.from, s.to, std::move(p), G);
+    }
+
+    vector<string> streets;
+    streets.reserve(streetCount());
+    for (unsigned i = 0; i < streetCount(); ++i)
+        streets.push_back(streetName(i).to_string());
+
+    vector<POI> pois;
+    pois.reserve(poiCount());
+    for (const FlatPOI& p : pois_)
+        pois.push_back(POI(p.osmid, p.pos, strings_.at(p.type).to_string(), strings_.at(p.name).to_string()));
+
+    vector<Feature> features;
+    features.reserve(featureCount());
+    for (unsigned i = 0; i < featureCount(); ++i)
+        features.push_back(toFeature(i));
+
+    StreetsDatabase sdb(G, std::move(streets));
+    sdb.pois(std::move(pois));
+    sdb.features(std::move(features));
+    return sdb;
+}
+
+Feature FlatStreetsDatabase::toFeature(unsigned i) const {
+    const FlatFeature& f = feature(i);
+    const FlatArray<FixedLatLon> pts = featurePoints(i);
+    return Feature(
+            f.osmid,
+            OSMEntityType(f.osmType),
+            FeatureType(f.type),
+            strings_.at(f.name).to_string(),
+            vector<FixedLatLon>(pts.begin(), pts.end()),
+            f.bounded != 0);
+}
+
+
+
+namespace {
+
+/// Assigns each distinct string a single index in the output string table
+
+class StringInterner {
+public:
+
+    std::uint32_t operator()(const std::string& s) {
+        const auto p = index_.insert(make_pair(s, std::uint32_t(strings_.size())));
+        if (p.second)
+            strings_.push_back(s);
+        return p.first->second;
+    }
+
+    const vector<string>& strings() const {
+        return strings_;
+    }
+
+private:
+    unordered_map<string, std::uint32_t> index_;
+    vector<string> strings_;
+};
+
+void writeSections(FlatFileWriter& w, const StreetsDatabase& sdb) {
+    const PathNetwork& G = sdb.roads();
+    StringInterner intern;
+
+    // intersections and their incident segments
+    {
+        vector<FlatIntersection> intersections;
+        vector<std::uint64_t> offsets(1, 0);
+        vector<std::uint32_t> segs;
+
+        intersections.reserve(num_vertices(G));
+        offsets.reserve(num_vertices(G) + 1);
+
+        for (const auto v : boost::make_iterator_range(vertices(G))) {
+            intersections.push_back(FlatIntersection{G[v].osmid, G[v].latlon});
+            for (const auto e : out_edges(v, G))
+                segs.push_back(G[e].streetSegmentVectorIndex);
+            offsets.push_back(segs.size());
+        }
+
+        w.addSection(StreetsBin::Intersections, intersections);
+        w.addSection(StreetsBin::IntersectionSegmentOffsets, offsets);
+        w.addSection(StreetsBin::IntersectionSegments, segs);
+    }
+
+    // street segments in index order (the order of edges(G), see StreetsDatabase::buildStreetSegmentVector)
+    {
+        vector<FlatStreetSegment> segments;
+        vector<std::uint64_t> offsets(1, 0);
+        vector<FixedLatLon> curvePoints;
+
+        segments.reserve(num_edges(G));
+        offsets.reserve(num_edges(G) + 1);
+
+        for (const auto e : edges(G)) {
+            const EdgeProperties& ep = G[e];
+            segments.push_back(FlatStreetSegment{
+                ep.wayOSMID,
+                std::uint32_t(source(e, G)),
+                std::uint32_t(target(e, G)),
+                ep.streetVectorIndex,
+                ep.maxspeed,
+                std::uint32_t(ep.oneWay),
+                0});
+
+            curvePoints.insert(curvePoints.end(), ep.curvePoints.begin(), ep.curvePoints.end());
+            offsets.push_back(curvePoints.size());
+        }
+
+        w.addSection(StreetsBin::Segments, segments);
+        w.addSection(StreetsBin::CurvePointOffsets, offsets);
+        w.addSection(StreetsBin::CurvePoints, curvePoints);
+    }
+
+    // streets
+    {
+        vector<std::uint32_t> streets;
+        streets.reserve(sdb.streets().size());
+        for (const auto& s : sdb.streets())
+            streets.push_back(intern(s));
+        w.addSection(StreetsBin::Streets, streets);
+    }
+
+    // points of interest
+    {
+        vector<FlatPOI> pois;
+        pois.reserve(sdb.getNumberOfPOIs());
+        for (unsigned i = 0; i < sdb.getNumberOfPOIs(); ++i) {
+            const POI& p = sdb.poi(i);
+            pois.push_back(FlatPOI{p.osmNodeID(), p.fixedPos(), intern(p.name()), intern(p.type())});
+        }
+        w.addSection(StreetsBin::POIs, pois);
+    }
+
+    // features
+    {
+        vector<FlatFeature> features;
+        vector<std::uint64_t> offsets(1, 0);
+        vector<FixedLatLon> points;
+
+        features.reserve(sdb.getNumberOfFeatures());
+        offsets.reserve(sdb.getNumberOfFeatures() + 1);
+
+        for (unsigned i = 0; i < sdb.getNumberOfFeatures(); ++i) {
+            const Feature& f = sdb.feature(i);
+            features.push_back(FlatFeature{
+                f.id().first,
+                std::uint32_t(f.id().second),
+                std::uint32_t(f.type()),
+                intern(f.name()),
+                f.bounded()});
+
+            points.insert(points.end(), f.fixedPoints().begin(), f.fixedPoints().end());
+            offsets.push_back(points.size());
+        }
+
+        w.addSection(StreetsBin::Features, features);
+        w.addSection(StreetsBin::FeaturePointOffsets, offsets);
+        w.addSection(StreetsBin::FeaturePoints, points);
+    }
+
+    w.addStringTable(StreetsBin::StringOffsets, StreetsBin::StringChars, intern.strings());
+}
+
+}
+
+void writeFlatStreetsDatabase(const StreetsDatabase& sdb, const std::string& fn) {
+    FlatFileWriter w(fn, FlatStreetsDatabase::s_magic, FlatStreetsDatabase::s_version);
+    writeSections(w, sdb);
+    w.close();
+}
+
+void writeFlatStreetsDatabase(const StreetsDatabase& sdb, std::ostream& os) {
+    FlatFileWriter w(os, FlatStreetsDatabase::s_magic, FlatStreetsDatabase::s_version);
+    writeSections(w, sdb);
+    w.close();
+}
@@ -0,0 +1,211 @@
+/*
+ * FlatStreetsDatabase.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef FLATSTREETSDATABASE_HPP_
+#define FLATSTREETSDATABASE_HPP_
+
+#include "FlatFile.hpp"
+#include "LatLon.h"
+#include "OSMEntityType.h"
+#include "Feature.h"
+
+#include <cstdint>
+#include <string>
+
+class StreetsDatabase;
+
+/** Section IDs of the flat .streets.bin format (version 2). Numbers are part of the file format: append, never renumber.
+ *
+ * Intersections (graph vertices) and street segments (graph edges, in street-segment index order) are plain arrays.
+ * The segments incident to each intersection are stored in CSR form, as are segment curve points and feature points.
+ * All strings (street names, POI names & types, feature names) are interned in a single string table.
+ *
+ * Version 2 stores all positions as FixedLatLon (int32 1e-7 degree) where version 1 had float LatLon; the two layouts
+ * are the same size but not interchangeable, so version 1 files are rejected.
+ */
+
+namespace StreetsBin {
+enum Section : std::uint32_t {
+    Intersections = 1,
+    IntersectionSegmentOffsets = 2,
+    IntersectionSegments = 3,
+
+    Segments = 10,
+    CurvePointOffsets = 11,
+    CurvePoints = 12,
+
+    Streets = 20,
+
+    POIs = 30,
+
+    Features = 40,
+    FeaturePointOffsets = 41,
+    FeaturePoints = 42,
+
+    StringOffsets = 50,
+    StringChars = 51
+};
+}
+
+struct FlatIntersection {
+    std::uint64_t osmid;
+    FixedLatLon latlon;
+};
+
+struct FlatStreetSegment {
+    std::uint64_t wayOSMID;
+    std::uint32_t from; // vertices as stored in the graph (not yet swapped for one-way direction)
+    std::uint32_t to;
+    std::uint32_t streetID;
+    float maxspeed;
+    std::uint32_t oneWay; // EdgeProperties::Oneway
+    std::uint32_t reserved;
+};
+
+struct FlatPOI {
+    std::uint64_t osmid;
+    FixedLatLon pos;
+    std::uint32_t name; // string table index
+    std::uint32_t type; // string table index
+};
+
+struct FlatFeature {
+    std::uint64_t osmid;
+    std::uint32_t osmType; // OSMEntityType
+    std::uint32_t type; // FeatureType
+    std::uint32_t name; // string table index
+    std::uint32_t bounded;
+};
+
+/** Read-only streets database used in place from a memory-mapped flat .streets.bin file.
+ *
+ * Opening validates the section table only; queries index directly into the mapping so there is no deserialization or
+ * per-edge allocation on load.
+ */
+
+class FlatStreetsDatabase {
+public:
+    static const char s_magic[8];
+    static constexpr std::uint32_t s_version = 2;
+
+    FlatStreetsDatabase() {
+    }
+
+    explicit FlatStreetsDatabase(const std::string& fn);
+
+    /// Converts an in-memory StreetsDatabase (eg. loaded from a legacy Boost-serialized file)
+    explicit FlatStreetsDatabase(const StreetsDatabase& sdb);
+
+    FlatStreetsDatabase(FlatStreetsDatabase&&) = default;
+    FlatStreetsDatabase& operator=(FlatStreetsDatabase&&) = default;
+
+    // intersections
+
+    std::size_t intersectionCount() const {
+        return intersections_.size();
+    }
+
+    const FlatIntersection& intersection(unsigned i) const {
+        return intersections_.at(i);
+    }
+
+    /// Street segment indices incident to intersection i, in graph out-edge order
+    FlatArray<std::uint32_t> intersectionSegments(unsigned i) const {
+        return intersectionSegments_.slice(intersectionSegmentOffsets_.at(i), intersectionSegmentOffsets_.at(i + 1));
+    }
+
+    // street segments
+
+    std::size_t segmentCount() const {
+        return segments_.size();
+    }
+
+    const FlatStreetSegment& segment(unsigned i) const {
+        return segments_.at(i);
+    }
+
+    FlatArray<FixedLatLon> curvePoints(unsigned i) const {
+        return curvePoints_.slice(curvePointOffsets_.at(i), curvePointOffsets_.at(i + 1));
+    }
+
+    // streets
+
+    std::size_t streetCount() const {
+        return streets_.size();
+    }
+
+    boost::string_ref streetName(unsigned i) const {
+        return strings_.at(streets_.at(i));
+    }
+
+    // points of interest
+
+    std::size_t poiCount() const {
+        return pois_.size();
+    }
+
+    const FlatPOI& poi(unsigned i) const {
+        return pois_.at(i);
+    }
+
+    // features
+
+    std::size_t featureCount() const {
+        return features_.size();
+    }
+
+    const FlatFeature& feature(unsigned i) const {
+        return features_.at(i);
+    }
+
+    FlatArray<FixedLatLon> featurePoints(unsigned i) const {
+        return featurePoints_.slice(featurePointOffsets_.at(i), featurePointOffsets_.at(i + 1));
+    }
+
+    /// Copies a feature out into the conventional (heap-allocated) Feature type
+    Feature toFeature(unsigned i) const;
+
+    /** Copies the whole database into a conventional StreetsDatabase, rebuilding the road network graph (eg. to patch it
+     * with updateNetwork); street segment indices are preserved
+     */
+    StreetsDatabase toStreetsDatabase() const;
+
+    /// Interned string table (street, POI, and feature names)
+    const FlatStringTable& strings() const {
+        return strings_;
+    }
+
+private:
+    void mapSections();
+
+    FlatFileReader file_;
+
+    FlatArray<FlatIntersection> intersections_;
+    FlatArray<std::uint64_t> intersectionSegmentOffsets_;
+    FlatArray<std::uint32_t> intersectionSegments_;
+
+    FlatArray<FlatStreetSegment> segments_;
+    FlatArray<std::uint64_t> curvePointOffsets_;
+    FlatArray<FixedLatLon> curvePoints_;
+
+    FlatArray<std::uint32_t> streets_;
+
+    FlatArray<FlatPOI> pois_;
+
+    FlatArray<FlatFeature> features_;
+    FlatArray<std::uint64_t> featurePointOffsets_;
+    FlatArray<FixedLatLon> featurePoints_;
+
+    FlatStringTable strings_;
+};
+
+/** Writes a StreetsDatabase in the flat .streets.bin format */
+
+void writeFlatStreetsDatabase(const StreetsDatabase& sdb, const std::string& fn);
+void writeFlatStreetsDatabase(const StreetsDatabase& sdb, std::ostream& os);
+
+#endif /* FLATSTREETSDATABASE_HPP_ */
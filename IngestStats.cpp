@@ -0,0 +1,284 @@
+/*
+ * IngestStats.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "IngestStats.hpp"
+#include "OSMTagFilter.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <sys/resource.h>
+
+using namespace std;
+
+namespace {
+
+const char* entityNames[4] = { "invalid", "node", "way", "relation" };
+
+/// Reads a "Key:   N kB" line from /proc/self/status, returning bytes (0 if unavailable)
+uint64_t procStatusBytes(const char* key)
+{
+	ifstream is("/proc/self/status");
+	string line;
+	const size_t n = strlen(key);
+
+	while(getline(is,line))
+		if (line.compare(0,n,key) == 0 && line.size() > n && line[n] == ':')
+			return stoull(line.substr(n+1))*1024;
+	return 0;
+}
+
+uint64_t peakRSS()
+{
+	if (uint64_t hwm = procStatusBytes("VmHWM"))
+		return hwm;
+
+	rusage ru;
+	getrusage(RUSAGE_SELF,&ru);
+	return uint64_t(ru.ru_maxrss)*1024;				// kB on Linux
+}
+
+/// Resets the peak RSS to the current RSS (Linux >= 4.0); harmless elsewhere
+void resetPeakRSS()
+{
+	ofstream os("/proc/self/clear_refs");
+	os << "5";
+}
+
+void writeString(ostream& os,const string& s)
+{
+	os << '"';
+	for(const char c : s)
+		if (c == '"' || c == '\\')
+			os << '\\' << c;
+		else if ((unsigned char)c < 0x20)
+			os << "\\u" << hex << setw(4) << setfill('0') << unsigned(c) << dec << setfill(' ');
+		else
+			os << c;
+	os << '"';
+}
+
+double rate(uint64_t n,double s)
+{
+	return s > 0.0 ? double(n)/s : 0.0;
+}
+
+}
+
+IngestStats::IngestStats() :
+	m_start(chrono::steady_clock::now())
+{
+	for(auto& e : m_elements)
+		e = 0;
+}
+
+IngestStats::~IngestStats()
+{
+	stopProgress();
+}
+
+IngestStats::Counters IngestStats::now() const
+{
+	Counters c;
+	c.seconds = chrono::duration<double>(chrono::steady_clock::now()-m_start).count();
+	c.inputBytes = inputBytes;
+	c.decompressedBytes = decompressedBytes;
+	for(unsigned t=0;t<4;++t)
+		c.elements[t] = m_elements[t];
+	return c;
+}
+
+void IngestStats::addTagKey(OSMEntityType t,const OSMTagKeyClassifier& c,boost::string_ref k,std::uint64_t count)
+{
+	const unsigned r = c.rule(k);
+
+	lock_guard<mutex> L(m_mutex);
+	if (m_phases.empty())
+	{
+		m_phases.emplace_back();
+		m_phases.back().name = "ingest";
+		m_inPhase = true;
+	}
+	TagRuleCount& rc = m_phases.back().tagRules[t][c.ruleName(r)];
+
+	rc.keys++;
+	(c.ruleKeeps(r) ? rc.kept : rc.ignored) += count;
+}
+
+void IngestStats::beginPhase(const std::string name)
+{
+	lock_guard<mutex> L(m_mutex);
+	if (m_phaseHeld)
+		return;
+
+	endPhase_();
+	resetPeakRSS();
+
+	m_phases.emplace_back();
+	m_phases.back().name = name;
+	m_phases.back().begin = now();
+	m_inPhase = true;
+}
+
+void IngestStats::endPhase()
+{
+	lock_guard<mutex> L(m_mutex);
+	if (!m_phaseHeld)
+		endPhase_();
+}
+
+void IngestStats::holdPhase(const std::string name)
+{
+	beginPhase(name);
+
+	lock_guard<mutex> L(m_mutex);
+	m_phaseHeld = true;
+}
+
+void IngestStats::releasePhase()
+{
+	lock_guard<mutex> L(m_mutex);
+	m_phaseHeld = false;
+	endPhase_();
+}
+
+void IngestStats::endPhase_()
+{
+	if (!m_inPhase)
+		return;
+
+	m_phases.back().end = now();
+	m_phases.back().peakRSS = peakRSS();
+	m_inPhase = false;
+}
+
+void IngestStats::startProgress(std::ostream& os,double interval)
+{
+	stopProgress();
+
+	m_stopProgress = false;
+	m_progress = thread([this,&os,interval]()
+	{
+		unique_lock<mutex> L(m_mutex);
+		while(!m_progressCV.wait_for(L,chrono::duration<double>(interval),[this]{ return m_stopProgress; }))
+		{
+			L.unlock();
+			printProgress(os);
+			L.lock();
+		}
+	});
+}
+
+void IngestStats::stopProgress()
+{
+	if (!m_progress.joinable())
+		return;
+
+	{
+		lock_guard<mutex> L(m_mutex);
+		m_stopProgress = true;
+	}
+	m_progressCV.notify_all();
+	m_progress.join();
+}
+
+void IngestStats::printProgress(std::ostream& os) const
+{
+	const Counters c = now();
+	string phase;
+	{
+		lock_guard<mutex> L(m_mutex);
+		if (m_inPhase)
+			phase = m_phases.back().name;
+	}
+
+	stringstream ss;
+	ss << fixed << setprecision(1);
+	ss << "[" << setw(7) << c.seconds << " s" << (phase.empty() ? "" : " " + phase) << "] read " << c.inputBytes*1e-6 << " MB, "
+		<< "decompressed " << c.decompressedBytes*1e-6 << " MB (" << rate(c.decompressedBytes,c.seconds)*1e-6 << " MB/s)";
+
+	for(unsigned t=Node;t<=Relation;++t)
+		ss << ", " << c.elements[t] << ' ' << entityNames[t] << "s";
+
+	ss << ", RSS " << procStatusBytes("VmRSS")*1e-6 << " MB" << endl;
+
+	os << ss.str() << flush;
+}
+
+void IngestStats::writeJSON(std::ostream& os)
+{
+	lock_guard<mutex> L(m_mutex);
+	m_phaseHeld = false;
+	endPhase_();
+	const Counters c = now();
+
+	// element counts, or rates if seconds is given
+	auto writeElements = [&os](const char* name,const uint64_t* e,double seconds)
+	{
+		os << "\"" << name << "\": { ";
+		for(unsigned t=Node;t<=Relation;++t)
+		{
+			os << (t == Node ? "" : ", ") << "\"" << entityNames[t] << "\": ";
+			if (seconds < 0)
+				os << e[t];
+			else
+				os << rate(e[t],seconds);
+		}
+		os << " }";
+	};
+
+	os << setprecision(6) << "{" << endl;
+	os << "  \"seconds\": " << c.seconds << "," << endl;
+	os << "  \"inputBytes\": " << c.inputBytes << "," << endl;
+	os << "  \"decompressedBytes\": " << c.decompressedBytes << "," << endl;
+	os << "  "; writeElements("elements",c.elements,-1); os << "," << endl;
+	os << "  \"peakRSSBytes\": " << peakRSS() << "," << endl;
+
+	os << "  \"phases\": [";
+	for(size_t i=0;i<m_phases.size();++i)
+	{
+		const Phase& p = m_phases[i];
+		const double s = p.end.seconds-p.begin.seconds;
+		uint64_t e[4];
+		for(unsigned t=0;t<4;++t)
+			e[t] = p.end.elements[t]-p.begin.elements[t];
+
+		os << (i ? "," : "") << endl << "    { \"name\": "; writeString(os,p.name);
+		os << ", \"seconds\": " << s
+			<< ", \"inputBytes\": " << p.end.inputBytes-p.begin.inputBytes
+			<< ", \"decompressedBytes\": " << p.end.decompressedBytes-p.begin.decompressedBytes
+			<< ", \"peakRSSBytes\": " << p.peakRSS << "," << endl << "      ";
+		writeElements("elements",e,-1);
+		os << ", ";
+		writeElements("elementsPerSecond",e,s);
+		os << "," << endl << "      \"tagRules\": {";
+
+		for(unsigned t=Node;t<=Relation;++t)
+		{
+			os << (t == Node ? "" : ",") << endl << "        \"" << entityNames[t] << "\": [";
+			bool first=true;
+			for(const auto& r : p.tagRules[t])
+			{
+				os << (first ? "" : ",") << endl << "          { \"rule\": "; writeString(os,r.first);
+				os << ", \"keys\": " << r.second.keys << ", \"kept\": " << r.second.kept << ", \"ignored\": " << r.second.ignored << " }";
+				first = false;
+			}
+			os << (first ? "" : "\n        ") << "]";
+		}
+		os << " } }";
+	}
+	os << endl << "  ]" << endl << "}" << endl;
+}
+
+IngestStats& ingestStats()
+{
+	static IngestStats s;
+	return s;
+}
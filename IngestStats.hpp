@@ -0,0 +1,121 @@
+/*
+ * IngestStats.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef INGESTSTATS_HPP_
+#define INGESTSTATS_HPP_
+
+#include "OSMEntityType.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/utility/string_ref.hpp>
+
+class OSMTagKeyClassifier;
+
+/** Process-wide ingest counters, fed by the parsers and decompressors and reported by osm2bin.
+ *
+ *   inputBytes         bytes read from the input file or pipe (compressed size)
+ *   decompressedBytes  bytes handed to the XML parser/tokenizer, or PBF block payload after decompression
+ *   elements           nodes/ways/relations parsed, before any retention predicate or clipping
+ *   tag rules          tag occurrences kept/ignored, by the filter rule which decided their key (OSMTagKeyClassifier)
+ *
+ * The byte & element counters are atomics updated in batches (per buffer, block or shard), so they can be read at any
+ * time by the progress thread. Tag counts are added once per distinct key at the end of a parse.
+ *
+ * Phases (beginPhase) split the run into named stages, each recording its wall time, counter deltas, tag rule counts
+ * (so the two passes of a ReferencedNodes load are kept apart) and peak resident set size. The peak is reset at the
+ * start of each phase where Linux allows it (/proc/self/clear_refs), otherwise it is the process peak so far.
+ */
+
+class IngestStats
+{
+public:
+	IngestStats();
+	~IngestStats();
+
+	std::atomic<std::uint64_t> 	inputBytes{0};
+	std::atomic<std::uint64_t> 	decompressedBytes{0};
+
+	void addElements(OSMEntityType t,std::uint64_t n=1){ m_elements[t].fetch_add(n,std::memory_order_relaxed); }
+	std::uint64_t elements(OSMEntityType t) const { return m_elements[t]; }
+
+	/** Attributes count occurrences of tag key k on entities of type t to the rule of c which decides k, in the current
+	 * phase (or the last one, or a new "ingest" phase if there is none)
+	 */
+	void addTagKey(OSMEntityType t,const OSMTagKeyClassifier& c,boost::string_ref k,std::uint64_t count);
+
+	/// Ends the current phase (if any) and starts a new one
+	void beginPhase(const std::string name);
+	void endPhase();
+
+	/// Begins phase name and holds it, ignoring beginPhase/endPhase until releasePhase (eg. while loads run concurrently)
+	void holdPhase(const std::string name);
+	void releasePhase();
+
+	/// Prints a progress line to os every interval seconds on a background thread, until stopProgress
+	void startProgress(std::ostream& os,double interval);
+	void stopProgress();
+
+	void printProgress(std::ostream& os) const;
+
+	/// Writes all counters, phases and tag rule counts as a JSON object (ends the current phase)
+	void writeJSON(std::ostream& os);
+
+private:
+	struct Counters
+	{
+		double 			seconds=0.0;
+		std::uint64_t 	inputBytes=0;
+		std::uint64_t 	decompressedBytes=0;
+		std::uint64_t 	elements[4]={};
+	};
+
+	struct TagRuleCount
+	{
+		std::uint64_t 	keys=0;
+		std::uint64_t 	kept=0;
+		std::uint64_t 	ignored=0;
+	};
+
+	struct Phase
+	{
+		std::string 							name;
+		Counters 								begin;
+		Counters 								end;
+		std::uint64_t 							peakRSS=0;			// bytes
+		std::map<std::string,TagRuleCount> 		tagRules[4];		// by entity type, rule name
+	};
+
+	Counters now() const;
+	void endPhase_();				// requires m_mutex
+
+	std::atomic<std::uint64_t> 						m_elements[4];
+	std::chrono::steady_clock::time_point 			m_start;
+
+	mutable std::mutex 								m_mutex;			// guards everything below
+	std::vector<Phase> 								m_phases;
+	bool 											m_inPhase=false;
+	bool 											m_phaseHeld=false;
+
+	std::thread 									m_progress;
+	std::condition_variable 						m_progressCV;
+	bool 											m_stopProgress=false;
+};
+
+/// The process-wide instance
+IngestStats& ingestStats();
+
+#endif /* INGESTSTATS_HPP_ */
@@ -0,0 +1,409 @@
+/*
+ * InputFormat.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "InputFormat.hpp"
+#include "FlatOSMDatabase.hpp"
+#include "IngestStats.hpp"
+#include "ParallelDecompressor.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/iostreams/filter/gzip.hpp>
+
+#ifndef NO_BZIP2
+#include <boost/iostreams/filter/bzip2.hpp>
+#endif
+
+#ifndef NO_ZSTD
+#include <boost/iostreams/filter/zstd.hpp>
+#endif
+
+#ifndef NO_LZMA
+#include <boost/iostreams/filter/lzma.hpp>
+#endif
+
+#ifndef NO_LZ4
+#include <lz4frame.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+bool startsWith(const unsigned char* p,size_t n,const char* magic,size_t m)
+{
+	return n >= m && memcmp(p,magic,m) == 0;
+}
+
+/// Standard input is process-wide, as is what has been read from it ahead of the reader
+struct StdinState
+{
+	bool 			formatGiven=false;
+	InputFormat 	format;
+
+	string 			probe;				// leading bytes read by detectInputFormat, not yet replayed
+	size_t 			probePos=0;
+	bool 			probed=false;
+	bool 			eof=false;
+};
+
+StdinState& stdinState()
+{
+	static StdinState s;
+	return s;
+}
+
+/// Reads up to n bytes from standard input; returns 0 only at end of input
+size_t readStdin(char* s,size_t n)
+{
+	while(true)
+	{
+		ssize_t N = ::read(0,s,n);
+		if (N >= 0)
+			return N;
+		else if (errno != EINTR)
+			throw std::ios_base::failure(string("Failed to read standard input: ") + strerror(errno));
+	}
+}
+
+/// Pass-through filter placed on the file or pipe, counting bytes read into IngestStats::inputBytes
+class InputByteCounter
+{
+public:
+	typedef char 											char_type;
+	typedef boost::iostreams::multichar_input_filter_tag 	category;
+
+	template<class Source>std::streamsize read(Source& src,char* s,std::streamsize n)
+	{
+		const std::streamsize N = boost::iostreams::read(src,s,n);
+		if (N > 0)
+			ingestStats().inputBytes += N;
+		return N;
+	}
+};
+
+#ifndef NO_LZ4
+
+/** Boost.Iostreams input filter decoding the LZ4 frame format (as written by the lz4 tool), including concatenated
+ * frames. Copies share the decoder state, since the filter chain copies the filter when it is pushed.
+ */
+
+class Lz4Decompressor
+{
+public:
+	typedef char 										char_type;
+	typedef boost::iostreams::multichar_input_filter_tag 	category;
+
+	Lz4Decompressor() : m_state(make_shared<State>()){}
+
+	template<class Source>std::streamsize read(Source& src,char* s,std::streamsize n)
+	{
+		State& st = *m_state;
+		std::streamsize out=0;
+
+		while(out < n)
+		{
+			if (st.pos == st.end && !st.eof)
+			{
+				std::streamsize N = boost::iostreams::read(src,st.in.data(),st.in.size());
+				st.eof = N <= 0;
+				st.pos = 0;
+				st.end = max(N,std::streamsize(0));
+			}
+
+			size_t dstSize = n-out, srcSize = st.end-st.pos;
+			size_t r = LZ4F_decompress(st.ctx,s+out,&dstSize,st.in.data()+st.pos,&srcSize,nullptr);
+
+			if (LZ4F_isError(r))
+				throw std::ios_base::failure(string("LZ4 decompression failed: ") + LZ4F_getErrorName(r));
+
+			st.pos += srcSize;
+			out += dstSize;
+
+			if (srcSize || dstSize)
+				st.frameDone = r == 0;
+			else if (st.eof)
+			{
+				if (!st.frameDone)
+					throw std::ios_base::failure("LZ4 decompression failed: truncated frame");
+				break;
+			}
+		}
+
+		return out == 0 && n > 0 ? -1 : out;
+	}
+
+private:
+	struct State
+	{
+		State() : in(1 << 16)
+		{
+			if (LZ4F_isError(LZ4F_createDecompressionContext(&ctx,LZ4F_VERSION)))
+				throw runtime_error("Failed to create LZ4 decompression context");
+		}
+		~State(){ LZ4F_freeDecompressionContext(ctx); }
+
+		LZ4F_dctx* 			ctx=nullptr;
+		vector<char> 		in;
+		std::streamsize 	pos=0;
+		std::streamsize 	end=0;
+		bool 				eof=false;
+		bool 				frameDone=true;		// no partial frame pending
+	};
+
+	shared_ptr<State> m_state;
+};
+
+#endif
+
+}
+
+InputFormat detectInputFormat(const char* buf,std::size_t n)
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(buf);
+	InputFormat f;
+
+	if (startsWith(p,n,"\x1f\x8b",2))
+		f.compression = Compression::Gzip;
+	else if (startsWith(p,n,"BZh",3) && n >= 4 && '1' <= p[3] && p[3] <= '9')
+		f.compression = Compression::Bzip2;
+	else if (startsWith(p,n,"\x28\xb5\x2f\xfd",4) || (n >= 4 && (p[0] & 0xf0) == 0x50 && startsWith(p+1,n-1,"\x2a\x4d\x18",3)))
+		f.compression = Compression::Zstd;			// frame or skippable frame
+	else if (startsWith(p,n,"\xfd" "7zXZ\0",6))
+		f.compression = Compression::Xz;
+	else if (startsWith(p,n,"\x04\x22\x4d\x18",4))
+		f.compression = Compression::Lz4;
+
+	if (f.compression != Compression::None)
+		f.content = OSMContent::XML;
+	else if (startsWith(p,n,FlatOSMDatabase::s_magic,sizeof(FlatOSMDatabase::s_magic)))
+		f.content = OSMContent::FlatBin;
+	// 4B big-endian BlobHeader length, then BlobHeader field 1 (type) = string of length 9 "OSMHeader"
+	else if (n >= 15 && startsWith(p+4,n-4,"\x0a\x09OSMHeader",11))
+		f.content = OSMContent::PBF;
+	// Boost text or binary archive; the signature follows a length field
+	else if (search(buf,buf+min(n,size_t(32)),"serialization::archive","serialization::archive"+22) != buf+min(n,size_t(32)))
+		f.content = OSMContent::LegacyBin;
+	else
+	{
+		size_t i = startsWith(p,n,"\xef\xbb\xbf",3) ? 3 : 0;		// UTF-8 byte-order mark
+		while(i < n && (p[i] == ' ' || p[i] == '\t' || p[i] == '\r' || p[i] == '\n'))
+			++i;
+		if (i < n && p[i] == '<')
+			f.content = OSMContent::XML;
+	}
+
+	return f;
+}
+
+InputFormat detectInputFormat(const std::string fn)
+{
+	if (isStdin(fn))
+	{
+		StdinState& st = stdinState();
+
+		if (st.formatGiven)
+			return st.format;
+
+		if (!st.probed)
+		{
+			// a pipe may deliver fewer bytes per read
+			st.probe.resize(inputFormatProbeSize);
+			size_t n=0;
+			for(size_t N=1; N && n < st.probe.size(); n += N)
+				N = readStdin(&st.probe[n],st.probe.size()-n);
+			st.probe.resize(n);
+			st.probed = true;
+			st.eof = n < inputFormatProbeSize;
+		}
+		return detectInputFormat(st.probe.data(),st.probe.size());
+	}
+
+	ifstream is(fn.c_str(),ios_base::in | ios_base::binary);
+	if (!is.good())
+		throw runtime_error("Failed to open " + fn);
+
+	char buf[inputFormatProbeSize];
+	is.read(buf,inputFormatProbeSize);
+
+	return detectInputFormat(buf,is.gcount());
+}
+
+void setStdinFormat(InputFormat f)
+{
+	stdinState().formatGiven = true;
+	stdinState().format = f;
+}
+
+InputFormat parseInputFormatName(const std::string s)
+{
+	const string n = s.compare(0,4,"osm.") == 0 && s != "osm.pbf" ? s.substr(4) : s;
+	InputFormat f;
+	f.content = OSMContent::XML;
+
+	if (n == "osm")
+		f.compression = Compression::None;
+	else if (n == "gz")
+		f.compression = Compression::Gzip;
+	else if (n == "bz2")
+		f.compression = Compression::Bzip2;
+	else if (n == "zst")
+		f.compression = Compression::Zstd;
+	else if (n == "xz")
+		f.compression = Compression::Xz;
+	else if (n == "lz4")
+		f.compression = Compression::Lz4;
+	else if (n == "pbf" || n == "osm.pbf")
+		f.content = OSMContent::PBF;
+	else
+		throw runtime_error("Unknown input format '" + s + "' (expecting osm, osm.gz, osm.bz2, osm.zst, osm.xz, osm.lz4 or osm.pbf)");
+
+	return f;
+}
+
+const char* compressionName(Compression c)
+{
+	switch(c)
+	{
+	case Compression::None: 	return "none";
+	case Compression::Gzip: 	return "gzip";
+	case Compression::Bzip2: 	return "bzip2";
+	case Compression::Zstd: 	return "zstd";
+	case Compression::Xz: 		return "xz";
+	case Compression::Lz4: 		return "lz4";
+	default: 					return "(unknown)";
+	}
+}
+
+const char* contentName(OSMContent c)
+{
+	switch(c)
+	{
+	case OSMContent::XML: 		return "OSM XML";
+	case OSMContent::PBF: 		return "OSM PBF";
+	case OSMContent::FlatBin: 	return "flat .osm.bin";
+	case OSMContent::LegacyBin: return "legacy (Boost archive) .osm.bin";
+	default: 					return "unknown";
+	}
+}
+
+void pushDecompressor(boost::iostreams::filtering_streambuf<boost::iostreams::input>& sb,Compression c)
+{
+	const char* disabled=nullptr;
+
+	switch(c)
+	{
+	case Compression::None:
+		break;
+
+	case Compression::Gzip:
+		sb.push(boost::iostreams::gzip_decompressor());
+		break;
+
+	case Compression::Bzip2:
+#ifndef NO_BZIP2
+		sb.push(boost::iostreams::bzip2_decompressor());
+#else
+		disabled = "NO_BZIP2";
+#endif
+		break;
+
+	case Compression::Zstd:
+#ifndef NO_ZSTD
+		sb.push(boost::iostreams::zstd_decompressor());
+#else
+		disabled = "NO_ZSTD";
+#endif
+		break;
+
+	case Compression::Xz:
+#ifndef NO_LZMA
+		sb.push(boost::iostreams::lzma_decompressor());
+#else
+		disabled = "NO_LZMA";
+#endif
+		break;
+
+	case Compression::Lz4:
+#ifndef NO_LZ4
+		sb.push(Lz4Decompressor());
+#else
+		disabled = "NO_LZ4";
+#endif
+		break;
+	}
+
+	if (disabled)
+		throw runtime_error(string("Input is ") + compressionName(c) + "-compressed but support was not built in (" + disabled + ")");
+}
+
+
+
+std::streamsize StdinSource::read(char* s,std::streamsize n)
+{
+	StdinState& st = stdinState();
+	size_t N=0;
+
+	if (st.probePos < st.probe.size())
+	{
+		N = min(size_t(n),st.probe.size()-st.probePos);
+		memcpy(s,st.probe.data()+st.probePos,N);
+		st.probePos += N;
+	}
+	else if (!st.eof)
+	{
+		N = readStdin(s,n);
+		st.eof = N == 0;
+	}
+
+	return N == 0 && n > 0 ? -1 : std::streamsize(N);
+}
+
+
+
+DecompressingReader::DecompressingReader(const std::string fn,Compression c,unsigned nThreads)
+{
+	if (isStdin(fn))
+	{
+		pushDecompressor(m_stream,c);
+		m_stream.push(InputByteCounter());
+		m_stream.push(StdinSource(),inputReadSize);
+	}
+	else if (nThreads != 1 && (c == Compression::Bzip2 ||
+			(c == Compression::Gzip && ParallelDecompressor::hasGzipSplitPoints(fn))))
+		m_parallel.reset(new ParallelDecompressor(
+				fn,
+				c == Compression::Gzip ? ParallelDecompressor::Gzip : ParallelDecompressor::Bzip2,
+				nThreads));
+	else
+	{
+		pushDecompressor(m_stream,c);
+		m_stream.push(InputByteCounter());
+
+		m_is.open(fn.c_str(),ios_base::in | ios_base::binary);
+		if (!m_is.good())
+			throw runtime_error("Failed to open " + fn);
+		m_stream.push(m_is,inputReadSize);
+	}
+}
+
+DecompressingReader::~DecompressingReader()
+{
+}
+
+std::size_t DecompressingReader::read(char* dst,std::size_t n)
+{
+	const std::size_t N = m_parallel ? m_parallel->read(dst,n) : std::size_t(m_stream.sgetn(dst,n));
+	ingestStats().decompressedBytes += N;
+	return N;
+}
@@ -0,0 +1,130 @@
+/*
+ * InputFormat.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef INPUTFORMAT_HPP_
+#define INPUTFORMAT_HPP_
+
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <boost/iostreams/categories.hpp>
+#include <boost/iostreams/filtering_streambuf.hpp>
+
+class ParallelDecompressor;
+
+/** Input format as detected from the first bytes of a file, so that loadOSM and the parsers do not depend on its name.
+ *
+ * Compressed files are assumed to hold OSM XML (PBF blocks carry their own compression).
+ */
+
+enum class Compression { None, Gzip, Bzip2, Zstd, Xz, Lz4 };
+
+enum class OSMContent { Unknown, XML, PBF, FlatBin, LegacyBin };
+
+struct InputFormat
+{
+	Compression 	compression=Compression::None;
+	OSMContent 		content=OSMContent::Unknown;
+};
+
+/// Number of leading bytes examined by detectInputFormat
+constexpr std::size_t inputFormatProbeSize = 64;
+
+/// Size of the reads issued to the file or pipe underneath a decompressor
+constexpr std::size_t inputReadSize = std::size_t(1) << 20;
+
+/// Classifies a buffer holding (up to inputFormatProbeSize) leading bytes of an input
+InputFormat detectInputFormat(const char* p,std::size_t n);
+
+/** Classifies a file by its leading bytes; throws std::runtime_error if it cannot be read. The name "-" is standard
+ * input, whose leading bytes are kept to be replayed by StdinSource (unless setStdinFormat was called).
+ */
+InputFormat detectInputFormat(const std::string fn);
+
+/// True if fn names standard input ("-")
+inline bool isStdin(const std::string& fn){ return fn == "-"; }
+
+/// Declares the format of standard input (eg. given by a command-line flag) so that it is not detected
+void setStdinFormat(InputFormat f);
+
+/** Parses a format name as given on the command line: osm, osm.gz, osm.bz2, osm.zst, osm.xz, osm.lz4 or osm.pbf (leading
+ * "osm." optional for the compressed ones); throws std::runtime_error for anything else.
+ */
+InputFormat parseInputFormatName(const std::string s);
+
+const char* compressionName(Compression c);
+const char* contentName(OSMContent c);
+
+/** Pushes the decompressor for c onto the filter chain (nothing for Compression::None); throws std::runtime_error if
+ * support for c was not compiled in (NO_BZIP2, NO_ZSTD, NO_LZMA, NO_LZ4).
+ */
+void pushDecompressor(boost::iostreams::filtering_streambuf<boost::iostreams::input>& sb,Compression c);
+
+
+
+/** Boost.Iostreams Source reading standard input with large read() calls, first replaying any bytes examined by
+ * detectInputFormat("-"). Standard input can be consumed only once, so there should be one such reader.
+ */
+
+class StdinSource
+{
+public:
+	typedef char 							char_type;
+	typedef boost::iostreams::source_tag 	category;
+
+	std::streamsize read(char* s,std::streamsize n);
+};
+
+
+
+/** Sequential reader which decompresses a file (or standard input, "-") as given.
+ *
+ * bzip2 and multi-member gzip files run on a ParallelDecompressor worker pool unless nThreads == 1 (nThreads=0 ->
+ * hardware concurrency); the other formats, standard input (which cannot be mapped), single-member gzip and
+ * gzip/bzip2 with nThreads == 1 go through a single-threaded Boost.Iostreams filter chain, which reads inputReadSize bytes at a time.
+ *
+ * Bytes read and delivered are added to ingestStats() (inputBytes, decompressedBytes).
+ */
+
+class DecompressingReader
+{
+public:
+	DecompressingReader(const std::string fn,Compression c,unsigned nThreads=0);
+	~DecompressingReader();
+
+	/// Reads up to n bytes into dst, returning fewer only at end of input
+	std::size_t read(char* dst,std::size_t n);
+
+private:
+	std::unique_ptr<ParallelDecompressor> 								m_parallel;
+	std::ifstream 														m_is;
+	boost::iostreams::filtering_streambuf<boost::iostreams::input> 		m_stream;
+};
+
+/// Boost.Iostreams Source adaptor so that the reader can be used where BoostInputStream expects a stream
+class DecompressingReaderSource
+{
+public:
+	typedef char 							char_type;
+	typedef boost::iostreams::source_tag 	category;
+
+	DecompressingReaderSource(){}
+	explicit DecompressingReaderSource(const std::shared_ptr<DecompressingReader>& r) : m_reader(r){}
+
+	std::streamsize read(char* s,std::streamsize n)
+	{
+		std::size_t N = m_reader->read(s,n);
+		return N == 0 && n > 0 ? -1 : std::streamsize(N);
+	}
+
+private:
+	std::shared_ptr<DecompressingReader> m_reader;
+};
+
+#endif /* INPUTFORMAT_HPP_ */
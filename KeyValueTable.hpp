@@ -19,24 +19,30 @@
 class KeyValueTable {
 public:
 
-    unsigned addKey(const std::string k) {
+    KeyValueTable() {
+    }
+
+    KeyValueTable(ValueTable&& keys, ValueTable&& values) : keys_(std::move(keys)), values_(std::move(values)) {
+    }
+
+    unsigned addKey(boost::string_ref k) {
         return keys_.addValue(k);
     }
 
-    unsigned addValue(const std::string v) {
+    unsigned addValue(boost::string_ref v) {
         return values_.addValue(v);
     }
 
-    const std::string& getKey(unsigned ki) const {
+    boost::string_ref getKey(unsigned ki) const {
         return keys_.getValue(ki);
     }
 
-    const std::string& getValue(unsigned vi) const {
+    boost::string_ref getValue(unsigned vi) const {
         return values_.getValue(vi);
     }
 
     std::pair<std::string, std::string> getKeyValue(std::pair<unsigned, unsigned> p) const {
-        return std::make_pair(keys_.getValue(p.first), values_.getValue(p.second));
+        return std::make_pair(keys_.getValue(p.first).to_string(), values_.getValue(p.second).to_string());
     }
 
     bool keyValid(unsigned ki) const {
@@ -47,40 +53,56 @@ public:
         return values_.valueValid(vi);
     }
 
-    unsigned getIndexForKeyString(const std::string s) const {
+    /// Constant-time (hashed) lookups of a string's index; -1U if absent
+
+    unsigned getIndexForKeyString(boost::string_ref s) const {
         return keys_.getIndexOfValue(s);
     }
 
-    unsigned getIndexForValueString(const std::string s) const {
+    unsigned getIndexForValueString(boost::string_ref s) const {
         return values_.getIndexOfValue(s);
     }
 
-    std::function<const std::string&(unsigned) > keyLookup() const {
-        return [this](unsigned i) {
-            return cref(keys_.getValue(i));
-        };
+    std::function<boost::string_ref(unsigned) > keyLookup() const {
+        return keys_.valueLookup();
     }
 
-    std::function<const std::string&(unsigned) > valueLookup() const {
-        return [this](unsigned i) {
-            return cref(values_.getValue(i));
-        };
+    std::function<boost::string_ref(unsigned) > valueLookup() const {
+        return values_.valueLookup();
     }
 
-    std::function<std::pair<const std::string&, const std::string&>(std::pair<unsigned, unsigned>) > pairLookup() const {
+    std::function<std::pair<boost::string_ref, boost::string_ref>(std::pair<unsigned, unsigned>) > pairLookup() const {
         return [this](const std::pair<unsigned, unsigned> p) {
-            return std::make_pair(cref(keys_.getValue(p.first)), cref(values_.getValue(p.second)));
+            return std::make_pair(keys_.getValue(p.first), values_.getValue(p.second));
         };
     }
 
-    const std::vector<std::string>& keys() const {
+    FlatStringTable keys() const {
         return keys_.values();
     }
 
-    const std::vector<std::string>& values() const {
+    FlatStringTable values() const {
         return values_.values();
     }
 
+    /// The underlying key and value tables
+
+    const ValueTable& keyTable() const {
+        return keys_;
+    }
+
+    const ValueTable& valueTable() const {
+        return values_;
+    }
+
+    ValueTable& keyTable() {
+        return keys_;
+    }
+
+    ValueTable& valueTable() {
+        return values_;
+    }
+
 private:
     ValueTable keys_;
     ValueTable values_;
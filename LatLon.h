@@ -8,6 +8,7 @@
 #ifndef LATLON_H_
 #define LATLON_H_
 
+#include <cstdint>
 #include <limits>
 
 #include <iostream>
@@ -49,6 +50,73 @@ private:
     friend boost::serialization::access;
 };
 
+/** Latitude and longitude in fixed point, units of 1e-7 degree (the resolution of OSM data, about 1 cm), used wherever
+ * coordinates are stored. It is the same size as LatLon without losing precision to float, and deltas between points
+ * are exact integers. Converts implicitly to LatLon at the API boundary; conversion from LatLon is explicit. An unset
+ * coordinate (NaN in LatLon) is the most negative integer.
+ */
+
+struct FixedLatLon {
+    static constexpr std::int32_t s_unset = std::numeric_limits<std::int32_t>::min();
+
+    std::int32_t lat = s_unset;
+    std::int32_t lon = s_unset;
+
+    FixedLatLon() {
+    }
+
+    /// From fixed-point units
+    FixedLatLon(std::int32_t ilat, std::int32_t ilon) : lat(ilat), lon(ilon) {
+    }
+
+    explicit FixedLatLon(LatLon ll) : lat(fromDegrees(ll.lat)), lon(fromDegrees(ll.lon)) {
+    }
+
+    /// Nearest fixed-point value to an angle in degrees (unset if NaN)
+    static std::int32_t fromDegrees(double deg) {
+        if (std::isnan(deg))
+            return s_unset;
+        return std::int32_t(std::lround(deg * 1e7));
+    }
+
+    static double toDegrees(std::int32_t x) {
+        if (x == s_unset)
+            return std::numeric_limits<double>::quiet_NaN();
+        return x * 1e-7;
+    }
+
+    double latDegrees() const {
+        return toDegrees(lat);
+    }
+
+    double lonDegrees() const {
+        return toDegrees(lon);
+    }
+
+    operator LatLon() const {
+        return LatLon(float(latDegrees()), float(lonDegrees()));
+    }
+
+    bool operator==(const FixedLatLon rhs) const {
+        return lat == rhs.lat && lon == rhs.lon;
+    }
+
+    bool operator!=(const FixedLatLon rhs) const {
+        return !(*this == rhs);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const FixedLatLon ll) {
+        return os << LatLon(ll);
+    }
+
+private:
+
+    template<class Archive>void serialize(Archive& ar, unsigned int ver) {
+        ar & lat & lon;
+    }
+    friend boost::serialization::access;
+};
+
 
 
 #endif /* LATLON_H_ */
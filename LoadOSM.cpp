@@ -10,88 +10,386 @@
 #include <utility>
 
 #include <boost/archive/binary_iarchive.hpp>
+#include <boost/iostreams/stream.hpp>
 
 #include "XercesUtils.hpp"
 
+#include "LoadOSM.hpp"
 #include "ParseOSM.hpp"
+#include "ParsePBF.hpp"
+#include "OSMXMLTokenizer.hpp"
+#include "FlatOSMDatabase.hpp"
+#include "OSMDatabaseBuilder.hpp"
+#include "NodePOIFilter.hpp"
 
 #include <string>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
-#include <xercesc/framework/LocalFileInputSource.hpp>
 #include "CompressedFileInput.hpp"
+#include "InputFormat.hpp"
+#include "IngestStats.hpp"
 
 using namespace std;
 
 
-std::string suffix(const std::string s,const char c='.')
-{
-	size_t pos = s.find_last_of(c);
+namespace {
 
-	if (pos == string::npos)
-		return std::string();
+/// Parses an OSM XML or PBF file (format already checked) into dbb, on nThreads threads (0 -> hardware concurrency)
+void parseInto(const std::string fn,bool pbf,OSMXMLParser parser,const OSMTagFilterProfile& filters,
+		OSMDatabaseBuilder& dbb,unsigned nThreads)
+{
+	if (pbf)
+		parsePBF(fn,dbb,nThreads,filters);
+	else if (parser == OSMTokenizer)
+	{
+		cout << "Using OSM XML tokenizer" << endl;
+		parseOSMTokenized(fn,dbb,nThreads,filters);
+	}
 	else
-		return s.substr(pos+1,string::npos);
+	{
+		CompressedFileInputSource src(fn,nThreads);
+		parseOSM(&src,dbb,filters);
+		src.stats().print(cout);
+	}
 }
 
-std::pair<std::string,std::string> splitLast(const std::string s,const char c)
+
+/** Set of OSM IDs held as a sorted vector (8 bytes per distinct ID); insertions are buffered and merged in when the
+ * buffer has grown as large as the set.
+ */
+
+class SortedIDSet
 {
-	size_t pos = s.find_last_of(c);
+public:
+	template<class Range>void insert(const Range& r)
+	{
+		m_ids.insert(m_ids.end(),r.begin(),r.end());
+		if (m_ids.size()-m_nSorted > std::max<std::size_t>(m_nSorted,std::size_t(1) << 20))
+			compact();
+	}
+
+	void insert(unsigned long long id)
+	{
+		m_ids.push_back(id);
+		if (m_ids.size()-m_nSorted > std::max<std::size_t>(m_nSorted,std::size_t(1) << 20))
+			compact();
+	}
+
+	/// Merges the pending insertions (if any) into the sorted set
+	void compact()
+	{
+		if (m_nSorted == m_ids.size())
+			return;
+
+		std::sort(m_ids.begin()+m_nSorted,m_ids.end());
+		std::inplace_merge(m_ids.begin(),m_ids.begin()+m_nSorted,m_ids.end());
+		m_ids.erase(std::unique(m_ids.begin(),m_ids.end()),m_ids.end());
+		m_nSorted = m_ids.size();
+	}
+
+	/// Requires compact() after the last insert
+	bool contains(unsigned long long id) const { return std::binary_search(m_ids.begin(),m_ids.end(),id); }
+
+	std::size_t size() const { return m_ids.size(); }
+
+	void shrink_to_fit(){ m_ids.shrink_to_fit(); }
+
+private:
+	std::vector<unsigned long long> 	m_ids;
+	std::size_t 						m_nSorted=0;
+};
 
-	if (pos == string::npos)
-		return make_pair(s,string());
-	else
-		return make_pair(s.substr(0,pos),s.substr(pos+1,string::npos));
-}
 
-OSMDatabase loadOSM(const std::string fn)
+/** Drops entities outside a clip region as they are parsed: nodes outside the region, and ways & relations none of whose
+ * members were kept. Relation members are checked against the relations kept so far, so a relation whose only
+ * members are relations later in the file is dropped.
+ */
+
+class Clipper
 {
-	OSMDatabase db;
-	string base,sfx;
+public:
+	explicit Clipper(const OSMClipRegion& region) : m_region(region){}
 
-	tie(base,sfx) = splitLast(fn,'.');
+	/// Sets the retention predicates of dbb (which must not outlive this)
+	void install(OSMDatabaseBuilder& dbb)
+	{
+		dbb.retainNodes([this](const OSMNode& n){ return node(n); });
+		dbb.retainWays([this](const OSMWay& w){ return way(w); });
+		dbb.retainRelations([this](const OSMRelation& r){ return relation(r); });
+	}
 
-	xercesc::InputSource* src=nullptr;
+	bool node(const OSMNode& n)
+	{
+		if (!m_region.contains(n.coords()))
+			return false;
+		m_nodes.insert(n.id());
+		return true;
+	}
 
-	if (sfx == "bz2" || sfx == "gz" || sfx == "osm")
+	bool way(const OSMWay& w)
 	{
-		if (sfx == "osm")
-		{
-			std::cout << "Reading from uncompressed OSM XML file " << fn << std::endl;
-			src = new xercesc::LocalFileInputSource(AutoXMLChPtr(fn.c_str()).get());
-		}
-		else
-		{
-			string mid = suffix(base);
-			if (mid != "osm")
+		m_nodes.compact();
+		if (std::none_of(w.ndrefs().begin(),w.ndrefs().end(),[this](unsigned long long id){ return m_nodes.contains(id); }))
+			return false;
+		m_ways.insert(w.id());
+		return true;
+	}
+
+	bool relation(const OSMRelation& r)
+	{
+		m_ways.compact();
+		m_relations.compact();
+
+		for(const auto& m : r.members())
+			if ((m.type == OSMRelation::Node && m_nodes.contains(m.id)) ||
+					(m.type == OSMRelation::Way && m_ways.contains(m.id)) ||
+					(m.type == OSMRelation::Relation && m_relations.contains(m.id)))
 			{
-				cerr << "Did not recognize second extension " << mid << " in ." << sfx << " file (expecting 'osm')" << endl;
-				return OSMDatabase();
+				m_relations.insert(r.id());
+				return true;
 			}
-			else if (sfx == "bz2" || sfx == "gz")
+		return false;
+	}
+
+	void printSummary(std::ostream& os) const
+	{
+		os << "Clipped to " << m_region.bounds().first << " - " << m_region.bounds().second << ": kept " <<
+				m_nodes.size() << " nodes, " << m_ways.size() << " ways, " << m_relations.size() << " relations" << endl;
+	}
+
+private:
+	const OSMClipRegion& 	m_region;
+	SortedIDSet 			m_nodes, m_ways, m_relations;
+};
+
+
+/** Two-pass load which keeps only nodes used by ways, plus nodes passing NodePOIFilter.
+ *
+ * The first pass keeps nothing and stores no tags, only collecting way node references; the second drops every other
+ * node as soon as it is finished, so unreferenced nodes never accumulate in the builder. If clip is given, its way and
+ * relation predicates must already be installed on dbb, and nodes must also be inside the clip region.
+ */
+
+void parseReferencedNodes(const std::string fn,bool pbf,OSMXMLParser parser,const OSMTagFilterProfile& filters,
+		OSMDatabaseBuilder& dbb,Clipper* clip,unsigned nThreads)
+{
+	SortedIDSet ids;
+
+	cout << "Pass 1: collecting node references from ways" << endl;
+	ingestStats().beginPhase("pass 1: node references");
+	{
+		OSMTagFilter none;
+		none.keepOthers = false;
+
+		OSMTagFilterProfile noTags;
+		noTags.node = noTags.way = noTags.relation = none;
+
+		OSMDatabaseBuilder refs;
+		refs.retainNodes([](const OSMNode&){ return false; });
+		refs.retainWays([&ids](const OSMWay& w){ ids.insert(w.ndrefs()); return false; });
+		refs.retainRelations([](const OSMRelation&){ return false; });
+
+		parseInto(fn,pbf,parser,noTags,refs,nThreads);
+	}
+
+	ids.compact();
+	ids.shrink_to_fit();
+	cout << "Pass 1: " << ids.size() << " distinct nodes referenced by ways" << endl;
+
+	// NodePOIFilter resolves its key indices on construction, so recreate it whenever a key is added to the table
+	const KeyValueTable& tags = dbb.nodeTags();
+	std::unique_ptr<NodePOIFilter> poi;
+	std::size_t nKeys=0;
+	unsigned long long nDropped=0;
+
+	dbb.retainNodes([&](const OSMNode& n)
+	{
+		bool keep = ids.contains(n.id());
+
+		if (!keep && !n.tags().empty())
+		{
+			if (!poi || tags.keys().size() != nKeys)
 			{
-				cout << "Reading from compressed OSM XML file " << fn << endl;
-				src = new CompressedFileInputSource(fn);
+				poi.reset(new NodePOIFilter(tags));
+				nKeys = tags.keys().size();
 			}
+			keep = bool((*poi)(n));
 		}
-		db = parseOSM(src);
-	}
-	else if (sfx == "bin")
+
+		if (keep && clip)
+			return clip->node(n);
+
+		nDropped += !keep;
+		return keep;
+	});
+
+	cout << "Pass 2: loading referenced and POI nodes" << endl;
+	ingestStats().beginPhase("pass 2: referenced nodes");
+	parseInto(fn,pbf,parser,filters,dbb,nThreads);
+	dbb.retainNodes(nullptr);
+
+	cout << "Pass 2: dropped " << nDropped << " unreferenced non-POI nodes" << endl;
+}
+
+}
+
+OSMDatabase loadOSM(const std::string fn,OSMXMLParser parser,const OSMTagFilterProfile& filters,OSMNodeRetention nodes,
+		const OSMClipRegion& clip,unsigned nThreads)
+{
+	OSMDatabase db;
+	const InputFormat fmt = detectInputFormat(fn);
+	const string source = isStdin(fn) ? string("standard input") : "file " + fn;
+
+	switch(fmt.content)
+	{
+	case OSMContent::XML:
+	case OSMContent::PBF:
 	{
-		std::cout << "Reading from binary file" << fn << std::endl;
-		std::ifstream is(fn.c_str(),ios_base::in | ios_base::binary);
-		boost::archive::binary_iarchive ia(is);
+		const bool pbf = fmt.content == OSMContent::PBF;
 
-		ia & db;
-	}
-	else {
-		std::cerr << "Invalid input source - closing" << std::endl;
+		if (pbf)
+			cout << "Reading OSM PBF from " << source << endl;
+		else if (fmt.compression == Compression::None)
+			cout << "Reading uncompressed OSM XML from " << source << endl;
+		else
+			cout << "Reading " << compressionName(fmt.compression) << "-compressed OSM XML from " << source << endl;
+
+		if (nodes == ReferencedNodes && isStdin(fn))
+			throw runtime_error("loadOSM: ReferencedNodes reads the input twice and so cannot read standard input");
+
+		OSMDatabaseBuilder dbb;
+		std::unique_ptr<Clipper> clipper;
+
+		if (clip.clips())
+		{
+			clipper.reset(new Clipper(clip));
+			clipper->install(dbb);
+		}
+
+		if (nodes == ReferencedNodes)
+			parseReferencedNodes(fn,pbf,parser,filters,dbb,clipper.get(),nThreads);
+		else
+		{
+			ingestStats().beginPhase("parse");
+			parseInto(fn,pbf,parser,filters,dbb,nThreads);
+		}
+
+		if (clipper)
+		{
+			clipper->printSummary(cout);
+			dbb.retainNodes(nullptr);
+			dbb.retainWays(nullptr);
+			dbb.retainRelations(nullptr);
+			dbb.bounds = clip.bounds();
+		}
+
+		ingestStats().beginPhase("build database");
+		db = dbb.getDatabase();
+		break;
 	}
 
+	case OSMContent::FlatBin:
+		std::cout << "Reading from binary " << source << std::endl;
+		ingestStats().beginPhase("load .osm.bin");
+
+		if (isStdin(fn))
+			std::cerr << "Flat .osm.bin files are memory-mapped and cannot be read from standard input - closing" << std::endl;
+		else
+			db = FlatOSMDatabase(fn).toOSMDatabase();
+		break;
+
+	case OSMContent::LegacyBin:
+		std::cout << "Reading from legacy binary " << source << std::endl;
+		ingestStats().beginPhase("load .osm.bin");
+
+		if (isStdin(fn))
+		{
+			boost::iostreams::stream<StdinSource> is(StdinSource(),inputReadSize);
+			boost::archive::binary_iarchive ia(is);
+
+			ia & db;
+		}
+		else
+		{
+			std::ifstream is(fn.c_str(),ios_base::in | ios_base::binary);
+			boost::archive::binary_iarchive ia(is);
+
+			ia & db;
+		}
+		break;
 
-	delete src;
+	default:
+		std::cerr << "Invalid input source (unrecognized format) - closing" << std::endl;
+	}
 
+	ingestStats().endPhase();
 	cout << "Loaded database with " << db.nodes().size() << " nodes, " << db.ways().size() << " ways, and " << db.relations().size() << " relations" << endl;
 
 	return db;
 
 }
+
+OSMDatabase loadOSMTiles(const std::vector<std::string>& fns,OSMXMLParser parser,const OSMTagFilterProfile& filters,
+		OSMNodeRetention nodes,const OSMClipRegion& clip,unsigned nParallel)
+{
+	if (count_if(fns.begin(),fns.end(),[](const string& fn){ return isStdin(fn); }) > 1)
+		throw runtime_error("loadOSMTiles: standard input can be given only once");
+
+	const unsigned N = fns.size();
+
+	if (nParallel == 0)
+		nParallel = max(1U,thread::hardware_concurrency());
+	nParallel = min(nParallel,N);
+
+	// share the cores between the concurrent loads rather than give each load a thread per core
+	const unsigned nThreads = max(1U,max(1U,thread::hardware_concurrency())/nParallel);
+
+	cout << "Loading " << N << " inputs, " << nParallel << " at a time with " << nThreads << " threads each" << endl;
+
+	vector<OSMDatabase> parts(N);
+	vector<exception_ptr> errors(N);
+	atomic<unsigned> next(0);
+
+	auto worker = [&]()
+	{
+		for(unsigned i; (i = next++) < N; )
+		{
+			try {
+				parts[i] = loadOSM(fns[i],parser,filters,nodes,clip,nThreads);
+			}
+			catch(...)
+			{
+				errors[i] = current_exception();
+			}
+		}
+	};
+
+	// the loads' own phases would interleave, so account for them together
+	ingestStats().holdPhase("load inputs");
+
+	vector<thread> threads;
+	for(unsigned t=1; t<nParallel; ++t)
+		threads.emplace_back(worker);
+	worker();
+
+	for(auto& t : threads)
+		t.join();
+
+	ingestStats().releasePhase();
+
+	for(const auto& e : errors)
+		if (e)
+			rethrow_exception(e);
+
+	ingestStats().beginPhase("merge");
+	OSMDatabase db = OSMDatabase::merge(std::move(parts));
+	ingestStats().endPhase();
+
+	return db;
+}
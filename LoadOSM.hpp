@@ -9,9 +9,56 @@
 #define LOADOSM_HPP_
 
 #include "OSMDatabase.hpp"
+#include "OSMTagFilter.hpp"
+#include "OSMClipRegion.hpp"
 
+#include <string>
+#include <vector>
 
-OSMDatabase loadOSM(const std::string fn);
+
+/// Parser used for XML input (plain or compressed .osm); other formats ignore the choice
+enum OSMXMLParser {
+	XercesSAX2,			///< generic Xerces SAX2 parser (parseOSM)
+	OSMTokenizer		///< OSM-specific zero-copy tokenizer (parseOSMTokenized); produces the same database
+};
+
+/// Nodes kept when loading OSM XML or PBF
+enum OSMNodeRetention {
+	AllNodes,			///< every node in the file
+	ReferencedNodes		///< two passes, keeping only nodes used by ways plus POI nodes (NodePOIFilter); lower peak memory
+};
+
+/** Loads a database from OSM XML (plain, or gzip/bzip2/zstd/xz/lz4-compressed), .osm.pbf or .osm.bin, storing the tags
+ * selected by filters and the nodes selected by nodes (both ignored for .bin, which is already filtered). The format is
+ * detected from the file's leading bytes (detectInputFormat), not its name. A flat .osm.bin is copied into the returned
+ * (mutable) database; read-only consumers should open it in place with FlatOSMDatabase instead, as OSMDatabaseAPI does.
+ *
+ * fn may be "-" to read standard input (eg. piped from a download), in which case the format may also be declared with
+ * setStdinFormat. Standard input is read once and cannot hold a flat .osm.bin (which is mapped) nor be used with
+ * ReferencedNodes (two passes; throws std::runtime_error).
+ *
+ * If clip is set, entities outside it are dropped while parsing (see OSMClipRegion): nodes outside the region, and ways
+ * & relations with no member inside. The database bounds are set to the bounding box of the region. Ways crossing the
+ * boundary keep their references to the dropped nodes outside, which are dangling as at the edge of any extract.
+ *
+ * The parser and decompressor run on up to nThreads threads (0 -> hardware concurrency).
+ */
+
+OSMDatabase loadOSM(const std::string fn,OSMXMLParser parser=XercesSAX2,
+		const OSMTagFilterProfile& filters=defaultTagFilterProfile(),OSMNodeRetention nodes=AllNodes,
+		const OSMClipRegion& clip=OSMClipRegion(),unsigned nThreads=0);
+
+/** Loads several inputs (eg. adjacent tiles of a region) concurrently with loadOSM and unions them with
+ * OSMDatabase::merge, which drops entities repeated between tiles and translates their tag strings into one table.
+ *
+ * Up to nParallel inputs are loaded at once (0 -> one per core, up to the number of inputs); the cores are shared
+ * between them, each load running its parser on hardware concurrency / nParallel threads (at least 1). At most one
+ * input may be standard input. Throws the first error of any input once all loads have finished.
+ */
+
+OSMDatabase loadOSMTiles(const std::vector<std::string>& fns,OSMXMLParser parser=XercesSAX2,
+		const OSMTagFilterProfile& filters=defaultTagFilterProfile(),OSMNodeRetention nodes=AllNodes,
+		const OSMClipRegion& clip=OSMClipRegion(),unsigned nParallel=0);
 
 
 #endif /* LOADOSM_HPP_ */
@@ -32,15 +32,16 @@ public:
 
 	}
 
-	boost::optional<POI> operator()(const OSMNode& n) const
+	/// Node is an OSMNode, or an OSMNodeRef into a database's node table
+	template<class Node>boost::optional<POI> operator()(const Node& n) const
 	{
 		std::string type;
 		std::string name;
 
 		if (n.hasTag(m_tagKeyIndex_name_en))
-			name = m_keyValueTable.getValue(n.getValueForKey(m_tagKeyIndex_name_en));
+			name = m_keyValueTable.getValue(n.getValueForKey(m_tagKeyIndex_name_en)).to_string();
 		else if (n.hasTag(m_tagKeyIndex_name))
-			name = m_keyValueTable.getValue(n.getValueForKey(m_tagKeyIndex_name));
+			name = m_keyValueTable.getValue(n.getValueForKey(m_tagKeyIndex_name)).to_string();
 
 
 		// skip if no name provided
@@ -51,7 +52,7 @@ public:
 		unsigned amenityIdx;
 		if ((amenityIdx= n.getValueForKey(m_tagKeyIndex_amenity)) != -1U)
 		{
-			type = m_keyValueTable.getValue(amenityIdx);
+			type = m_keyValueTable.getValue(amenityIdx).to_string();
 
 		}
 		else if (false)
@@ -68,7 +69,7 @@ public:
 //		for(const auto kv : n.tags())
 //			std::cout << "    " << m_keyValueTable.getKey(kv.first) << ": " << m_keyValueTable.getValue(kv.second) << std::endl;
 
-		POI poi(n.id(),n.coords(),type,name);
+		POI poi(n.id(),n.fixedCoords(),type,name);
 		return poi;
 	}
 
@@ -0,0 +1,239 @@
+/*
+ * NumberParser.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef NUMBERPARSER_HPP_
+#define NUMBERPARSER_HPP_
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+/** Allocation-free conversion of numeric attribute values, for any character type: XMLCh (UTF-16) straight from Xerces,
+ * or char (UTF-8) from OSMXMLTokenizer.
+ *
+ * Results are the same as the C library strto* functions (correctly rounded), which std::stringstream >> T uses: leading
+ * whitespace is skipped, conversion stops at the first character which cannot continue the number, and the functions
+ * return false if nothing could be converted or the value is out of range.
+ *
+ * Integers, and decimals with up to 19 significant digits and a small exponent (all OSM ids and coordinates), are
+ * converted exactly with a few arithmetic operations. Anything else falls back to strtod/strtof on a copy of the text,
+ * which is on the stack unless it is longer than 63 characters.
+ */
+
+namespace NumberParserDetail {
+
+template<typename CharT>inline bool isSpace(CharT c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+template<typename CharT>inline bool isDigit(CharT c)
+{
+	return c >= '0' && c <= '9';
+}
+
+template<typename CharT>inline const CharT* endOf(const CharT* s)
+{
+	while(*s)
+		++s;
+	return s;
+}
+
+inline double strtoT(const char* s,char** e,double*){ return std::strtod(s,e); }
+inline float strtoT(const char* s,char** e,float*){ return std::strtof(s,e); }
+
+/// Exactly-representable powers of ten (up to 10^22 in a double, 10^10 in a float)
+template<typename Float>inline Float exactPow10(unsigned i)
+{
+	static const double p[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+		1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	return Float(p[i]);
+}
+
+template<typename Float>struct FastPathLimits;
+
+template<>struct FastPathLimits<double>
+{
+	static constexpr std::uint64_t 	maxMantissa=std::uint64_t(1) << 53;
+	static constexpr int 			maxExponent=22;
+};
+
+template<>struct FastPathLimits<float>
+{
+	static constexpr std::uint64_t 	maxMantissa=std::uint64_t(1) << 24;
+	static constexpr int 			maxExponent=10;
+};
+
+/// Converts with the C library on a narrowed copy of [p,end)
+template<typename CharT,typename Float>bool slowPath(const CharT* p,const CharT* end,Float& v)
+{
+	char buf[64];
+	std::string heap;
+	char* s = buf;
+
+	std::size_t n = end-p;
+	if (n >= sizeof(buf))
+	{
+		heap.resize(n+1);
+		s = &heap[0];
+	}
+
+	// anything outside ASCII cannot be part of a number
+	std::size_t i;
+	for(i=0; i<n && p[i] > 0 && p[i] < 0x80; ++i)
+		s[i] = char(p[i]);
+	s[i] = 0;
+
+	char* e;
+	errno = 0;
+	v = strtoT(s,&e,(Float*)nullptr);
+	return e != s && !(errno == ERANGE && std::abs(v) == std::numeric_limits<Float>::infinity());
+}
+
+template<typename CharT,typename Float>bool parseFloating(const CharT* const begin,const CharT* const end,Float& v)
+{
+	const CharT* p = begin;
+
+	while(p != end && isSpace(*p))
+		++p;
+
+	bool neg = false;
+	if (p != end && (*p == '+' || *p == '-'))
+		neg = *p++ == '-';
+
+	std::uint64_t m=0;				// significant digits
+	unsigned nSig=0;				// number of digits in m, not counting leading zeros
+	int exp10=0;
+	bool digits=false;
+	bool exact=true;
+
+	for(; p != end && isDigit(*p); ++p)
+	{
+		digits = true;
+		if (nSig < 19)
+		{
+			m = 10*m + unsigned(*p - '0');
+			nSig += m != 0;
+		}
+		else
+		{
+			++exp10;
+			exact &= *p == '0';
+		}
+	}
+
+	if (p != end && *p == '.')
+	{
+		for(++p; p != end && isDigit(*p); ++p)
+		{
+			digits = true;
+			if (nSig < 19)
+			{
+				m = 10*m + unsigned(*p - '0');
+				nSig += m != 0;
+				--exp10;
+			}
+			else
+				exact &= *p == '0';
+		}
+	}
+
+	// no digits (eg. inf, nan) or hexadecimal: leave it to the C library
+	if (!digits || (p != end && (*p == 'x' || *p == 'X')))
+		return slowPath(begin,end,v);
+
+	if (p != end && (*p == 'e' || *p == 'E'))
+	{
+		const CharT* q = p+1;
+		bool negExp = false;
+		if (q != end && (*q == '+' || *q == '-'))
+			negExp = *q++ == '-';
+
+		if (q != end && isDigit(*q))
+		{
+			int e=0;
+			for(; q != end && isDigit(*q); ++q)
+				if (e < 100000)
+					e = 10*e + int(*q - '0');
+			exp10 += negExp ? -e : e;
+		}
+	}
+
+	if (!exact || m > FastPathLimits<Float>::maxMantissa || exp10 > FastPathLimits<Float>::maxExponent ||
+			exp10 < -FastPathLimits<Float>::maxExponent)
+		return slowPath(begin,end,v);
+
+	// both operands exact, so one IEEE multiplication/division rounds correctly
+	const Float f = Float(m);
+	v = exp10 < 0 ? f / exactPow10<Float>(-exp10) : f * exactPow10<Float>(exp10);
+	if (neg)
+		v = -v;
+	return true;
+}
+
+}
+
+
+
+/** Parses an unsigned decimal integer from [p,end); as strtoull a leading '-' negates modulo 2^64. On overflow returns
+ * false with v set to the maximum value.
+ */
+
+template<typename CharT>bool parseNumber(const CharT* p,const CharT* end,unsigned long long& v)
+{
+	using namespace NumberParserDetail;
+
+	while(p != end && isSpace(*p))
+		++p;
+
+	bool neg = false;
+	if (p != end && (*p == '+' || *p == '-'))
+		neg = *p++ == '-';
+
+	v = 0;
+	if (p == end || !isDigit(*p))
+		return false;
+
+	const unsigned long long max = std::numeric_limits<unsigned long long>::max();
+	unsigned long long x=0;
+
+	for(; p != end && isDigit(*p); ++p)
+	{
+		const unsigned d = unsigned(*p - '0');
+		if (x > (max - d)/10)
+		{
+			v = max;
+			return false;
+		}
+		x = 10*x + d;
+	}
+
+	v = neg ? -x : x;
+	return true;
+}
+
+template<typename CharT>bool parseNumber(const CharT* p,const CharT* end,double& v)
+{
+	return NumberParserDetail::parseFloating(p,end,v);
+}
+
+template<typename CharT>bool parseNumber(const CharT* p,const CharT* end,float& v)
+{
+	return NumberParserDetail::parseFloating(p,end,v);
+}
+
+/// Null-terminated string versions (eg. the XMLCh* attribute values passed by Xerces)
+
+template<typename CharT,typename T>bool parseNumber(const CharT* s,T& v)
+{
+	return parseNumber(s,NumberParserDetail::endOf(s),v);
+}
+
+#endif /* NUMBERPARSER_HPP_ */
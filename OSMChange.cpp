@@ -0,0 +1,79 @@
+/*
+ * OSMChange.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "OSMChange.hpp"
+#include "OSMDatabaseBuilder.hpp"
+#include "OSMXMLTokenizer.hpp"
+#include "FlatFile.hpp"
+#include "InputFormat.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+OSMChange parseOSMChange(const std::string fn,const OSMTagFilterProfile& filters)
+{
+	const InputFormat fmt = detectInputFormat(fn);
+
+	if (fmt.content != OSMContent::XML)
+		throw runtime_error("parseOSMChange: expecting an OsmChange XML file, optionally compressed (" + fn + ")");
+
+	OSMChange c;
+	OSMDatabaseBuilder dbb;
+
+	{
+		OSMXMLTokenizer tok(dbb,filters.node,filters.way,filters.relation);
+		tok.recordChangeActions(&c);
+
+		if (fmt.compression == Compression::None && !isStdin(fn))
+		{
+			MappedFile f(fn);
+			const char* end = f.data()+f.size();
+			tok.finish(tok.parse(f.data(),end),end);
+		}
+		else
+		{
+			// change files are small: one tokenizer reading from the decompressor, carrying over incomplete constructs
+			DecompressingReader rd(fn,fmt.compression);
+
+			vector<char> buf(size_t(1) << 20);
+			size_t fill=0;
+
+			for(bool eof=false; !eof; )
+			{
+				const size_t N = rd.read(buf.data()+fill,buf.size()-fill);
+				fill += N;
+				eof = N == 0;
+
+				const char* end = buf.data()+fill;
+				const char* rest = eof ? (tok.finish(buf.data(),end),end) : tok.parse(buf.data(),end);
+
+				fill = end-rest;
+				memmove(buf.data(),rest,fill);
+
+				if (fill == buf.size())
+					buf.resize(2*buf.size());
+			}
+		}
+	}
+
+	c.nodes = std::move(dbb.nodes());
+	c.ways = dbb.releaseWays();
+	c.relations = dbb.releaseRelations();
+
+	c.nodeTags = std::move(dbb.nodeTags());
+	c.wayTags = std::move(dbb.wayTags());
+	c.relationTags = std::move(dbb.relationTags());
+	c.relationMemberRoles = std::move(dbb.relationMemberRoles());
+
+	cout << "Read change " << fn << " with " << c.nodes.size() << " nodes, " << c.ways.size() << " ways, and " <<
+			c.relations.size() << " relations" << endl;
+
+	return c;
+}
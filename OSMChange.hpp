@@ -0,0 +1,50 @@
+/*
+ * OSMChange.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef OSMCHANGE_HPP_
+#define OSMCHANGE_HPP_
+
+#include "OSMNode.hpp"
+#include "OSMWay.hpp"
+#include "OSMRelation.hpp"
+#include "KeyValueTable.hpp"
+#include "ValueTable.hpp"
+#include "OSMTagFilter.hpp"
+
+#include <string>
+#include <vector>
+
+enum OSMChangeAction : unsigned char { OSMCreate, OSMModify, OSMDelete };
+
+/** Contents of an OsmChange (.osc) file: the entities of each type in file order, each with the action to apply, and the
+ * string tables which their tag and member role indices refer to. Apply it with OSMDatabase::applyChange.
+ */
+
+struct OSMChange
+{
+	std::vector<OSMNode> 			nodes;
+	std::vector<OSMChangeAction> 	nodeActions;
+	KeyValueTable 					nodeTags;
+
+	std::vector<OSMWay> 			ways;
+	std::vector<OSMChangeAction> 	wayActions;
+	KeyValueTable 					wayTags;
+
+	std::vector<OSMRelation> 		relations;
+	std::vector<OSMChangeAction> 	relationActions;
+	KeyValueTable 					relationTags;
+
+	ValueTable 						relationMemberRoles;
+};
+
+/** Parses an .osc file, plain or compressed (see detectInputFormat), with OSMXMLTokenizer. Tags are filtered as by loadOSM, so the profile should be
+ * the one the database was built with. Throws std::runtime_error if the file cannot be read or parsed.
+ */
+
+OSMChange parseOSMChange(const std::string fn,const OSMTagFilterProfile& filters=defaultTagFilterProfile());
+
+#endif /* OSMCHANGE_HPP_ */
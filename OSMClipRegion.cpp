@@ -0,0 +1,173 @@
+/*
+ * OSMClipRegion.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "OSMClipRegion.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+OSMClipRegion::OSMClipRegion(LatLon sw,LatLon ne) :
+	m_clips(true),
+	m_bounds(sw,ne)
+{
+	if (!(sw.lat <= ne.lat && sw.lon <= ne.lon))
+		throw runtime_error("OSMClipRegion: box corners are not south-west, north-east");
+}
+
+void OSMClipRegion::addRing(std::vector<LatLon> ring,bool hole)
+{
+	if (ring.size() < 3)
+		throw runtime_error("OSMClipRegion: polygon ring has fewer than 3 points");
+
+	if (!hole)
+	{
+		// bounds cover the outer rings (replacing those of a box)
+		bool first = none_of(m_rings.begin(),m_rings.end(),[](const Ring& r){ return !r.hole; });
+
+		for(const LatLon p : ring)
+		{
+			if (first)
+				m_bounds = make_pair(p,p);
+			first = false;
+
+			m_bounds.first.lat = min(m_bounds.first.lat,p.lat);
+			m_bounds.first.lon = min(m_bounds.first.lon,p.lon);
+			m_bounds.second.lat = max(m_bounds.second.lat,p.lat);
+			m_bounds.second.lon = max(m_bounds.second.lon,p.lon);
+		}
+		m_clips = true;
+	}
+
+	m_rings.emplace_back();
+	m_rings.back().points = std::move(ring);
+	m_rings.back().hole = hole;
+}
+
+/// Crossing-number test, treating lon as x and lat as y
+bool OSMClipRegion::ringContains(const std::vector<LatLon>& ring,LatLon p)
+{
+	bool in=false;
+	for(size_t i=0, j=ring.size()-1; i<ring.size(); j=i++)
+	{
+		const LatLon a=ring[i], b=ring[j];
+		if ((a.lat > p.lat) != (b.lat > p.lat) &&
+				p.lon < (b.lon-a.lon) * (p.lat-a.lat) / (b.lat-a.lat) + a.lon)
+			in = !in;
+	}
+	return in;
+}
+
+bool OSMClipRegion::contains(LatLon p) const
+{
+	if (!m_clips)
+		return true;
+
+	if (!(m_bounds.first.lat <= p.lat && p.lat <= m_bounds.second.lat &&
+			m_bounds.first.lon <= p.lon && p.lon <= m_bounds.second.lon))
+		return false;
+
+	if (m_rings.empty())
+		return true;
+
+	bool inOuter=false;
+	for(const Ring& r : m_rings)
+		if (r.hole && ringContains(r.points,p))
+			return false;
+		else if (!r.hole)
+			inOuter = inOuter || ringContains(r.points,p);
+
+	return inOuter;
+}
+
+OSMClipRegion parseClipBox(const std::string s)
+{
+	float v[4];
+	char sep[3];
+
+	stringstream ss(s);
+	ss >> v[0] >> sep[0] >> v[1] >> sep[1] >> v[2] >> sep[2] >> v[3];
+
+	if (ss.fail() || !(ss >> ws).eof() || sep[0] != ',' || sep[1] != ',' || sep[2] != ',')
+		throw runtime_error("Invalid clip box '" + s + "' (expecting minlon,minlat,maxlon,maxlat)");
+
+	return OSMClipRegion(LatLon(v[1],v[0]),LatLon(v[3],v[2]));
+}
+
+OSMClipRegion loadClipPolygon(const std::string fn)
+{
+	ifstream is(fn.c_str());
+	if (!is.good())
+		throw runtime_error("Failed to open clip polygon " + fn);
+
+	OSMClipRegion region;
+	string line;
+	unsigned lineNo=1;
+
+	auto fail = [&fn,&lineNo](const string& msg)
+	{
+		stringstream ss;
+		ss << fn << ':' << lineNo << ": " << msg;
+		throw runtime_error(ss.str());
+	};
+
+	auto next = [&is,&line,&lineNo]()
+	{
+		bool ok = bool(getline(is,line));
+		++lineNo;
+		line.erase(0,line.find_first_not_of(" \t\r"));
+		line.erase(line.find_last_not_of(" \t\r")+1);
+		return ok;
+	};
+
+	// first line is the polygon name; then rings, each a name line, coordinate lines and END; then a final END
+	if (!getline(is,line))
+		fail("empty file");
+
+	while(next() && line != "END")
+	{
+		if (line.empty())
+			continue;
+
+		const bool hole = line[0] == '!';
+		vector<LatLon> ring;
+
+		while(true)
+		{
+			if (!next())
+				fail("unexpected end of file inside a ring");
+			if (line == "END")
+				break;
+			if (line.empty())
+				continue;
+
+			stringstream ss(line);
+			float lon,lat;
+			if (!(ss >> lon >> lat))
+				fail("expecting 'lon lat'");
+			ring.emplace_back(lat,lon);
+		}
+
+		try {
+			region.addRing(std::move(ring),hole);
+		}
+		catch(runtime_error& e)
+		{
+			fail(e.what());
+		}
+	}
+
+	if (line != "END")
+		fail("missing final END");
+	else if (!region.clips())
+		fail("no outer ring");
+
+	return region;
+}
@@ -0,0 +1,63 @@
+/*
+ * OSMClipRegion.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef OSMCLIPREGION_HPP_
+#define OSMCLIPREGION_HPP_
+
+#include "LatLon.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Region to which the input is clipped during ingest (see loadOSM): a lat/lon box, or a polygon made of outer rings
+ * and holes. A default-constructed region does not clip.
+ */
+
+class OSMClipRegion
+{
+public:
+	/// Region which contains everything (no clipping)
+	OSMClipRegion(){}
+
+	/// Box with south-west corner sw and north-east corner ne
+	OSMClipRegion(LatLon sw,LatLon ne);
+
+	/** Adds a polygon ring (implicitly closed); a point is inside if it is inside an outer ring and no hole. The first outer
+	 * ring replaces a box.
+	 */
+	void addRing(std::vector<LatLon> ring,bool hole=false);
+
+	/// True if any region was set
+	bool clips() const { return m_clips; }
+
+	bool contains(LatLon p) const;
+
+	/// Bounding box (south-west, north-east) of the region
+	std::pair<LatLon,LatLon> bounds() const { return m_bounds; }
+
+private:
+	struct Ring
+	{
+		std::vector<LatLon> 	points;
+		bool 					hole=false;
+	};
+
+	static bool ringContains(const std::vector<LatLon>& ring,LatLon p);
+
+	bool 						m_clips=false;
+	std::pair<LatLon,LatLon> 	m_bounds;
+	std::vector<Ring> 			m_rings;		// empty for a box
+};
+
+/// Parses a box given as "minlon,minlat,maxlon,maxlat" (OSM API bbox order); throws std::runtime_error if malformed
+OSMClipRegion parseClipBox(const std::string s);
+
+/// Loads a polygon in the Osmosis .poly format (rings of "lon lat" lines, holes marked with '!'); throws std::runtime_error
+OSMClipRegion loadClipPolygon(const std::string fn);
+
+#endif /* OSMCLIPREGION_HPP_ */
@@ -6,10 +6,273 @@
  */
 
 #include "OSMDatabase.hpp"
+#include "OSMChange.hpp"
 #include <boost/range/adaptor/transformed.hpp>
+#include <boost/optional.hpp>
+
+#include <functional>
+#include <map>
+#include <queue>
 
 using namespace std;
 
+namespace {
+
+/// Returns the index in dst of each string in src, adding those missing from dst (hash lookups, see ValueTable)
+
+vector<unsigned> mapStrings(const ValueTable& src, ValueTable& dst) {
+    vector<unsigned> m(src.size());
+    for (unsigned i = 0; i < src.size(); ++i) {
+        m[i] = dst.getIndexOfValue(src.getValue(i));
+        if (m[i] == -1U)
+            m[i] = dst.addValue(src.getValue(i));
+    }
+    return m;
+}
+
+/** Sorts v by OSM ID, keeping only the first entity of each ID (stable, so the one from the earliest part). Returns the
+ * number dropped.
+ */
+
+template<class Entity>size_t sortUniqueByID(vector<Entity>& v) {
+    std::stable_sort(v.begin(), v.end(), OSMEntity::osmIDLess);
+    const auto e = std::unique(v.begin(), v.end(), [](const Entity& lhs, const Entity& rhs) {
+        return lhs.id() == rhs.id(); });
+    const size_t n = v.end() - e;
+    v.erase(e, v.end());
+    return n;
+}
+
+/** Sorts v by OSM ID unless it is already (stable, so parse order is kept among equal IDs) and puts the IDs in ids.
+ * Entities repeating an earlier ID (eg. from a malformed input) are dropped with a warning, keeping the first. Returns
+ * true if v was reordered or shortened.
+ */
+template<class Entity>bool sortAndCollectIDs(vector<Entity>& v, vector<OSMID>& ids, const char* what) {
+    const bool sorted = std::is_sorted(v.begin(), v.end(), OSMEntity::osmIDLess);
+    if (!sorted)
+        std::stable_sort(v.begin(), v.end(), OSMEntity::osmIDLess);
+
+    const auto dup = std::adjacent_find(v.begin(), v.end(), [](const Entity& lhs, const Entity& rhs) {
+        return lhs.id() == rhs.id(); });
+    size_t nDropped = 0;
+    if (dup != v.end()) {
+        const OSMID first = dup->id();
+        nDropped = sortUniqueByID(v);
+        cout << "Warning: dropped " << nDropped << ' ' << what << " with duplicate IDs (first ID " << first << ")" << endl;
+    }
+
+    ids.clear();
+    ids.reserve(v.size());
+    for (const auto& e : v)
+        ids.push_back(e.id());
+
+    return !sorted || nDropped != 0;
+}
+
+/// Union of two bounding boxes (first = SW, second = NE), either of which may be unset (NaN)
+
+pair<LatLon, LatLon> boundsUnion(const pair<LatLon, LatLon>& a, const pair<LatLon, LatLon>& b) {
+    if (std::isnan(a.first.lat))
+        return b;
+    else if (std::isnan(b.first.lat))
+        return a;
+    else
+        return make_pair(
+            LatLon(std::min(a.first.lat, b.first.lat), std::min(a.first.lon, b.first.lon)),
+            LatLon(std::max(a.second.lat, b.second.lat), std::max(a.second.lon, b.second.lon)));
+}
+
+/** Copies the row get(e) of each entity into one contiguous array a, with N+1 offsets, then calls bind(e, b, e) to
+ * point each entity at its row. The rows may be read from the old contents of a, which is only released at the end.
+ */
+
+template<class Entity, class T, class Get, class Bind>void packCSR(vector<Entity>& v, vector<T>& a,
+        vector<std::uint64_t>& offsets, Get get, Bind bind) {
+    vector<std::uint64_t> o;
+    o.reserve(v.size() + 1);
+    o.push_back(0);
+    for (const Entity& e : v)
+        o.push_back(o.back() + get(e).size());
+
+    vector<T> b;
+    b.reserve(o.back());
+    for (const Entity& e : v)
+        b.insert(b.end(), get(e).begin(), get(e).end());
+
+    a.swap(b);
+    offsets.swap(o);
+
+    for (size_t i = 0; i < v.size(); ++i)
+        bind(v[i], a.data() + offsets[i], a.data() + offsets[i + 1]);
+}
+
+/// Checks that offsets describe one row of a per entity of v, then binds each entity to its row
+template<class Entity, class T, class Bind>void bindCSR(vector<Entity>& v, const vector<T>& a,
+        const vector<std::uint64_t>& offsets, const char* what, Bind bind) {
+    if (offsets.size() != v.size() + 1 || offsets.front() != 0 || offsets.back() != a.size() ||
+            !std::is_sorted(offsets.begin(), offsets.end()))
+        throw std::invalid_argument(string("OSMDatabase: ") + what + " offsets do not match the entities");
+
+    for (size_t i = 0; i < v.size(); ++i)
+        bind(v[i], a.data() + offsets[i], a.data() + offsets[i + 1]);
+}
+
+struct ChangeCounts {
+    unsigned created = 0, modified = 0, deleted = 0, missing = 0;
+};
+
+/** Applies the actions for one entity type. v must be in ascending ID order with ids holding its IDs (as kept by
+ * OSMDatabase::indexByID_), and is left in that order; ids is left stale (the caller rebuilds it). Existing entities are
+ * found by binary search in ids, created ones (few) through a small map. remap translates the string indices of a
+ * changed entity. A modify of an absent entity is treated as a create.
+ */
+
+template<class Entity, class Remap>ChangeCounts applyEntityChanges(vector<Entity>& v, const vector<OSMID>& ids,
+        const vector<Entity>& changed, const vector<OSMChangeAction>& actions, Remap remap) {
+    ChangeCounts n;
+    vector<bool> deleted(v.size());
+    std::map<OSMID, size_t> appended;
+
+    assert(changed.size() == actions.size());
+    assert(ids.size() == v.size());
+
+    // position in v of the live entity with the given ID, or v.size() if none
+    auto find = [&](OSMID id) -> size_t {
+        const auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        if (it != ids.end() && *it == id && !deleted[it - ids.begin()])
+            return it - ids.begin();
+        const auto a = appended.find(id);
+        return a == appended.end() ? v.size() : a->second;
+    };
+
+    for (unsigned i = 0; i < changed.size(); ++i) {
+        const OSMID id = changed[i].id();
+        const size_t k = find(id);
+
+        if (actions[i] == OSMDelete) {
+            if (k == v.size())
+                ++n.missing;
+            else {
+                deleted[k] = true;
+                appended.erase(id);
+                ++n.deleted;
+            }
+        } else {
+            Entity e = changed[i];
+            remap(e);
+            e.sortTags();
+
+            if (k == v.size()) {
+                appended.insert(make_pair(id, v.size()));
+                v.push_back(std::move(e));
+                deleted.push_back(false);
+            } else
+                v[k] = std::move(e);
+
+            ++(actions[i] == OSMCreate ? n.created : n.modified);
+        }
+    }
+
+    // compact out the deleted entities, preserving order
+    if (n.deleted) {
+        size_t j = 0;
+        for (size_t i = 0; i < v.size(); ++i)
+            if (!deleted[i]) {
+                if (i != j)
+                    v[j] = std::move(v[i]);
+                ++j;
+            }
+        v.erase(v.begin() + j, v.end());
+    }
+
+    // created entities were appended; merge them back into ascending order
+    const auto firstUnsorted = std::is_sorted_until(v.begin(), v.end(), OSMEntity::osmIDLess);
+    std::sort(firstUnsorted, v.end(), OSMEntity::osmIDLess);
+    std::inplace_merge(v.begin(), firstUnsorted, v.end(), OSMEntity::osmIDLess);
+
+    return n;
+}
+
+/** Node counterpart of applyEntityChanges. The table is ordered by ID, so the changes are gathered by ID (the last
+ * action for an ID deciding) and the table is rebuilt in one merge pass, rather than patched in place.
+ */
+
+template<class Remap>ChangeCounts applyNodeChanges(OSMNodeTable& t, const vector<OSMNode>& changed,
+        const vector<OSMChangeAction>& actions, Remap remap) {
+    ChangeCounts n;
+    std::map<OSMID, boost::optional<OSMNode>> overlay; // empty optional -> deleted
+
+    assert(changed.size() == actions.size());
+
+    for (unsigned i = 0; i < changed.size(); ++i) {
+        const OSMID id = changed[i].id();
+        const auto it = overlay.find(id);
+        const bool exists = it != overlay.end() ? bool(it->second) : t.indexFromID(id) != -1U;
+
+        if (actions[i] == OSMDelete) {
+            if (!exists)
+                ++n.missing;
+            else {
+                overlay[id] = boost::none;
+                ++n.deleted;
+            }
+        } else {
+            OSMNode e = changed[i];
+            remap(e);
+            e.sortTags();
+            overlay[id] = std::move(e);
+
+            ++(actions[i] == OSMCreate ? n.created : n.modified);
+        }
+    }
+
+    if (overlay.empty())
+        return n;
+
+    size_t nTags = t.tagArray().size();
+    for (const auto& o : overlay)
+        if (o.second)
+            nTags += o.second->tags().size();
+
+    OSMNodeTable u;
+    u.reserve(t.size() + n.created + n.modified, nTags);
+
+    auto o = overlay.begin();
+    for (size_t i = 0; i < t.size(); ++i) {
+        for (; o != overlay.end() && o->first < t.ids()[i]; ++o)
+            if (o->second)
+                u.push_back(*o->second);
+
+        if (o != overlay.end() && o->first == t.ids()[i]) {
+            if (o->second)
+                u.push_back(*o->second);
+            ++o;
+        } else
+            u.push_back(t[i]);
+    }
+
+    for (; o != overlay.end(); ++o)
+        if (o->second)
+            u.push_back(*o->second);
+
+    t = std::move(u);
+    return n;
+}
+
+/// The distinct IDs of the entities in v, ascending
+
+template<class Entity>vector<OSMID> distinctIDs(const vector<Entity>& v) {
+    vector<OSMID> ids;
+    ids.reserve(v.size());
+    for (const auto& e : v)
+        ids.push_back(e.id());
+    boost::sort(ids);
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+}
+
 void OSMDatabase::print() const {
     cout << "OSMDatabaseBuilder summary: " << endl;
     cout << "  Bounds: " << bounds_.first << "-" << bounds_.second << endl;
@@ -18,8 +281,8 @@ void OSMDatabase::print() const {
     cout << "  " << ways_.size() << " ways" << endl;
 
     cout << "  Relation member roles: ";
-    for (const auto r : relationMemberRoles_.values())
-        cout << r << "  ";
+    for (unsigned i = 0; i < relationMemberRoles_.size(); ++i)
+        cout << relationMemberRoles_.getValue(i) << "  ";
     cout << endl;
 }
 
@@ -75,17 +338,199 @@ void OSMDatabase::showWay(const unsigned i) const {
 }
 
 vector<LatLon> OSMDatabase::extractPoly(const OSMWay& way) const {
-    vector<LatLon> ll;
+    const vector<FixedLatLon> p = extractFixedPoly(way);
+    return vector<LatLon>(p.begin(), p.end());
+}
+
+vector<FixedLatLon> OSMDatabase::extractFixedPoly(const OSMWay& way) const {
+    vector<FixedLatLon> ll;
+    ll.reserve(way.ndrefs().size());
 
     // extract all points from way
     for (const auto nd : way.ndrefs()) {
-        const auto n_it = idToNodeMap_.find(nd);
-        if (n_it == idToNodeMap_.end())
+        const unsigned i = nodes_.indexFromID(nd);
+        if (i == -1U)
             cout << "Warning: dangling reference to node " << nd << " in extractPoly(OSMWay)" << endl;
-        else {
-            const OSMNode& n = *(n_it->second);
-            ll.push_back(n.coords());
-        }
+        else
+            ll.push_back(nodes_.coords()[i]);
     }
     return ll;
 }
+
+bool OSMDatabase::indexByID_() {
+    const bool w = sortAndCollectIDs(ways_, wayIDs_, "ways");
+    const bool r = sortAndCollectIDs(relations_, relationIDs_, "relations");
+    return w || r;
+}
+
+void OSMDatabase::bindRefs_() {
+    bindCSR(ways_, wayNdRefs_, wayNdRefOffsets_, "way node ref", [](OSMWay& w, const unsigned long long* b, const unsigned long long* e) {
+        w.bindNdRefs(b, e); });
+    bindCSR(relations_, relationMembers_, relationMemberOffsets_, "relation member", [](OSMRelation& r, const OSMRelation::Member* b, const OSMRelation::Member* e) {
+        r.bindMembers(b, e); });
+}
+
+void OSMDatabase::packRefs_() {
+    packCSR(ways_, wayNdRefs_, wayNdRefOffsets_, [](const OSMWay& w) {
+        return w.ndrefs(); }, [](OSMWay& w, const unsigned long long* b, const unsigned long long* e) {
+        w.bindNdRefs(b, e); });
+    packCSR(relations_, relationMembers_, relationMemberOffsets_, [](const OSMRelation& r) {
+        return r.members(); }, [](OSMRelation& r, const OSMRelation::Member* b, const OSMRelation::Member* e) {
+        r.bindMembers(b, e); });
+}
+
+OSMChangedIDs OSMDatabase::applyChange(const OSMChange& c) {
+    // translate the change's string tables into ours
+    const vector<unsigned> nodeKeys = mapStrings(c.nodeTags.keyTable(), nodeTags_.keyTable());
+    const vector<unsigned> nodeValues = mapStrings(c.nodeTags.valueTable(), nodeTags_.valueTable());
+    const vector<unsigned> wayKeys = mapStrings(c.wayTags.keyTable(), wayTags_.keyTable());
+    const vector<unsigned> wayValues = mapStrings(c.wayTags.valueTable(), wayTags_.valueTable());
+    const vector<unsigned> relationKeys = mapStrings(c.relationTags.keyTable(), relationTags_.keyTable());
+    const vector<unsigned> relationValues = mapStrings(c.relationTags.valueTable(), relationTags_.valueTable());
+    const vector<unsigned> roles = mapStrings(c.relationMemberRoles, relationMemberRoles_);
+
+    const ChangeCounts nn = applyNodeChanges(nodes_, c.nodes, c.nodeActions, [&](OSMNode& n) {
+        n.remapTags(nodeKeys, nodeValues); });
+    const ChangeCounts nw = applyEntityChanges(ways_, wayIDs_, c.ways, c.wayActions, [&](OSMWay& w) {
+        w.remapTags(wayKeys, wayValues); });
+    const ChangeCounts nr = applyEntityChanges(relations_, relationIDs_, c.relations, c.relationActions, [&](OSMRelation& r) {
+        r.remapTags(relationKeys, relationValues);
+        r.remapRoles(roles); });
+
+    indexByID_();
+    packRefs_();
+
+    auto print = [](const char* type, const ChangeCounts& n) {
+        cout << "  " << type << ": " << n.created << " created, " << n.modified << " modified, " << n.deleted << " deleted";
+        if (n.missing)
+            cout << " (" << n.missing << " deletions of absent entities ignored)";
+        cout << endl;
+    };
+
+    cout << "Applied change:" << endl;
+    print("nodes", nn);
+    print("ways", nw);
+    print("relations", nr);
+
+    OSMChangedIDs changed;
+    changed.nodes = distinctIDs(c.nodes);
+    changed.ways = distinctIDs(c.ways);
+    changed.relations = distinctIDs(c.relations);
+    return changed;
+}
+
+OSMDatabase OSMDatabase::merge(vector<OSMDatabase>&& parts) {
+    OSMDatabase db;
+
+    if (parts.empty())
+        return db;
+
+    size_t nNodes = 0, nNodeTags = 0, nWays = 0, nRelations = 0;
+    for (const auto& p : parts) {
+        nNodes += p.nodes_.size();
+        nNodeTags += p.nodes_.tagArray().size();
+        nWays += p.ways_.size();
+        nRelations += p.relations_.size();
+    }
+
+    db = std::move(parts.front());
+    db.ways_.reserve(nWays);
+    db.relations_.reserve(nRelations);
+
+    // node tag maps of each part into db's table (none for the first); nodes are merged below
+    vector<vector<unsigned>> nodeKeys(parts.size()), nodeValues(parts.size());
+
+    for (size_t i = 1; i < parts.size(); ++i) {
+        OSMDatabase& p = parts[i];
+
+        nodeKeys[i] = mapStrings(p.nodeTags_.keyTable(), db.nodeTags_.keyTable());
+        nodeValues[i] = mapStrings(p.nodeTags_.valueTable(), db.nodeTags_.valueTable());
+        const vector<unsigned> wayKeys = mapStrings(p.wayTags_.keyTable(), db.wayTags_.keyTable());
+        const vector<unsigned> wayValues = mapStrings(p.wayTags_.valueTable(), db.wayTags_.valueTable());
+        const vector<unsigned> relationKeys = mapStrings(p.relationTags_.keyTable(), db.relationTags_.keyTable());
+        const vector<unsigned> relationValues = mapStrings(p.relationTags_.valueTable(), db.relationTags_.valueTable());
+        const vector<unsigned> roles = mapStrings(p.relationMemberRoles_, db.relationMemberRoles_);
+
+        for (auto& w : p.ways_) {
+            w.remapTags(wayKeys, wayValues);
+            w.sortTags();
+            db.ways_.push_back(std::move(w));
+        }
+        for (auto& r : p.relations_) {
+            r.remapTags(relationKeys, relationValues);
+            r.sortTags();
+            r.remapRoles(roles);
+            db.relations_.push_back(std::move(r));
+        }
+
+        db.bounds_ = boundsUnion(db.bounds_, p.bounds_);
+
+        // release what has been copied
+        vector<OSMWay>().swap(p.ways_);
+        vector<OSMRelation>().swap(p.relations_);
+    }
+
+    // k-way merge of the parts' node tables, which are in ascending ID order; on equal IDs the earliest part comes first
+    size_t dn = 0;
+    {
+        vector<const OSMNodeTable*> tables(parts.size());
+        tables[0] = &db.nodes_;
+        for (size_t i = 1; i < parts.size(); ++i)
+            tables[i] = &parts[i].nodes_;
+
+        typedef pair<OSMID, size_t> Head; // (ID, part)
+        priority_queue<Head, vector<Head>, std::greater<Head>> heads;
+        vector<size_t> pos(parts.size(), 0);
+
+        for (size_t i = 0; i < tables.size(); ++i)
+            if (!tables[i]->empty())
+                heads.push(make_pair(tables[i]->ids().front(), i));
+
+        OSMNodeTable nodes;
+        nodes.reserve(nNodes, nNodeTags);
+        vector<OSMNodeTable::Tag> tags;
+
+        while (!heads.empty()) {
+            const Head h = heads.top();
+            heads.pop();
+
+            const OSMNodeTable& t = *tables[h.second];
+            const size_t j = pos[h.second]++;
+            if (j + 1 < t.size())
+                heads.push(make_pair(t.ids()[j + 1], h.second));
+
+            if (!nodes.empty() && nodes.ids().back() == h.first) {
+                ++dn;
+                continue;
+            }
+
+            if (h.second == 0)
+                nodes.push_back(t[j]);
+            else {
+                tags.assign(t.tags(j).begin(), t.tags(j).end());
+                for (auto& tag : tags)
+                    tag = make_pair(nodeKeys[h.second][tag.first], nodeValues[h.second][tag.second]);
+                boost::sort(tags, [](const OSMNodeTable::Tag& lhs, const OSMNodeTable::Tag& rhs) {
+                    return lhs.first < rhs.first; });
+                nodes.push_back(h.first, t.coords()[j], tags);
+            }
+        }
+
+        db.nodes_ = std::move(nodes);
+    }
+
+    const size_t dw = sortUniqueByID(db.ways_);
+    const size_t dr = sortUniqueByID(db.relations_);
+
+    // the later parts' ways and relations still refer to those parts' arrays until packed into db's
+    db.indexByID_();
+    db.packRefs_();
+
+    cout << "Merged " << parts.size() << " databases: " << db.nodes_.size() << " nodes, " << db.ways_.size() << " ways, "
+            << db.relations_.size() << " relations (" << dn << " nodes, " << dw << " ways and " << dr
+            << " relations duplicated between parts)" << endl;
+
+    parts.clear();
+
+    return db;
+}
@@ -9,6 +9,7 @@
 #define OSMDATABASE_HPP_
 
 #include "OSMNode.hpp"
+#include "OSMNodeTable.hpp"
 #include "OSMWay.hpp"
 #include "OSMRelation.hpp"
 #include "ValueTable.hpp"
@@ -18,9 +19,22 @@
 #include <boost/range/algorithm.hpp>
 #include <boost/range/adaptor/filtered.hpp>
 #include <boost/range/adaptor/map.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/version.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
 #include <unordered_map>
 
+struct OSMChange;
+
+/// IDs of the entities created, modified or deleted by OSMDatabase::applyChange (ascending, each once), eg. for updateNetwork
+
+struct OSMChangedIDs {
+    std::vector<unsigned long long> nodes, ways, relations;
+};
+
 class OSMDatabase {
 public:
 
@@ -28,11 +42,40 @@ public:
     }
 
     OSMDatabase(const std::pair<LatLon, LatLon>& bounds,
-            std::vector<OSMNode>&& nodes,
+            OSMNodeTable&& nodes,
+            KeyValueTable&& nodeTags,
+            std::vector<OSMWay>&& ways,
+            KeyValueTable&& wayTags,
+            std::vector<OSMRelation>&& relations,
+            KeyValueTable&& relationTags,
+            ValueTable&& relationMemberRoles) :
+
+    bounds_(bounds),
+    nodes_(std::move(nodes)),
+    nodeTags_(std::move(nodeTags)),
+    ways_(std::move(ways)),
+    wayTags_(std::move(wayTags)),
+    relations_(std::move(relations)),
+    relationTags_(std::move(relationTags)),
+    relationMemberRoles_(std::move(relationMemberRoles)) {
+        indexByID_();
+        packRefs_();
+    }
+
+    /** As above, with the way node refs and relation members in CSR arrays (row i belonging to entity i, as gathered by
+     * OSMDatabaseBuilder) which are taken over as they are, rather than held by the entities. Throws std::invalid_argument
+     * if the offsets do not match.
+     */
+    OSMDatabase(const std::pair<LatLon, LatLon>& bounds,
+            OSMNodeTable&& nodes,
             KeyValueTable&& nodeTags,
             std::vector<OSMWay>&& ways,
+            std::vector<unsigned long long>&& wayNdRefs,
+            std::vector<std::uint64_t>&& wayNdRefOffsets,
             KeyValueTable&& wayTags,
             std::vector<OSMRelation>&& relations,
+            std::vector<OSMRelation::Member>&& relationMembers,
+            std::vector<std::uint64_t>&& relationMemberOffsets,
             KeyValueTable&& relationTags,
             ValueTable&& relationMemberRoles) :
 
@@ -43,31 +86,72 @@ public:
     wayTags_(std::move(wayTags)),
     relations_(std::move(relations)),
     relationTags_(std::move(relationTags)),
+    wayNdRefs_(std::move(wayNdRefs)),
+    wayNdRefOffsets_(std::move(wayNdRefOffsets)),
+    relationMembers_(std::move(relationMembers)),
+    relationMemberOffsets_(std::move(relationMemberOffsets)),
     relationMemberRoles_(std::move(relationMemberRoles)) {
-        buildIDMap_();
+        bindRefs_();
+        if (indexByID_())
+            packRefs_();
     }
 
 
     // print summary information on the database
     void print() const;
 
+    /** Applies the create/modify/delete actions of a change file in order: created & modified entities replace any
+     * existing one with the same ID (a create is appended otherwise), deleted ones are removed. Tag and role strings are
+     * translated into this database's tables, adding the new ones, and tags are re-sorted. Entities stay in ascending ID
+     * order. Returns the IDs named by the change, so that derived data (eg. a road network) can be patched.
+     */
+    OSMChangedIDs applyChange(const OSMChange& c);
+
+    /** Unions several databases, eg. adjacent tiles of a region loaded separately. Tag and role strings of the later
+     * parts are translated into the first one's tables (adding the new ones), entities with the same OSM ID are kept
+     * once (from the earliest part holding them), entities are put in ascending ID order and the bounds are the union of
+     * the parts' bounds (unset ones ignored). The parts are consumed.
+     */
+    static OSMDatabase merge(std::vector<OSMDatabase>&& parts);
+
     // print full information for node/relation/way
     void showNode(unsigned i) const;
     void showRelation(unsigned i) const;
     void showWay(unsigned i) const;
 
-    const std::vector<OSMNode>& nodes() const {
+    /// Nodes in ascending ID order, stored by column (see OSMNodeTable); elements are OSMNodeRef values
+    const OSMNodeTable& nodes() const {
         return nodes_;
     }
 
+    /// Ways in ascending ID order
     const std::vector<OSMWay>& ways() const {
         return ways_;
     }
 
+    /// Relations in ascending ID order
     const std::vector<OSMRelation>& relations() const {
         return relations_;
     }
 
+    /// Node refs of all ways in one array, in way order; way i holds [wayNdRefOffsets()[i], wayNdRefOffsets()[i+1])
+    const std::vector<unsigned long long>& wayNdRefs() const {
+        return wayNdRefs_;
+    }
+
+    const std::vector<std::uint64_t>& wayNdRefOffsets() const {
+        return wayNdRefOffsets_;
+    }
+
+    /// Members of all relations in one array, indexed like wayNdRefs through relationMemberOffsets()
+    const std::vector<OSMRelation::Member>& relationMembers() const {
+        return relationMembers_;
+    }
+
+    const std::vector<std::uint64_t>& relationMemberOffsets() const {
+        return relationMemberOffsets_;
+    }
+
     const KeyValueTable& nodeTags() const {
         return nodeTags_;
     }
@@ -86,29 +170,51 @@ public:
 
     std::vector<LatLon> extractPoly(const OSMWay& way) const;
 
+    /// As extractPoly, keeping the stored fixed-point coordinates
+    std::vector<FixedLatLon> extractFixedPoly(const OSMWay& way) const;
+
+    /// Throws std::out_of_range if there is no such relation
     const OSMRelation& relationFromID(unsigned long long id) const {
-        return *idToRelationMap_.at(id);
+        const unsigned i = relationIndexFromID(id);
+        if (i == -1U)
+            throw std::out_of_range("OSMDatabase::relationFromID");
+        return relations_[i];
     }
 
+    /// Throws std::out_of_range if there is no such way
     const OSMWay& wayFromID(unsigned long long id) const {
-        return *idToWayMap_.at(id);
+        const unsigned i = wayIndexFromID(id);
+        if (i == -1U)
+            throw std::out_of_range("OSMDatabase::wayFromID");
+        return ways_[i];
     }
 
     const OSMWay* wayPtrFromID(unsigned long long id) const {
-        const auto it = idToWayMap_.find(id);
-        if (it != idToWayMap_.end())
-            return it->second;
-        else
-            return nullptr;
+        const unsigned i = wayIndexFromID(id);
+        return i == -1U ? nullptr : &ways_[i];
     }
 
-    const OSMNode& nodeFromID(unsigned long long id) const {
-        return *idToNodeMap_.at(id);
+    /// Index in ways() of the way with the given ID, or -1U if absent
+    unsigned wayIndexFromID(unsigned long long id) const {
+        return indexFromID_(wayIDs_, id);
     }
 
-    const OSMNode* nodePtrFromID(unsigned long long id) const {
-        const auto it = idToNodeMap_.find(id);
-        return it == idToNodeMap_.end() ? nullptr : it->second;
+    /// Index in relations() of the relation with the given ID, or -1U if absent
+    unsigned relationIndexFromID(unsigned long long id) const {
+        return indexFromID_(relationIDs_, id);
+    }
+
+    /// Throws std::out_of_range if there is no such node
+    OSMNodeRef nodeFromID(unsigned long long id) const {
+        const unsigned i = nodes_.indexFromID(id);
+        if (i == -1U)
+            throw std::out_of_range("OSMDatabase::nodeFromID");
+        return nodes_[i];
+    }
+
+    /// Index in nodes() of the node with the given ID, or -1U if absent
+    unsigned nodeIndexFromID(unsigned long long id) const {
+        return nodes_.indexFromID(id);
     }
 
     std::vector<LatLon> corners() const {
@@ -156,16 +262,12 @@ public:
 
 private:
 
-    template<typename OSMEntityRange>std::vector<std::pair<std::string, unsigned>> tagKeys(OSMEntityRange R, const KeyValueTable& tbl) const;
-    template<typename OSMEntityRange>std::vector<std::pair<std::string, unsigned>> tagValuesForKey(const std::string, OSMEntityRange R, const KeyValueTable& tbl) const;
-
-    std::unordered_map<unsigned long long, const OSMNode*> idToNodeMap_;
-    std::unordered_map<unsigned long long, const OSMWay*> idToWayMap_;
-    std::unordered_map<unsigned long long, const OSMRelation*> idToRelationMap_;
+    template<typename OSMEntityRange>std::vector<std::pair<std::string, unsigned>> tagKeys(const OSMEntityRange& R, const KeyValueTable& tbl) const;
+    template<typename OSMEntityRange>std::vector<std::pair<std::string, unsigned>> tagValuesForKey(const std::string, const OSMEntityRange& R, const KeyValueTable& tbl) const;
 
     std::pair<LatLon, LatLon> bounds_ = std::make_pair(LatLon{NAN, NAN}, LatLon{NAN, NAN});
 
-    std::vector<OSMNode> nodes_;
+    OSMNodeTable nodes_;
     KeyValueTable nodeTags_;
 
     std::vector<OSMWay> ways_;
@@ -174,46 +276,92 @@ private:
     std::vector<OSMRelation> relations_;
     KeyValueTable relationTags_;
 
+    // CSR storage which ways_ and relations_ are bound to (see packRefs_)
+    std::vector<unsigned long long> wayNdRefs_;
+    std::vector<std::uint64_t> wayNdRefOffsets_ = std::vector<std::uint64_t>(1, 0);
+    std::vector<OSMRelation::Member> relationMembers_;
+    std::vector<std::uint64_t> relationMemberOffsets_ = std::vector<std::uint64_t>(1, 0);
+
     ValueTable relationMemberRoles_;
 
-    template<class Archive>void serialize(Archive& ar, const unsigned ver) {
-        ar & bounds_ & nodes_ & nodeTags_ & ways_ & wayTags_ & relations_ & relationTags_ & relationMemberRoles_;
-        buildIDMap_();
+    // IDs of ways_ and relations_ (ascending, see indexByID_): searching 8-byte keys touches far fewer cache lines than
+    // searching the entities themselves
+    std::vector<OSMID> wayIDs_;
+    std::vector<OSMID> relationIDs_;
+
+    // the legacy archive format holds the nodes as a std::vector<OSMNode>. Version 0 archives the ways and relations
+    // with their own refs & members; version 1 archives only the entities (ID & tags) followed by the CSR arrays, each
+    // in one piece.
+
+    template<class Archive>void save(Archive& ar, const unsigned ver) const {
+        const std::vector<OSMNode> nodes = nodes_.toNodes();
+        ar & bounds_ & nodes & nodeTags_;
+        saveEntities_(ar, ways_);
+        ar & wayNdRefOffsets_ & wayNdRefs_ & wayTags_;
+        saveEntities_(ar, relations_);
+        ar & relationMemberOffsets_ & relationMembers_ & relationTags_ & relationMemberRoles_;
     }
 
-    void buildIDMap_() {
-        idToWayMap_.clear();
-        idToNodeMap_.clear();
-        idToRelationMap_.clear();
+    template<class Archive>void load(Archive& ar, const unsigned ver) {
+        std::vector<OSMNode> nodes;
+        ar & bounds_ & nodes & nodeTags_;
+        if (ver == 0)
+            ar & ways_ & wayTags_ & relations_ & relationTags_ & relationMemberRoles_;
+        else {
+            loadEntities_(ar, ways_);
+            ar & wayNdRefOffsets_ & wayNdRefs_ & wayTags_;
+            loadEntities_(ar, relations_);
+            ar & relationMemberOffsets_ & relationMembers_ & relationTags_ & relationMemberRoles_;
+            bindRefs_();
+        }
+        nodes_ = OSMNodeTable(std::move(nodes));
+        if (indexByID_() || ver == 0)
+            packRefs_();
+    }
 
-        idToNodeMap_.reserve(nodes_.size());
-        idToRelationMap_.reserve(relations_.size());
-        idToWayMap_.reserve(ways_.size());
+    template<class Archive, class Entity>static void saveEntities_(Archive& ar, const std::vector<Entity>& v) {
+        const std::uint64_t n = v.size();
+        ar & n;
+        for (const Entity& e : v)
+            ar & static_cast<const OSMEntity&> (e);
+    }
 
-        // build ID to entity (node/way/relation) map
-        bool inserted;
-        for (const auto& w : ways_) {
-            tie(std::ignore, inserted) = idToWayMap_.insert(std::make_pair(w.id(), &w));
-            assert(inserted);
-        }
-        for (const auto& r : relations_) {
-            tie(std::ignore, inserted) = idToRelationMap_.insert(std::make_pair(r.id(), &r));
-            assert(inserted);
-        }
-        for (const auto& n : nodes_) {
-            tie(std::ignore, inserted) = idToNodeMap_.insert(std::make_pair(n.id(), &n));
-            assert(inserted);
-        }
+    template<class Archive, class Entity>static void loadEntities_(Archive& ar, std::vector<Entity>& v) {
+        std::uint64_t n = 0;
+        ar & n;
+        v.clear();
+        v.resize(n);
+        for (Entity& e : v)
+            ar & static_cast<OSMEntity&> (e);
+    }
+
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+    /// Gathers the node refs of all ways and the members of all relations into the CSR arrays and binds each entity to its row
+    void packRefs_();
+
+    /// Binds each way and relation to its row of the CSR arrays as they stand (see the CSR constructor)
+    void bindRefs_();
+
+    /// Puts ways_ and relations_ in ascending ID order (already the case for OSM files, so usually just a check) and
+    /// collects their IDs, dropping entities with a repeated ID (keeping the first, with a warning); call before packRefs_ so the CSR
+    /// rows follow the same order. Returns true if either was reordered or shortened, in which case the CSR arrays must
+    /// be repacked.
+    bool indexByID_();
+
+    static unsigned indexFromID_(const std::vector<OSMID>& ids, OSMID id) {
+        const auto it = std::lower_bound(ids.begin(), ids.end(), id);
+        return (it == ids.end() || *it != id) ? -1U : unsigned(it - ids.begin());
     }
 
     friend class boost::serialization::access;
 };
 
-template<typename OSMEntityRange>std::vector<std::pair<std::string, unsigned>> OSMDatabase::tagKeys(OSMEntityRange r, const KeyValueTable& tbl) const {
+template<typename OSMEntityRange>std::vector<std::pair<std::string, unsigned>> OSMDatabase::tagKeys(const OSMEntityRange& r, const KeyValueTable& tbl) const {
     std::vector<std::pair < std::string, unsigned>> v(tbl.keys().size());
 
     for (unsigned ki = 0; ki < v.size(); ++ki)
-        v[ki] = std::make_pair(tbl.keys()[ki], 0);
+        v[ki] = std::make_pair(tbl.getKey(ki).to_string(), 0);
 
     for (const auto& entity : r)
         for (const auto ki : entity.tags() | boost::adaptors::map_keys)
@@ -222,15 +370,13 @@ template<typename OSMEntityRange>std::vector<std::pair<std::string, unsigned>> O
     return v;
 }
 
-template<typename OSMEntityRange>std::vector<std::pair<std::string, unsigned>> OSMDatabase::tagValuesForKey(const std::string k, OSMEntityRange r, const KeyValueTable& tbl) const {
+template<typename OSMEntityRange>std::vector<std::pair<std::string, unsigned>> OSMDatabase::tagValuesForKey(const std::string k, const OSMEntityRange& r, const KeyValueTable& tbl) const {
     // lookup integer ID corresponding to key name k
-    auto p = std::find(tbl.keys().begin(), tbl.keys().end(), k);
+    const unsigned ki = tbl.getIndexForKeyString(k);
 
     std::unordered_map<unsigned, unsigned> m;
 
-    if (p != tbl.keys().end()) {
-        unsigned ki = p - tbl.keys().begin();
-
+    if (ki != -1U) {
         for (const auto& entity : r) {
             for (const auto p : entity.tags() | boost::adaptors::filtered([ki](std::pair<const unsigned, unsigned> p) {
                     return p.first == ki; }))
@@ -243,10 +389,11 @@ template<typename OSMEntityRange>std::vector<std::pair<std::string, unsigned>> O
     std::vector<std::pair < std::string, unsigned>> v;
 
     for (const auto p : m)
-        v.emplace_back(tbl.getValue(p.first), p.second);
+        v.emplace_back(tbl.getValue(p.first).to_string(), p.second);
 
     return v;
 }
 
+BOOST_CLASS_VERSION(OSMDatabase, 1)
 
 #endif /* OSMDATABASE_HPP_ */
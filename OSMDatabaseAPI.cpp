@@ -8,6 +8,7 @@
 #include <fstream>
 #include "OSMDatabaseAPI.h"
 #include "OSMDatabase.hpp"
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -15,71 +16,83 @@
 
 using namespace std;
 
-OSMDatabase osmdb;
+// queries are answered in place from the mapped file; a legacy archive is converted to an in-memory flat image once
+unique_ptr<FlatOSMDatabase> osmdb;
 
 // load the optional layer-1 OSM database
 
 bool loadOSMDatabaseBIN(const std::string& fn) {
-    ifstream is(fn.c_str(), ios_base::in | ios_base::binary);
+    if (flatFileHasMagic(fn, FlatOSMDatabase::s_magic)) {
+        osmdb.reset(new FlatOSMDatabase(fn));
+        return true;
+    }
 
-    boost::archive::binary_iarchive ia(is);
+    // legacy boost::serialization format
+    OSMDatabase db;
+    {
+        ifstream is(fn.c_str(), ios_base::in | ios_base::binary);
 
-    ia & osmdb;
+        boost::archive::binary_iarchive ia(is);
+
+        ia & db;
+    }
+    osmdb.reset(new FlatOSMDatabase(toFlatOSMDatabase(db)));
 
     return true;
 }
 
 void closeOSMDatabase() {
-    osmdb = OSMDatabase();
+    osmdb.reset();
 }
 
 // Query the number of entities in the database
 
 unsigned long long getNumberOfNodes() {
-    return osmdb.nodes().size();
+    return osmdb->nodeCount();
 }
 
 unsigned long long getNumberOfWays() {
-    return osmdb.ways().size();
+    return osmdb->wayCount();
 }
 
 unsigned long long getNumberOfRelations() {
-    return osmdb.relations().size();
+    return osmdb->relationCount();
 }
 
 // Query all nodes in the database, by node index
 
-const OSMNode* getNodeByIndex(unsigned idx) {
-    return &osmdb.nodes().at(idx);
+FlatOSMDatabase::NodeRef getNodeByIndex(unsigned idx) {
+    return osmdb->node(idx);
 }
 
-const OSMWay* getWayByIndex(unsigned idx) {
-    return &osmdb.ways().at(idx);
+FlatOSMDatabase::WayRef getWayByIndex(unsigned idx) {
+    return osmdb->way(idx);
 }
 
-const OSMRelation* getRelationByIndex(unsigned idx) {
-    return &osmdb.relations().at(idx);
+FlatOSMDatabase::RelationRef getRelationByIndex(unsigned idx) {
+    return osmdb->relation(idx);
 }
 
-unsigned getTagCount(const OSMEntity* e) {
-    return e->tags().size();
+unsigned getTagCount(const FlatOSMDatabase::EntityRef& e) {
+    return e.tags().size();
 }
 
-std::pair<std::string, std::string> getTagPair(const OSMEntity* e, unsigned tagIdx) {
-    const OSMNode* n = nullptr;
-    const OSMWay* w = nullptr;
-    const OSMRelation* r = nullptr;
-
-    std::pair<unsigned, unsigned> p = e->tags().at(tagIdx);
+namespace {
 
-    if ((n = dynamic_cast<const OSMNode*> (e)))
-        return osmdb.nodeTags().getKeyValue(p);
-    else if ((w = dynamic_cast<const OSMWay*> (e)))
-        return osmdb.wayTags().getKeyValue(p);
-    else if ((r = dynamic_cast<const OSMRelation*> (e)))
-        return osmdb.relationTags().getKeyValue(p);
+std::pair<std::string, std::string> tagPair(const FlatKeyValueTable& kvt, const FlatOSMDatabase::EntityRef& e, unsigned tagIdx) {
+    const std::pair<boost::string_ref, boost::string_ref> kv = kvt.getKeyValue(e.tags().at(tagIdx));
+    return std::make_pair(kv.first.to_string(), kv.second.to_string());
+}
+}
 
-    assert(false);
+std::pair<std::string, std::string> getTagPair(const FlatOSMDatabase::NodeRef& n, unsigned tagIdx) {
+    return tagPair(osmdb->nodeTags(), n, tagIdx);
 }
 
+std::pair<std::string, std::string> getTagPair(const FlatOSMDatabase::WayRef& w, unsigned tagIdx) {
+    return tagPair(osmdb->wayTags(), w, tagIdx);
+}
 
+std::pair<std::string, std::string> getTagPair(const FlatOSMDatabase::RelationRef& r, unsigned tagIdx) {
+    return tagPair(osmdb->relationTags(), r, tagIdx);
+}
@@ -1,8 +1,7 @@
-#include "OSMEntity.hpp"
+#include "FlatOSMDatabase.hpp"
 
-#include "OSMNode.hpp"
-#include "OSMWay.hpp"
-#include "OSMRelation.hpp"
+#include <string>
+#include <utility>
 
 // load the optional layer-1 OSM database
 bool loadOSMDatabaseBIN(const std::string&);
@@ -14,12 +13,15 @@ unsigned long long getNumberOfWays();
 unsigned long long getNumberOfRelations();
 
 // Query all nodes in the database, by node index
-const OSMNode* getNodeByIndex(unsigned idx);
-const OSMWay* getWayByIndex(unsigned idx);
-const OSMRelation* getRelationByIndex(unsigned idx);
+// Entities are returned as lightweight references into the memory-mapped database, valid until closeOSMDatabase
+FlatOSMDatabase::NodeRef getNodeByIndex(unsigned idx);
+FlatOSMDatabase::WayRef getWayByIndex(unsigned idx);
+FlatOSMDatabase::RelationRef getRelationByIndex(unsigned idx);
 
-// Count number of tags for a given OSMEntity (OSMWay/OSMNode/OSMRelation)
-unsigned getTagCount(const OSMEntity* e);
+// Count number of tags for a given entity (node/way/relation)
+unsigned getTagCount(const FlatOSMDatabase::EntityRef& e);
 
 // Return n'th key-value pair
-std::pair<std::string, std::string> getTagPair(const OSMEntity* e, unsigned idx);
+std::pair<std::string, std::string> getTagPair(const FlatOSMDatabase::NodeRef& n, unsigned idx);
+std::pair<std::string, std::string> getTagPair(const FlatOSMDatabase::WayRef& w, unsigned idx);
+std::pair<std::string, std::string> getTagPair(const FlatOSMDatabase::RelationRef& r, unsigned idx);
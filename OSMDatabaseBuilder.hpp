@@ -16,7 +16,9 @@
 
 #include <boost/container/flat_map.hpp>
 
+#include <cstdint>
 #include <functional>
+#include <vector>
 
 class OSMDatabase;
 
@@ -30,12 +32,35 @@ public:
         nodeTags_.activeEntity(currentNode_);
     }
 
+    /// Adds a fully-formed node (eg. from a decoded PBF block); tags are still added through nodeTags()
+    void addNode(OSMNode&& n) {
+        nodes_.push_back(std::move(n));
+        currentEntity_ = currentNode_ = &nodes_.back();
+        nodeTags_.activeEntity(currentNode_);
+    }
+
     OSMNode* currentNode() const {
         return currentNode_;
     }
 
+    /** Starts a way; its node refs are appended with addNdRef(s) to one array shared by all ways (rather than held by
+     * each way), which becomes the database's array.
+     */
     void addWay() {
         ways_.emplace_back();
+        wayNdRefOffsets_.push_back(wayNdRefs_.size());
+        currentEntity_ = currentWay_ = &ways_.back();
+        wayTags_.activeEntity(currentWay_);
+    }
+
+    /// Adds a way, moving any node refs it holds into the shared array (more can follow with addNdRef)
+    void addWay(OSMWay&& w) {
+        const OSMWay::NdRefRange r = w.ndrefs();
+        wayNdRefs_.insert(wayNdRefs_.end(), r.begin(), r.end());
+        w.bindNdRefs(nullptr, nullptr);
+
+        ways_.push_back(std::move(w));
+        wayNdRefOffsets_.push_back(wayNdRefs_.size());
         currentEntity_ = currentWay_ = &ways_.back();
         wayTags_.activeEntity(currentWay_);
     }
@@ -44,12 +69,48 @@ public:
         return currentWay_;
     }
 
+    /// Appends node refs to the current (last) way
+
+    void addNdRef(unsigned long long id) {
+        wayNdRefs_.push_back(id);
+        wayNdRefOffsets_.back() = wayNdRefs_.size();
+    }
+
+    void addNdRefs(OSMWay::NdRefRange r) {
+        wayNdRefs_.insert(wayNdRefs_.end(), r.begin(), r.end());
+        wayNdRefOffsets_.back() = wayNdRefs_.size();
+    }
+
+    /// Starts a relation; as for ways, its members are appended with addMember(s) to a shared array
     void addRelation() {
         relations_.emplace_back();
+        relationMemberOffsets_.push_back(relationMembers_.size());
         currentEntity_ = currentRelation_ = &relations_.back();
         relationTags_.activeEntity(currentRelation_);
     }
 
+    void addRelation(OSMRelation&& r) {
+        const OSMRelation::MemberRange m = r.members();
+        relationMembers_.insert(relationMembers_.end(), m.begin(), m.end());
+        r.bindMembers(nullptr, nullptr);
+
+        relations_.push_back(std::move(r));
+        relationMemberOffsets_.push_back(relationMembers_.size());
+        currentEntity_ = currentRelation_ = &relations_.back();
+        relationTags_.activeEntity(currentRelation_);
+    }
+
+    /// Appends a member to the current (last) relation
+
+    void addMember(const OSMRelation::Member& m) {
+        relationMembers_.push_back(m);
+        relationMemberOffsets_.back() = relationMembers_.size();
+    }
+
+    void addMember(unsigned long long id, OSMRelation::MemberType type, unsigned role) {
+        addMember(OSMRelation::Member{id, type, role});
+    }
+
     OSMRelation* currentRelation() const {
         return currentRelation_;
     }
@@ -80,6 +141,67 @@ public:
         return relationMemberRoles_;
     }
 
+    /** Entities added so far, tags not yet sorted (eg. to merge builders which each parsed part of a file). The ways
+     * and relations hold no refs or members: those of way i are wayNdRefs(i), and of relation i relationMembers(i).
+     */
+
+    std::vector<OSMNode>& nodes() {
+        return nodes_;
+    }
+
+    std::vector<OSMWay>& ways() {
+        return ways_;
+    }
+
+    std::vector<OSMRelation>& relations() {
+        return relations_;
+    }
+
+    OSMWay::NdRefRange wayNdRefs(std::size_t i) const {
+        return OSMWay::NdRefRange(wayNdRefs_.data() + wayNdRefOffsets_[i], wayNdRefs_.data() + wayNdRefOffsets_[i + 1]);
+    }
+
+    OSMRelation::MemberRange relationMembers(std::size_t i) const {
+        return OSMRelation::MemberRange(relationMembers_.data() + relationMemberOffsets_[i],
+                relationMembers_.data() + relationMemberOffsets_[i + 1]);
+    }
+
+    /// Moves the ways and relations out with their own copies of their refs & members (eg. for a small change file)
+
+    std::vector<OSMWay> releaseWays() {
+        for (std::size_t i = 0; i < ways_.size(); ++i) {
+            ways_[i].bindNdRefs(wayNdRefs(i).begin(), wayNdRefs(i).end());
+            ways_[i] = OSMWay(ways_[i]);
+        }
+        clearRows_(wayNdRefs_, wayNdRefOffsets_);
+        return std::move(ways_);
+    }
+
+    std::vector<OSMRelation> releaseRelations() {
+        for (std::size_t i = 0; i < relations_.size(); ++i) {
+            relations_[i].bindMembers(relationMembers(i).begin(), relationMembers(i).end());
+            relations_[i] = OSMRelation(relations_[i]);
+        }
+        clearRows_(relationMembers_, relationMemberOffsets_);
+        return std::move(relations_);
+    }
+
+    /** Predicates deciding, as each entity is finished, whether it is kept (by default all are). An entity which is not
+     * kept is removed immediately, so it never adds to peak memory; node tags are sorted before the predicate is called.
+     */
+
+    void retainNodes(std::function<bool(const OSMNode&)> f) {
+        retainNode_ = std::move(f);
+    }
+
+    void retainWays(std::function<bool(const OSMWay&)> f) {
+        retainWay_ = std::move(f);
+    }
+
+    void retainRelations(std::function<bool(const OSMRelation&)> f) {
+        retainRelation_ = std::move(f);
+    }
+
     /** Note this is destructive because it moves the vectors.
      *
      */
@@ -96,11 +218,15 @@ public:
 
         return OSMDatabase(
                 bounds,
-                std::move(nodes_),
+                OSMNodeTable(std::move(nodes_)),
                 std::move(nodeTags_),
                 std::move(ways_),
+                std::move(wayNdRefs_),
+                std::move(wayNdRefOffsets_),
                 std::move(wayTags_),
                 std::move(relations_),
+                std::move(relationMembers_),
+                std::move(relationMemberOffsets_),
                 std::move(relationTags_),
                 std::move(relationMemberRoles_));
     }
@@ -123,6 +249,21 @@ private:
     std::vector<OSMNode> nodes_;
     std::vector<OSMWay> ways_;
 
+    // refs & members of ways_ and relations_, row i being [offsets[i], offsets[i+1]); the last row is the current entity's
+    std::vector<unsigned long long> wayNdRefs_;
+    std::vector<std::uint64_t> wayNdRefOffsets_ = std::vector<std::uint64_t>(1, 0);
+    std::vector<OSMRelation::Member> relationMembers_;
+    std::vector<std::uint64_t> relationMemberOffsets_ = std::vector<std::uint64_t>(1, 0);
+
+    template<class T>static void clearRows_(std::vector<T>& a, std::vector<std::uint64_t>& offsets) {
+        std::vector<T>().swap(a);
+        offsets.assign(1, 0);
+    }
+
+    std::function<bool(const OSMNode&)> retainNode_;
+    std::function<bool(const OSMWay&)> retainWay_;
+    std::function<bool(const OSMRelation&)> retainRelation_;
+
     //OSMBounds 					bounds_;
     //OSMMap 						map_;
 
@@ -142,14 +283,45 @@ template<>inline void OSMDatabaseBuilder::createNew<OSMWay>() {
 }
 
 template<>inline void OSMDatabaseBuilder::finishEntity<OSMNode>() {
+    if (retainNode_ && currentNode_) {
+        currentNode_->sortTags();
+        if (!retainNode_(*currentNode_))
+            nodes_.pop_back();
+    }
     currentEntity_ = currentNode_ = nullptr;
 }
 
+// the predicate sees the way/relation bound to its row for the duration of the call
+
 template<>inline void OSMDatabaseBuilder::finishEntity<OSMRelation>() {
+    if (retainRelation_ && currentRelation_) {
+        const OSMRelation::MemberRange m = relationMembers(relations_.size() - 1);
+        currentRelation_->bindMembers(m.begin(), m.end());
+        const bool keep = retainRelation_(*currentRelation_);
+        currentRelation_->bindMembers(nullptr, nullptr);
+
+        if (!keep) {
+            relations_.pop_back();
+            relationMemberOffsets_.pop_back();
+            relationMembers_.resize(relationMemberOffsets_.back());
+        }
+    }
     currentEntity_ = currentRelation_ = nullptr;
 }
 
 template<>inline void OSMDatabaseBuilder::finishEntity<OSMWay>() {
+    if (retainWay_ && currentWay_) {
+        const OSMWay::NdRefRange r = wayNdRefs(ways_.size() - 1);
+        currentWay_->bindNdRefs(r.begin(), r.end());
+        const bool keep = retainWay_(*currentWay_);
+        currentWay_->bindNdRefs(nullptr, nullptr);
+
+        if (!keep) {
+            ways_.pop_back();
+            wayNdRefOffsets_.pop_back();
+            wayNdRefs_.resize(wayNdRefOffsets_.back());
+        }
+    }
     currentEntity_ = currentWay_ = nullptr;
 }
 
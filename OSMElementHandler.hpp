@@ -30,6 +30,7 @@
 #include "OSMRelation.hpp"
 #include "SAX2AttributeHandler.hpp"
 #include "SAX2ElementHandler.hpp"
+#include "NumberParser.hpp"
 
 
 
@@ -188,12 +189,10 @@ private:
 		else
 		{
 			unsigned long long id;
-			std::string s = XMLChString(attrs.getValue((XMLSize_t)0));
-			std::stringstream ss(s);
-			ss >> id;
-			if (ss.fail())
-				std::cerr << "ERROR: Failed to parse '" << s << "' as integer node reference" << std::endl;
-			dbb_->currentWay()->addNode(id);			// add this node to the current way
+			const XMLCh* v = attrs.getValue((XMLSize_t)0);
+			if (!parseNumber(v,id))
+				std::cerr << "ERROR: Failed to parse '" << std::string(XMLChString(v)) << "' as integer node reference" << std::endl;
+			dbb_->addNdRef(id);						// add this node to the current way
 		}
 	}
 };
@@ -239,7 +238,7 @@ private:
 		if (type_ == OSMRelation::InvalidType || id_ == -1U || role_ == -1U)
 			std::cerr << "ERROR: Invalid relation member type" << std::endl;
 		else
-			dbb_->currentRelation()->addMember(id_,type_,role_);
+			dbb_->addMember(id_,type_,role_);
 
 		type_ = OSMRelation::MemberType::InvalidType;
 		id_ = -1U;
@@ -45,6 +45,13 @@ public:
     }
 
 
+    /// Translates key & value indices through the given maps (eg. when moving the entity to a different string table)
+
+    template<class KeyMap, class ValueMap>void remapTags(const KeyMap& keys, const ValueMap& values) {
+        for (auto& t : tags_)
+            t = std::make_pair(keys[t.first], values[t.second]);
+    }
+
     /// Must call this to sort the tags by key index before calling any of the functions listed below
 
     void sortTags() {
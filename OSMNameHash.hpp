@@ -0,0 +1,113 @@
+/*
+ * OSMNameHash.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef OSMNAMEHASH_HPP_
+#define OSMNAMEHASH_HPP_
+
+#include <type_traits>
+
+/** Perfect hash over the element and attribute names of the OSM XML vocabulary, used by FlatMapSAX2ElementHandler to
+ * dispatch with an array index instead of a string map search.
+ *
+ * The hash combines the first two characters, the last character and the length, so computing it and confirming the
+ * match is a scan of at most maxLength characters. The slot -> name table is built at compile time, and static_asserts
+ * check that the hash is collision-free over the vocabulary; to add a name, append it to names[] and if the assertion
+ * fails find new multipliers.
+ *
+ * slot() works on any character type (XMLCh or char) and returns -1U for names outside the vocabulary.
+ */
+
+namespace OSMNameHash {
+
+constexpr const char* names[] = {
+		"osm", "bounds", "node", "way", "relation", "tag", "nd", "member",
+		"id", "lat", "lon", "timestamp", "version", "changeset", "uid", "user", "generator", "origin",
+		"minlat", "minlon", "maxlat", "maxlon", "ref", "role", "type", "k", "v" };
+
+constexpr unsigned nNames = sizeof(names)/sizeof(names[0]);
+
+constexpr unsigned tableSize = 64;
+constexpr unsigned maxLength = 9;
+
+constexpr unsigned hash(unsigned c0,unsigned c1,unsigned cLast,unsigned length)
+{
+	return (c0 + c1 + 4*cLast + 26*length) % tableSize;
+}
+
+constexpr unsigned length(const char* s)
+{
+	return *s ? 1+length(s+1) : 0;
+}
+
+constexpr unsigned hash(const char* s)
+{
+	return hash((unsigned char)s[0],(unsigned char)s[1],(unsigned char)s[length(s)-1],length(s));
+}
+
+
+
+// compile-time construction & checking of the table
+
+constexpr const char* nameForSlot(unsigned slot,unsigned i=0)
+{
+	return i == nNames ? nullptr : hash(names[i]) == slot ? names[i] : nameForSlot(slot,i+1);
+}
+
+constexpr bool collides(unsigned i,unsigned j)
+{
+	return j < nNames && (hash(names[i]) == hash(names[j]) || collides(i,j+1));
+}
+
+constexpr bool perfect(unsigned i=0)
+{
+	return i == nNames || (!collides(i,i+1) && length(names[i]) <= maxLength && perfect(i+1));
+}
+
+static_assert(perfect(),"OSMNameHash multipliers are not a perfect hash over the names; choose new ones");
+
+#define OSMNAMEHASH_SLOTS8(i) nameForSlot(i),nameForSlot(i+1),nameForSlot(i+2),nameForSlot(i+3),\
+	nameForSlot(i+4),nameForSlot(i+5),nameForSlot(i+6),nameForSlot(i+7)
+
+constexpr const char* slotNames[tableSize] = {
+		OSMNAMEHASH_SLOTS8(0), 	OSMNAMEHASH_SLOTS8(8), 	OSMNAMEHASH_SLOTS8(16), OSMNAMEHASH_SLOTS8(24),
+		OSMNAMEHASH_SLOTS8(32), OSMNAMEHASH_SLOTS8(40), OSMNAMEHASH_SLOTS8(48), OSMNAMEHASH_SLOTS8(56) };
+
+#undef OSMNAMEHASH_SLOTS8
+
+static_assert(tableSize == 64,"slotNames initializer must cover tableSize slots");
+
+
+
+/// Returns the slot of the null-terminated name s, or -1U if s is not in the vocabulary
+template<typename CharT>inline unsigned slot(const CharT* s)
+{
+	typedef typename std::make_unsigned<CharT>::type UCharT;
+
+	unsigned n=0;
+	while(s[n])
+		if (++n > maxLength)
+			return -1U;
+
+	if (n == 0)
+		return -1U;
+
+	const unsigned h = hash(UCharT(s[0]),UCharT(s[1]),UCharT(s[n-1]),n);
+	const char* k = slotNames[h];
+
+	if (!k)
+		return -1U;
+
+	for(unsigned i=0;i<n;++i)
+		if (UCharT(s[i]) != (unsigned char)k[i])
+			return -1U;
+
+	return k[n] == 0 ? h : -1U;
+}
+
+}
+
+#endif /* OSMNAMEHASH_HPP_ */
@@ -8,6 +8,7 @@
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/utility.hpp>
 #include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 
 #include "LatLon.h"
 
@@ -15,14 +16,24 @@
 
 class OSMNode : public OSMEntity {
 public:
-    OSMNode(unsigned long long id_ = 0, float lat = std::numeric_limits<float>::quiet_NaN(), float lon = std::numeric_limits<float>::quiet_NaN()) : OSMEntity(id_), coords_{lat, lon}
+    OSMNode(unsigned long long id_ = 0, float lat = std::numeric_limits<float>::quiet_NaN(), float lon = std::numeric_limits<float>::quiet_NaN()) :
+    OSMEntity(id_), coords_(FixedLatLon::fromDegrees(lat), FixedLatLon::fromDegrees(lon))
     {
     }
+
+    OSMNode(unsigned long long id_, FixedLatLon ll) : OSMEntity(id_), coords_(ll)
+    {
+    }
+
     OSMNode(OSMNode&&) = default;
     OSMNode(const OSMNode&) = default;
     OSMNode& operator=(OSMNode&&) = default;
 
     void coords(LatLon pos) {
+        coords_ = FixedLatLon(pos);
+    }
+
+    void coords(FixedLatLon pos) {
         coords_ = pos;
     }
 
@@ -30,19 +41,33 @@ public:
         return coords_;
     }
 
-    LatLon& coords() {
+    /// Stored coordinates (1e-7 degree fixed point)
+    FixedLatLon fixedCoords() const {
+        return coords_;
+    }
+
+    FixedLatLon& fixedCoords() {
         return coords_;
     }
 
     friend std::ostream& operator<<(std::ostream&, const OSMNode&);
 
 private:
-    LatLon coords_;
+    FixedLatLon coords_;
 
-    template<class Archive>void serialize(Archive& ar, const unsigned) {
-        ar & boost::serialization::base_object<OSMEntity>(*this) & coords_;
+    // version 0 archives hold float LatLon coordinates
+    template<class Archive>void serialize(Archive& ar, const unsigned ver) {
+        ar & boost::serialization::base_object<OSMEntity>(*this);
+        if (ver == 0) {
+            LatLon ll;
+            ar & ll;
+            coords_ = FixedLatLon(ll);
+        } else
+            ar & coords_;
     }
     friend boost::serialization::access;
 };
 
+BOOST_CLASS_VERSION(OSMNode, 1)
+
 std::ostream& operator<<(std::ostream&, const OSMNode&);
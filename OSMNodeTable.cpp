@@ -0,0 +1,55 @@
+/*
+ * OSMNodeTable.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "OSMNodeTable.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+unsigned OSMNodeRef::getValueForKey(unsigned ki) const {
+    const TagRange t = tags();
+    const auto it = std::lower_bound(t.begin(), t.end(), ki, [](const Tag& tag, unsigned k) {
+        return tag.first < k; });
+    return (it == t.end() || it->first != ki) ? -1U : it->second;
+}
+
+OSMNodeTable::OSMNodeTable(vector<OSMNode>&& nodes) : OSMNodeTable() {
+    if (!std::is_sorted(nodes.begin(), nodes.end(), OSMEntity::osmIDLess))
+        std::stable_sort(nodes.begin(), nodes.end(), OSMEntity::osmIDLess);
+
+    size_t nTags = 0;
+    for (const auto& n : nodes)
+        nTags += n.tags().size();
+
+    reserve(nodes.size(), nTags);
+
+    for (const auto& n : nodes)
+        push_back(n);
+
+    vector<OSMNode>().swap(nodes);
+}
+
+unsigned OSMNodeTable::indexFromID(OSMID id) const {
+    const auto it = std::lower_bound(ids_.begin(), ids_.end(), id);
+    return (it == ids_.end() || *it != id) ? -1U : unsigned(it - ids_.begin());
+}
+
+OSMNode OSMNodeTable::node(size_t i) const {
+    OSMNode n(ids_.at(i), coords_[i]);
+    for (const Tag& t : tags(i))
+        n.addTag(t.first, t.second);
+    return n;
+}
+
+vector<OSMNode> OSMNodeTable::toNodes() const {
+    vector<OSMNode> v;
+    v.reserve(size());
+    for (size_t i = 0; i < size(); ++i)
+        v.push_back(node(i));
+    return v;
+}
@@ -0,0 +1,296 @@
+/*
+ * OSMNodeTable.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef OSMNODETABLE_HPP_
+#define OSMNODETABLE_HPP_
+
+#include "OSMNode.hpp"
+#include "LatLon.h"
+#include "OSMEntityType.h"
+
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <boost/range/iterator_range.hpp>
+
+class OSMNodeTable;
+
+/** Lightweight value reference to a node of an OSMNodeTable, with the accessors of OSMNode (id, coords, tags and the
+ * tag lookups, which require tags sorted by key as OSMDatabase keeps them). Valid while the table is unchanged.
+ */
+
+class OSMNodeRef {
+public:
+    typedef std::pair<unsigned, unsigned> Tag;
+    typedef boost::iterator_range<const Tag*> TagRange;
+
+    OSMNodeRef(const OSMNodeTable* t, std::size_t i) : table_(t), i_(i) {
+    }
+
+    OSMID id() const;
+    LatLon coords() const;
+    FixedLatLon fixedCoords() const;
+    TagRange tags() const;
+
+    /// Position of the node in its table (as used for nodeVectorIndex)
+    std::size_t index() const {
+        return i_;
+    }
+
+    /// Binary search for the value index of key ki; -1U if absent
+    unsigned getValueForKey(unsigned ki) const;
+
+    bool hasTag(unsigned ki) const {
+        return getValueForKey(ki) != -1U;
+    }
+
+    bool hasTagWithValue(unsigned ki, unsigned vi) const {
+        return vi != -1U && getValueForKey(ki) == vi;
+    }
+
+    /// Copies the node into a stand-alone OSMNode
+    OSMNode node() const;
+
+private:
+    const OSMNodeTable* table_;
+    std::size_t i_;
+};
+
+/** Columnar storage for the nodes of an OSMDatabase: ascending IDs, packed fixed-point coordinates, and tags in CSR form
+ * (N+1 offsets into one tag array shared by all nodes).
+ *
+ * An untagged node costs 24 bytes and no allocation, against an OSMNode with its vtable pointer and own (mostly empty)
+ * tag vector, and scans over coordinates (bounding boxes, projection) read one contiguous array.
+ *
+ * The table reads like a const std::vector<OSMNode> (size, [], at, iteration) except that elements are OSMNodeRef
+ * values; use node(i) or toNodes() where a real OSMNode is needed. Nodes are kept in ascending ID order so that
+ * indexFromID is a binary search.
+ */
+
+class OSMNodeTable {
+public:
+    typedef OSMNodeRef::Tag Tag;
+    typedef OSMNodeRef::TagRange TagRange;
+
+    class const_iterator {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef OSMNodeRef value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const OSMNodeRef* pointer;
+        typedef OSMNodeRef reference;
+
+        const_iterator() {
+        }
+
+        const_iterator(const OSMNodeTable* t, std::size_t i) : table_(t), i_(i) {
+        }
+
+        OSMNodeRef operator*() const {
+            return OSMNodeRef(table_, i_);
+        }
+
+        OSMNodeRef operator[](std::ptrdiff_t n) const {
+            return OSMNodeRef(table_, i_ + n);
+        }
+
+        const_iterator& operator++() {
+            ++i_;
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator t(*this);
+            ++i_;
+            return t;
+        }
+
+        const_iterator& operator--() {
+            --i_;
+            return *this;
+        }
+
+        const_iterator operator--(int) {
+            const_iterator t(*this);
+            --i_;
+            return t;
+        }
+
+        const_iterator& operator+=(std::ptrdiff_t n) {
+            i_ += n;
+            return *this;
+        }
+
+        const_iterator& operator-=(std::ptrdiff_t n) {
+            i_ -= n;
+            return *this;
+        }
+
+        const_iterator operator+(std::ptrdiff_t n) const {
+            return const_iterator(table_, i_ + n);
+        }
+
+        const_iterator operator-(std::ptrdiff_t n) const {
+            return const_iterator(table_, i_ - n);
+        }
+
+        std::ptrdiff_t operator-(const_iterator rhs) const {
+            return std::ptrdiff_t(i_) - std::ptrdiff_t(rhs.i_);
+        }
+
+        bool operator==(const_iterator rhs) const {
+            return i_ == rhs.i_;
+        }
+
+        bool operator!=(const_iterator rhs) const {
+            return i_ != rhs.i_;
+        }
+
+        bool operator<(const_iterator rhs) const {
+            return i_ < rhs.i_;
+        }
+
+        bool operator>(const_iterator rhs) const {
+            return i_ > rhs.i_;
+        }
+
+        bool operator<=(const_iterator rhs) const {
+            return i_ <= rhs.i_;
+        }
+
+        bool operator>=(const_iterator rhs) const {
+            return i_ >= rhs.i_;
+        }
+
+    private:
+        const OSMNodeTable* table_ = nullptr;
+        std::size_t i_ = 0;
+    };
+
+    typedef const_iterator iterator;
+    typedef OSMNodeRef value_type;
+    typedef std::size_t size_type;
+
+    OSMNodeTable() : tagOffsets_(1, 0) {
+    }
+
+    /// Packs the nodes, sorting them by ID first if needed (stable, so duplicate IDs keep their order); consumes nodes
+    explicit OSMNodeTable(std::vector<OSMNode>&& nodes);
+
+    std::size_t size() const {
+        return ids_.size();
+    }
+
+    bool empty() const {
+        return ids_.empty();
+    }
+
+    void reserve(std::size_t nNodes, std::size_t nTags) {
+        ids_.reserve(nNodes);
+        coords_.reserve(nNodes);
+        tagOffsets_.reserve(nNodes + 1);
+        tags_.reserve(nTags);
+    }
+
+    /// Appends a node; IDs must be appended in ascending order, and tags sorted by key
+    template<class TagRangeT>void push_back(OSMID id, FixedLatLon ll, const TagRangeT& tags) {
+        assert(ids_.empty() || ids_.back() <= id);
+        ids_.push_back(id);
+        coords_.push_back(ll);
+        tags_.insert(tags_.end(), std::begin(tags), std::end(tags));
+        tagOffsets_.push_back(tags_.size());
+    }
+
+    void push_back(const OSMNode& n) {
+        push_back(n.id(), n.fixedCoords(), n.tags());
+    }
+
+    void push_back(OSMNodeRef n) {
+        push_back(n.id(), n.fixedCoords(), n.tags());
+    }
+
+    OSMNodeRef operator[](std::size_t i) const {
+        return OSMNodeRef(this, i);
+    }
+
+    /// Throws std::out_of_range if i is not a valid index
+    OSMNodeRef at(std::size_t i) const {
+        if (i >= size())
+            throw std::out_of_range("OSMNodeTable::at");
+        return OSMNodeRef(this, i);
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, size());
+    }
+
+    /// Index of the node with OSM ID id (binary search), or -1U if absent
+    unsigned indexFromID(OSMID id) const;
+
+    const std::vector<OSMID>& ids() const {
+        return ids_;
+    }
+
+    const std::vector<FixedLatLon>& coords() const {
+        return coords_;
+    }
+
+    /// CSR offsets (size()+1) into tagArray()
+    const std::vector<std::uint64_t>& tagOffsets() const {
+        return tagOffsets_;
+    }
+
+    const std::vector<Tag>& tagArray() const {
+        return tags_;
+    }
+
+    TagRange tags(std::size_t i) const {
+        return TagRange(tags_.data() + tagOffsets_[i], tags_.data() + tagOffsets_[i + 1]);
+    }
+
+    /// Copies node i into a stand-alone OSMNode
+    OSMNode node(std::size_t i) const;
+
+    /// Copies every node into a vector (eg. for the legacy Boost serialization format)
+    std::vector<OSMNode> toNodes() const;
+
+private:
+    std::vector<OSMID> ids_;
+    std::vector<FixedLatLon> coords_;
+    std::vector<std::uint64_t> tagOffsets_;
+    std::vector<Tag> tags_;
+};
+
+inline OSMID OSMNodeRef::id() const {
+    return table_->ids()[i_];
+}
+
+inline LatLon OSMNodeRef::coords() const {
+    return table_->coords()[i_];
+}
+
+inline FixedLatLon OSMNodeRef::fixedCoords() const {
+    return table_->coords()[i_];
+}
+
+inline OSMNodeRef::TagRange OSMNodeRef::tags() const {
+    return table_->tags(i_);
+}
+
+inline OSMNode OSMNodeRef::node() const {
+    return table_->node(i_);
+}
+
+#endif /* OSMNODETABLE_HPP_ */
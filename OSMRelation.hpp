@@ -3,8 +3,17 @@
 
 
 
+#include <memory>
 #include <vector>
 
+#include <boost/range/iterator_range.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/vector.hpp>
+
+/** Members are held like the node refs of OSMWay: as a row of the OSMDatabase's (or OSMDatabaseBuilder's) contiguous
+ * member array (see bindMembers), or in a vector of the relation's own if it is built on its own or copied.
+ */
+
 class OSMRelation : public OSMEntity {
 public:
 
@@ -25,27 +34,107 @@ public:
         friend class boost::serialization::access;
     };
 
+    typedef boost::iterator_range<const Member*> MemberRange;
+
     OSMRelation(unsigned long long id = 0) : OSMEntity(id) {
     }
 
+    OSMRelation(const OSMRelation& r) : OSMEntity(r) {
+        own_(r.members());
+    }
+
+    OSMRelation(OSMRelation&& r) : OSMEntity(std::move(r)), begin_(r.begin_), end_(r.end_), owned_(std::move(r.owned_)) {
+        r.begin_ = r.end_ = nullptr;
+    }
+
+    OSMRelation& operator=(const OSMRelation& r) {
+        if (this != &r) {
+            OSMEntity::operator=(r);
+            own_(r.members());
+        }
+        return *this;
+    }
+
+    OSMRelation& operator=(OSMRelation&& r) {
+        if (this != &r) {
+            OSMEntity::operator=(std::move(r));
+            begin_ = r.begin_;
+            end_ = r.end_;
+            owned_ = std::move(r.owned_);
+            r.begin_ = r.end_ = nullptr;
+        }
+        return *this;
+    }
+
     void addMember(unsigned long long id, MemberType type, unsigned role) {
         addMember(Member{id, type, role});
     }
 
     void addMember(const Member m) {
-        members_.push_back(m);
+        ownedMembers_().push_back(m);
+        rebind_();
+    }
+
+    /// Translates member role indices through the given map (eg. when moving the relation to a different role table)
+
+    template<class RoleMap>void remapRoles(const RoleMap& roles) {
+        for (auto& m : ownedMembers_())
+            m.role = roles[m.role];
+        rebind_();
+    }
+
+    MemberRange members() const {
+        return MemberRange(begin_, end_);
     }
 
-    const std::vector<Member>& members() const {
-        return members_;
+    /// Points the relation at members [b,e) held elsewhere, releasing its own; the storage must outlive the relation
+    void bindMembers(const Member* b, const Member* e) {
+        owned_.reset();
+        begin_ = b;
+        end_ = e;
     }
 
 private:
-    std::vector<Member> members_;
+    const Member* begin_ = nullptr;
+    const Member* end_ = nullptr;
+    std::unique_ptr<std::vector<Member>> owned_;
+
+    /// The relation's own vector of members, copied from the bound row first if need be; call rebind_ after changing it
+    std::vector<Member>& ownedMembers_() {
+        if (!owned_)
+            owned_.reset(new std::vector<Member>(begin_, end_));
+        return *owned_;
+    }
+
+    void rebind_() {
+        begin_ = owned_->data();
+        end_ = begin_ + owned_->size();
+    }
 
-    template<class Archive>void serialize(Archive& ar, const unsigned) {
-        ar & boost::serialization::base_object<OSMEntity>(*this) & members_;
+    /// Copies r into a vector of the relation's own (none if empty); r may be a view of the current one
+    void own_(MemberRange r) {
+        if (r.empty())
+            bindMembers(nullptr, nullptr);
+        else {
+            owned_.reset(new std::vector<Member>(r.begin(), r.end()));
+            rebind_();
+        }
+    }
+
+    template<class Archive>void save(Archive& ar, const unsigned) const {
+        ar & boost::serialization::base_object<OSMEntity>(*this);
+        const std::vector<Member> v(begin_, end_);
+        ar & v;
     }
+
+    template<class Archive>void load(Archive& ar, const unsigned) {
+        std::vector<Member> v;
+        ar & boost::serialization::base_object<OSMEntity>(*this) & v;
+        own_(MemberRange(v.data(), v.data() + v.size()));
+    }
+
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
     friend boost::serialization::access;
 
 };
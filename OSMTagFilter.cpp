@@ -0,0 +1,442 @@
+/*
+ * OSMTagFilter.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "OSMTagFilter.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+/// Returns true (and the prefix) if expr is a literal followed by ".*"
+bool regexIsPrefix(const string& expr,string& prefix)
+{
+	if (expr.size() < 2 || expr.compare(expr.size()-2,2,".*") != 0)
+		return false;
+
+	prefix = expr.substr(0,expr.size()-2);
+	return prefix.find_first_of("\\^$.|?*+()[]{}") == string::npos;
+}
+
+}
+
+OSMTagKeyClassifier::OSMTagKeyClassifier() :
+	m_rules{ Rule{ "default keep", true } },
+	m_nodes(1)
+{
+}
+
+OSMTagKeyClassifier::OSMTagKeyClassifier(const OSMTagFilter& f)
+{
+	// build a pointer trie, then lay it out breadth-first so each node's edges are contiguous
+	struct BuildNode
+	{
+		map<char,unsigned> 	children;
+		unsigned 			exact=-1U;
+		unsigned 			prefix=-1U;
+	};
+
+	vector<BuildNode> T(1);
+
+	// Keep takes precedence over Ignore for the same string
+	auto add = [this,&T](const string& k,unsigned rule,unsigned BuildNode::* which)
+	{
+		unsigned n=0;
+		for(const char c : k)
+		{
+			auto it = T[n].children.find(c);
+			if (it == T[n].children.end())
+			{
+				it = T[n].children.insert(make_pair(c,unsigned(T.size()))).first;
+				T.emplace_back();
+			}
+			n = it->second;
+		}
+		if (T[n].*which == -1U || !m_rules[T[n].*which].keep)
+			T[n].*which = rule;
+	};
+
+	auto addRule = [this](const string& name,bool keep)
+	{
+		m_rules.push_back(Rule{ name, keep });
+		return unsigned(m_rules.size()-1);
+	};
+
+	for(const auto& k : f.keep)
+		add(k,addRule("keep " + k,true),&BuildNode::exact);
+
+	for(const auto& k : f.ignore)
+		add(k,addRule("ignore " + k,false),&BuildNode::exact);
+
+	for(const auto& k : f.keepPrefix)
+		add(k,addRule("keep " + k + "*",true),&BuildNode::prefix);
+
+	for(const auto& k : f.ignorePrefix)
+		add(k,addRule("ignore " + k + "*",false),&BuildNode::prefix);
+
+	string prefix;
+	for(const auto& expr : f.ignoreRegex)
+	{
+		const unsigned rule = addRule("ignore-regex " + expr,false);
+		if (regexIsPrefix(expr,prefix))
+			add(prefix,rule,&BuildNode::prefix);
+		else
+			m_ignoreRegex.emplace_back(regex(expr),rule);
+	}
+
+	m_defaultRule = addRule(f.keepOthers ? "default keep" : "default ignore",f.keepOthers);
+
+	vector<unsigned> order(1,0);			// build node index of each output node
+	vector<unsigned> idx(T.size());			// output index of each build node
+
+	m_nodes.resize(T.size());
+
+	for(unsigned i=0;i<order.size();++i)
+	{
+		const BuildNode& b = T[order[i]];
+		Node& n = m_nodes[i];
+
+		n.exact = b.exact;
+		n.prefix = b.prefix;
+		n.firstEdge = m_edges.size();
+		n.nEdges = b.children.size();
+
+		for(const auto& c : b.children)
+		{
+			idx[c.second] = order.size();
+			m_edges.emplace_back(c.first,idx[c.second]);
+			order.push_back(c.second);
+		}
+	}
+}
+
+unsigned OSMTagKeyClassifier::child(unsigned n,char c) const
+{
+	const auto b = m_edges.begin()+m_nodes[n].firstEdge;
+	const auto e = b+m_nodes[n].nEdges;
+
+	const auto it = lower_bound(b,e,c,[](const pair<char,unsigned>& edge,char c){ return edge.first < c; });
+
+	return it != e && it->first == c ? it->second : -1U;
+}
+
+unsigned OSMTagKeyClassifier::rule(boost::string_ref k) const
+{
+	unsigned n=0;
+	unsigned r=m_nodes[0].prefix;
+
+	for(const char c : k)
+	{
+		if ((n = child(n,c)) == -1U)
+			break;
+		if (m_nodes[n].prefix != -1U)
+			r = m_nodes[n].prefix;
+	}
+
+	if (n != -1U && m_nodes[n].exact != -1U)
+		return m_nodes[n].exact;
+	else if (r != -1U)
+		return r;
+
+	const string ks = k.to_string();
+	for(const auto& re : m_ignoreRegex)
+		if (regex_match(ks,re.first))
+			return re.second;
+
+	return m_defaultRule;
+}
+
+OSMTagFilterProfile defaultTagFilterProfile()
+{
+	OSMTagFilterProfile p;
+	p.node = defaultNodeTagFilter();
+	p.way = defaultWayTagFilter();
+	p.relation = defaultRelationTagFilter();
+	return p;
+}
+
+OSMTagFilterProfile loadTagFilterProfile(const std::string fn)
+{
+	ifstream is(fn.c_str());
+	if (!is.good())
+		throw runtime_error("Failed to open tag filter profile " + fn);
+
+	OSMTagFilterProfile p = defaultTagFilterProfile();
+	OSMTagFilter* f=nullptr;
+
+	bool seen[3]={ false, false, false };
+
+	auto fail = [&fn](unsigned lineNo,const string& msg)
+	{
+		stringstream ss;
+		ss << fn << ':' << lineNo << ": " << msg;
+		throw runtime_error(ss.str());
+	};
+
+	string line;
+	for(unsigned lineNo=1; getline(is,line); ++lineNo)
+	{
+		const size_t hash = line.find('#');
+		if (hash != string::npos)
+			line.resize(hash);
+
+		const size_t b = line.find_first_not_of(" \t\r");
+		if (b == string::npos)
+			continue;
+		line = line.substr(b,line.find_last_not_of(" \t\r")+1-b);
+
+		if (line.front() == '[')
+		{
+			static const char* sections[3] = { "[node]", "[way]", "[relation]" };
+			OSMTagFilter* filters[3] = { &p.node, &p.way, &p.relation };
+
+			unsigned i;
+			for(i=0;i<3 && line != sections[i];++i){}
+
+			if (i == 3)
+				fail(lineNo,"unknown section '" + line + "' (expecting [node], [way] or [relation])");
+
+			f = filters[i];
+			if (!seen[i])
+				*f = OSMTagFilter();
+			seen[i] = true;
+			continue;
+		}
+
+		const size_t sp = line.find_first_of(" \t");
+		const string cmd = line.substr(0,sp);
+		const string arg = sp == string::npos ? string() : line.substr(line.find_first_not_of(" \t",sp));
+
+		if (!f)
+			fail(lineNo,"rule before the first section");
+		else if (arg.empty())
+			fail(lineNo,"missing argument to '" + cmd + "'");
+
+		const bool prefix = arg.back() == '*';
+		const string k = prefix ? arg.substr(0,arg.size()-1) : arg;
+
+		if (cmd == "keep")
+			(prefix ? f->keepPrefix : f->keep).push_back(k);
+		else if (cmd == "ignore")
+			(prefix ? f->ignorePrefix : f->ignore).push_back(k);
+		else if (cmd == "ignore-regex")
+		{
+			try {
+				regex re(arg);
+			}
+			catch(regex_error& e)
+			{
+				fail(lineNo,"invalid regular expression '" + arg + "': " + e.what());
+			}
+			f->ignoreRegex.push_back(arg);
+		}
+		else if (cmd == "default")
+		{
+			if (arg == "keep" || arg == "ignore")
+				f->keepOthers = arg == "keep";
+			else
+				fail(lineNo,"expecting 'default keep' or 'default ignore'");
+		}
+		else
+			fail(lineNo,"unknown rule '" + cmd + "' (expecting keep, ignore, ignore-regex or default)");
+	}
+
+	return p;
+}
+
+OSMTagFilter defaultNodeTagFilter()
+{
+	OSMTagFilter f;
+
+	f.keep = { "name" };
+
+	f.ignore = {
+		"source",
+		"created_by",
+		"crossing",
+		"gates",
+		"lights",
+		"go_zone",
+		"crossing_ref",
+		"red_light_camera",
+		"button",
+		"wheelchair",
+		"fixme",
+		"noexit",
+		"guidepost",
+		"layer",
+		"power",
+		"aeroway",
+		"drive_through",
+		"dispensing",
+		"alt_name",
+		"drive_thru",
+		"brand",
+		"opening_hours",
+		"tower:type",
+		"phone",
+		"barrier",
+		"traffic_calming",
+		"emergency",
+		"note",
+		"fee",
+		"fireplace",
+		"FIXME",
+		"indoor",
+		"old_name",
+		"internet_access",
+		"building:levels",
+		"board_type",
+		"information",
+		"office",
+		"route",
+		"attribution",
+		"material",
+		"contents",
+		"height",
+		"works:type",
+		"pipeline",
+		"landuse",
+		"content",
+		"color",
+		"trim",
+		"bench",
+		"countdown_signal",
+		"covered",
+		"hiking",
+		"map_size",
+		"map_type",
+		"entrance",
+		"toilets",
+		"signal",
+		"colour",
+		"designation",
+		"motor_vehicle",
+		"vehicle",
+		"disused",
+		"vending",
+		"email",
+		"smoking",
+		"capacity",
+		"computer",
+		"backrest",
+		"street_lamp",
+		"booth",
+		"banquet",
+		"crossing:barrier",
+		"crossing:bell",
+		"supervised",
+		"lanes",
+		"surface",
+		"motorcar",
+		"bollard",
+		"url",
+		"services",
+		"seats",
+		"tactile_paving"
+	};
+
+	f.ignorePrefix = {
+		"addr:",
+		"name:",
+		"is_in",
+		"payment:",
+		"contact:",
+		"currency:",
+		"canvec:",
+		"generator:",
+		"toilets:",
+		"wetap:"
+	};
+
+	return f;
+}
+
+OSMTagFilter defaultWayTagFilter()
+{
+	OSMTagFilter f;
+
+	f.keep = { "name", "name:en" };
+
+	f.ignore = {
+		"source",
+		"electrified",
+		"gauge",
+		"line",
+		"operator",
+		"created_by",
+		"handrail:right",
+		"handrail:left",
+		"attribution",
+		"note",
+		"FIXME",
+		"alt_name",
+		"wikipedia",
+		"website",
+		"voltage",
+		"fee",
+		"park_ride",
+		"iata",
+		"parking:condition:area",
+		"validate:no_name",
+		"trail_visibility",
+		"color",
+		"evangelical",
+		"start_date",
+		"fireplace",
+		"fax",
+		"roof:height"
+	};
+
+	f.ignorePrefix = {
+		"geobase:",
+		"canvec:",
+		"statscan:",
+		"addr:",
+		"name:",
+		"payment:",
+		"capacity:"
+	};
+
+	return f;
+}
+
+OSMTagFilter defaultRelationTagFilter()
+{
+	OSMTagFilter f;
+
+	f.keep = { "name", "name:en" };
+
+	f.ignore = {
+		"wikipedia",
+		"note",
+		"attribution",
+		"is_in",
+		"fixme",
+		"day_off",
+		"day_on",
+		"hour_off",
+		"hour_on",
+		"FXIME",
+		"FIXME",
+		"source"
+	};
+
+	f.ignorePrefix = {
+		"name:",
+		"canvec:",
+		"wikipedia:",
+		"addr:"
+	};
+
+	return f;
+}
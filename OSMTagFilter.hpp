@@ -0,0 +1,125 @@
+/*
+ * OSMTagFilter.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef OSMTAGFILTER_HPP_
+#define OSMTAGFILTER_HPP_
+
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/utility/string_ref.hpp>
+
+/** Describes which tag keys are stored for one entity type (node/way/relation).
+ *
+ * Keys in keep are always stored and are added to the key table up front, so they get the lowest indices. Otherwise the
+ * first applicable rule decides:
+ *
+ *   1. key is in ignore -> dropped
+ *   2. longest of keepPrefix/ignorePrefix which begins the key -> stored/dropped
+ *   3. key fully matches one of ignoreRegex -> dropped
+ *   4. keepOthers
+ *
+ * The parsers compile this into an OSMTagKeyClassifier and evaluate it once per distinct key.
+ */
+
+struct OSMTagFilter {
+	std::vector<std::string>	keep;
+	std::vector<std::string>	keepPrefix;
+	std::vector<std::string>	ignore;
+	std::vector<std::string>	ignorePrefix;
+	std::vector<std::string>	ignoreRegex;		// std::regex (ECMAScript); "literal.*" is treated as a prefix
+	bool 						keepOthers=true;
+};
+
+
+
+/** An OSMTagFilter compiled into a single prefix trie, which classifies a key in one pass over its characters.
+ *
+ * Only the ignoreRegex expressions which are not simple prefixes remain as std::regex, and are tried only for keys the
+ * trie does not decide.
+ *
+ * rule() also tells which rule decided, named as in a profile (eg. "ignore tiger:*", "default keep"), for statistics.
+ */
+
+class OSMTagKeyClassifier
+{
+public:
+	/// Classifier which keeps every key
+	OSMTagKeyClassifier();
+
+	explicit OSMTagKeyClassifier(const OSMTagFilter& f);
+
+	/// Returns true if a tag with key k should be stored
+	bool keep(boost::string_ref k) const { return m_rules[rule(k)].keep; }
+
+	/// Returns the index of the rule which decides key k
+	unsigned rule(boost::string_ref k) const;
+
+	unsigned rules() const { return m_rules.size(); }
+	const std::string& ruleName(unsigned i) const { return m_rules[i].name; }
+	bool ruleKeeps(unsigned i) const { return m_rules[i].keep; }
+
+private:
+	struct Rule
+	{
+		std::string 	name;
+		bool 			keep;
+	};
+
+	struct Node
+	{
+		unsigned 	firstEdge=0;
+		unsigned 	nEdges=0;
+		unsigned 	exact=-1U;			// rule for a key which ends at this node
+		unsigned 	prefix=-1U;			// rule for keys which begin with this node's prefix (unless a longer one applies)
+	};
+
+	/// Returns the node reached from n by character c, or -1U if none
+	unsigned child(unsigned n,char c) const;
+
+	std::vector<Rule> 								m_rules;
+	std::vector<Node> 								m_nodes;
+	std::vector<std::pair<char,unsigned>> 			m_edges;		// (character, target node), sorted within each node
+	std::vector<std::pair<std::regex,unsigned>> 	m_ignoreRegex;	// (expression, rule)
+	unsigned 										m_defaultRule=0;
+};
+
+
+
+/** Tag filters for all three entity types, as loaded from a profile file.
+ *
+ * Profile format (one rule per line, '#' starts a comment, blank lines are ignored):
+ *
+ *   [node]                 following rules apply to node tags (also [way], [relation])
+ *   keep name              store key 'name' (index assigned up front)
+ *   keep addr:*            store keys beginning with 'addr:'
+ *   ignore source          drop key 'source'
+ *   ignore tiger:*         drop keys beginning with 'tiger:'
+ *   ignore-regex fixme.*   drop keys fully matching the regular expression
+ *   default ignore         what to do with any other key (keep or ignore; default keep)
+ *
+ * A section replaces the built-in default filter for that entity type; types without a section keep the default.
+ */
+
+struct OSMTagFilterProfile {
+	OSMTagFilter 	node;
+	OSMTagFilter 	way;
+	OSMTagFilter 	relation;
+};
+
+OSMTagFilter defaultNodeTagFilter();
+OSMTagFilter defaultWayTagFilter();
+OSMTagFilter defaultRelationTagFilter();
+
+OSMTagFilterProfile defaultTagFilterProfile();
+
+/// Loads a profile file as described above; throws std::runtime_error if it cannot be read or has a syntax error
+OSMTagFilterProfile loadTagFilterProfile(const std::string fn);
+
+#endif /* OSMTAGFILTER_HPP_ */
@@ -16,6 +16,7 @@
 #include <iostream>
 
 #include "OSMDatabaseBuilder.hpp"
+#include "OSMTagFilter.hpp"
 
 #include <regex>
 
@@ -73,6 +74,30 @@ private:
 
 
 
+/** Applies a compiled tag filter: keys it keeps go to keepH, all others to ignoreH.
+ *
+ */
+
+class OSMTagClassifierKeyRule : public OSMTagKeyRule {
+public:
+	OSMTagClassifierKeyRule(const OSMTagFilter& f,OSMTagHandler* keepH,OSMTagHandler* ignoreH) :
+		classifier_(f),keepH_(keepH),ignoreH_(ignoreH){}
+
+	virtual OSMTagHandler* getHandlerForKey(const std::string s) override
+	{
+		return classifier_.keep(s) ? keepH_ : ignoreH_;
+	}
+
+private:
+	OSMTagKeyClassifier classifier_;
+	OSMTagHandler* keepH_=nullptr;
+	OSMTagHandler* ignoreH_=nullptr;
+};
+
+
+
+
+
 /** Abstract class to handle tag (key,value) pairs.
  *
  * newTagKey will be called at most once on the first occurrence of a given tag key. It returns a subclass-specific integer value,
@@ -1,36 +1,114 @@
 #pragma once
 #include "OSMEntity.hpp"
 
+#include <memory>
 #include <vector>
 
+#include <boost/range/iterator_range.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/vector.hpp>
+
+/** A way's node refs are a view [begin,end). In an OSMDatabase they are a row of the database's contiguous ndref array
+ * (see bindNdRefs) and the way holds nothing else; an OSMDatabaseBuilder likewise keeps the refs of the ways it parses in
+ * its own array. Only a way built on its own (addNode, eg. for a change file) or copied owns a vector of refs, which the
+ * view then points into, so a copy stays valid after the database is gone.
+ */
+
 class OSMWay : public OSMEntity {
 public:
-    OSMWay(const OSMWay&) = default;
-    OSMWay(OSMWay&& w) = default;
-    OSMWay& operator=(const OSMWay&) = default;
+    typedef boost::iterator_range<const unsigned long long*> NdRefRange;
 
     OSMWay(unsigned long long id_ = 0) : OSMEntity(id_) {
     }
 
+    OSMWay(const OSMWay& w) : OSMEntity(w) {
+        own_(w.ndrefs());
+    }
+
+    OSMWay(OSMWay&& w) : OSMEntity(std::move(w)), begin_(w.begin_), end_(w.end_), owned_(std::move(w.owned_)) {
+        w.begin_ = w.end_ = nullptr;
+    }
+
+    OSMWay& operator=(const OSMWay& w) {
+        if (this != &w) {
+            OSMEntity::operator=(w);
+            own_(w.ndrefs());
+        }
+        return *this;
+    }
+
+    OSMWay& operator=(OSMWay&& w) {
+        if (this != &w) {
+            OSMEntity::operator=(std::move(w));
+            begin_ = w.begin_;
+            end_ = w.end_;
+            owned_ = std::move(w.owned_);
+            w.begin_ = w.end_ = nullptr;
+        }
+        return *this;
+    }
+
     void addNode(unsigned long long id_) {
-        ndrefs_.push_back(id_);
+        if (!owned_)
+            owned_.reset(new std::vector<unsigned long long>(begin_, end_));
+        owned_->push_back(id_);
+        rebind_();
     }
 
     bool isClosed() const {
-        return ndrefs_.front() == ndrefs_.back();
+        const NdRefRange r = ndrefs();
+        return r.front() == r.back();
     }
 
     // data access
 
-    const std::vector<unsigned long long>& ndrefs() const {
-        return ndrefs_;
+    NdRefRange ndrefs() const {
+        return NdRefRange(begin_, end_);
+    }
+
+    /// Points the way at refs [b,e) held elsewhere, releasing its own; the storage must outlive the way (or its next bind)
+    void bindNdRefs(const unsigned long long* b, const unsigned long long* e) {
+        owned_.reset();
+        begin_ = b;
+        end_ = e;
     }
 
 private:
-    std::vector<unsigned long long> ndrefs_;
+    const unsigned long long* begin_ = nullptr;
+    const unsigned long long* end_ = nullptr;
+    std::unique_ptr<std::vector<unsigned long long>> owned_;
+
+    /// Copies r into a vector of the way's own (none if empty); r may be a view of the current one
+    void own_(NdRefRange r) {
+        if (r.empty())
+            bindNdRefs(nullptr, nullptr);
+        else {
+            owned_.reset(new std::vector<unsigned long long>(r.begin(), r.end()));
+            rebind_();
+        }
+    }
+
+    void rebind_() {
+        begin_ = owned_->data();
+        end_ = begin_ + owned_->size();
+    }
 
-    template<class Archive>void serialize(Archive& ar, unsigned int) {
-        ar & boost::serialization::base_object<OSMEntity>(*this) & ndrefs_;
+    // archived as a vector whichever way the refs are held (OSMDatabase archives only the entity and keeps the refs in
+    // its own array)
+
+    template<class Archive>void save(Archive& ar, unsigned int) const {
+        ar & boost::serialization::base_object<OSMEntity>(*this);
+        const std::vector<unsigned long long> v(begin_, end_);
+        ar & v;
+    }
+
+    template<class Archive>void load(Archive& ar, unsigned int) {
+        std::vector<unsigned long long> v;
+        ar & boost::serialization::base_object<OSMEntity>(*this) & v;
+        own_(NdRefRange(v.data(), v.data() + v.size()));
     }
+
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
     friend boost::serialization::access;
 };
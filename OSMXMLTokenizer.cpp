@@ -0,0 +1,1205 @@
+/*
+ * OSMXMLTokenizer.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "OSMXMLTokenizer.hpp"
+
+#include "OSMDatabaseBuilder.hpp"
+#include "OSMChange.hpp"
+#include "FlatFile.hpp"
+#include "InputFormat.hpp"
+#include "IngestStats.hpp"
+#include "ReadAheadSource.hpp"
+#include "NumberParser.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+typedef boost::string_ref string_ref;
+
+namespace {
+
+inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/// Returns a pointer just past the first occurrence of pattern in [p,end), or nullptr if none
+const char* skipPast(const char* p,const char* end,const char* pattern)
+{
+	const char* pe = pattern+strlen(pattern);
+	const char* q = search(p,end,pattern,pe);
+	return q == end ? nullptr : q+(pe-pattern);
+}
+
+/// Number conversion on a string_ref (see NumberParser.hpp)
+template<typename T>bool parseNumber(string_ref s,T& v)
+{
+	return ::parseNumber(s.data(),s.data()+s.size(),v);
+}
+
+void appendUTF8(std::string& s,unsigned long cp)
+{
+	if (cp < 0x80)
+		s.push_back(char(cp));
+	else if (cp < 0x800)
+	{
+		s.push_back(char(0xc0 | (cp >> 6)));
+		s.push_back(char(0x80 | (cp & 0x3f)));
+	}
+	else if (cp < 0x10000)
+	{
+		s.push_back(char(0xe0 | (cp >> 12)));
+		s.push_back(char(0x80 | ((cp >> 6) & 0x3f)));
+		s.push_back(char(0x80 | (cp & 0x3f)));
+	}
+	else
+	{
+		s.push_back(char(0xf0 | (cp >> 18)));
+		s.push_back(char(0x80 | ((cp >> 12) & 0x3f)));
+		s.push_back(char(0x80 | ((cp >> 6) & 0x3f)));
+		s.push_back(char(0x80 | (cp & 0x3f)));
+	}
+}
+
+}
+
+OSMXMLTokenizer::OSMXMLTokenizer(OSMDatabaseBuilder& dbb,
+		const OSMTagFilter& nodeFilter,
+		const OSMTagFilter& wayFilter,
+		const OSMTagFilter& relationFilter) :
+	m_dbb(dbb),
+	m_stack(1,Document),
+	m_unknownAttributes(NElementTypes)
+{
+	// same key index assignment as applyTagFilter in ParseOSM.cpp: keep keys first, others classified on first sight
+	auto init = [](TagTable& t,BoundKeyValueTable* tbl,const OSMTagFilter& f)
+	{
+		t.tbl = tbl;
+		t.classifier = OSMTagKeyClassifier(f);
+
+		for(const auto& k : f.keep)
+			t.keys[k].idx = tbl->addKey(k);
+	};
+
+	init(m_nodeTags,&dbb.nodeTags(),nodeFilter);
+	init(m_wayTags,&dbb.wayTags(),wayFilter);
+	init(m_relationTags,&dbb.relationTags(),relationFilter);
+}
+
+OSMXMLTokenizer::~OSMXMLTokenizer()
+{
+}
+
+const char* OSMXMLTokenizer::elementName(Element e)
+{
+	static const char* names[NElementTypes] = { "(document)", "osm", "bounds", "node", "way", "relation", "tag", "nd", "member",
+			"osmChange", "create", "modify", "delete", "(unknown)" };
+	return names[e];
+}
+
+void OSMXMLTokenizer::error(const std::string& msg) const
+{
+	throw std::runtime_error("OSMXMLTokenizer: " + msg + " (near byte " + to_string(m_consumed) + ")");
+}
+
+const char* OSMXMLTokenizer::parse(const char* begin,const char* end)
+{
+	const char* p = begin;
+
+	// UTF-8 byte-order mark
+	if (m_consumed == 0 && end-p >= 3 && memcmp(p,"\xef\xbb\xbf",3) == 0)
+	{
+		p += 3;
+		m_consumed += 3;
+	}
+
+	while(p != end)
+	{
+		// character data between elements carries nothing in OSM XML
+		const char* lt = static_cast<const char*>(memchr(p,'<',end-p));
+		if (!lt)
+		{
+			m_consumed += end-p;
+			return end;
+		}
+
+		m_consumed += lt-p;
+		p = lt;
+
+		if (end-p < 2)
+			break;
+
+		const char* next=nullptr;
+
+		switch(p[1])
+		{
+		case '/':			// end tag
+			if ((next = static_cast<const char*>(memchr(p+2,'>',end-p-2))))
+			{
+				const char* ne=next;
+				while(ne != p+2 && isSpace(ne[-1]))
+					--ne;
+				endElement(string_ref(p+2,ne-p-2));
+				++next;
+			}
+			break;
+
+		case '?':			// processing instruction / XML declaration
+			next = skipPast(p+2,end,"?>");
+			break;
+
+		case '!':			// comment, CDATA, or DOCTYPE
+			if (end-p < 4)
+				break;
+			else if (memcmp(p,"<!--",4) == 0)
+				next = skipPast(p+4,end,"-->");
+			else if (p[2] == '[')
+			{
+				if (end-p >= 9 && memcmp(p,"<![CDATA[",9) == 0)
+					next = skipPast(p+9,end,"]]>");
+				else if (end-p >= 9)
+					error("malformed CDATA section");
+			}
+			else
+			{
+				// declaration, possibly with an internal subset in [ ]
+				unsigned depth=0;
+				for(const char* q=p+2; q != end && !next; ++q)
+					if (*q == '[')
+						++depth;
+					else if (*q == ']' && depth > 0)
+						--depth;
+					else if (*q == '>' && depth == 0)
+						next = q+1;
+			}
+			break;
+
+		default:
+			next = startTag(p,end);
+		}
+
+		if (!next)			// incomplete construct: caller must present it again with more input
+			break;
+
+		m_consumed += next-p;
+		p = next;
+	}
+
+	return p;
+}
+
+void OSMXMLTokenizer::finish(const char* begin,const char* end)
+{
+	if (find_if(begin,end,[](char c){ return !isSpace(c); }) != end)
+		error("unexpected end of input inside markup");
+
+	if (m_stack.size() != 1)
+		error(string("unexpected end of input inside <") + elementName(m_stack.back()) + ">");
+}
+
+void OSMXMLTokenizer::fragment(std::uint64_t offset)
+{
+	m_stack.assign(1,Document);
+	m_stack.push_back(Osm);
+	m_consumed = offset;
+}
+
+bool OSMXMLTokenizer::betweenEntities() const
+{
+	return m_stack.size() == 2 && m_stack.back() == Osm;
+}
+
+
+
+/** Scans a complete start tag at p (which points to '<') into m_attrs, then processes it.
+ * Returns a pointer past the closing '>', or nullptr if the tag is not complete within [p,end).
+ */
+
+const char* OSMXMLTokenizer::startTag(const char* p,const char* end)
+{
+	const char* q=p+1;
+
+	while(q != end && !isSpace(*q) && *q != '/' && *q != '>')
+		++q;
+
+	if (q == end)
+		return nullptr;
+
+	string_ref name(p+1,q-p-1);
+
+	if (name.empty())
+		error("malformed start tag");
+
+	m_nAttrs=0;
+
+	for(;;)
+	{
+		while(q != end && isSpace(*q))
+			++q;
+
+		if (q == end)
+			return nullptr;
+		else if (*q == '>' || *q == '/')
+		{
+			const bool empty = *q == '/';
+
+			if (empty && q+1 == end)
+				return nullptr;
+			else if (empty && q[1] != '>')
+				error("malformed empty-element tag <" + name.to_string() + ">");
+
+			// decode only once the tag is complete (m_attrs no longer reallocates)
+			for(unsigned i=0;i<m_nAttrs;++i)
+				decodeValue(m_attrs[i]);
+
+			startElement(name,empty);
+			return q+(empty ? 2 : 1);
+		}
+
+		// attribute name = value
+		const char* an=q;
+		while(q != end && *q != '=' && !isSpace(*q) && *q != '>' && *q != '/')
+			++q;
+
+		string_ref aname(an,q-an);
+
+		while(q != end && isSpace(*q))
+			++q;
+
+		if (q == end)
+			return nullptr;
+		else if (*q != '=' || aname.empty())
+			error("malformed attribute in <" + name.to_string() + ">");
+
+		++q;
+		while(q != end && isSpace(*q))
+			++q;
+
+		if (q == end)
+			return nullptr;
+
+		const char quote = *q;
+		if (quote != '"' && quote != '\'')
+			error("unquoted attribute value in <" + name.to_string() + ">");
+
+		const char* v = ++q;
+		if (!(q = static_cast<const char*>(memchr(q,quote,end-q))))
+			return nullptr;
+
+		if (m_nAttrs == m_attrs.size())
+			m_attrs.emplace_back();
+
+		Attribute& a = m_attrs[m_nAttrs++];
+		a.name = aname;
+		a.value = string_ref(v,q-v);
+
+		++q;
+	}
+}
+
+/** Expands entity & character references and applies XML attribute-value normalization (literal tab, newline, CR, or
+ * CR-LF -> one space). Values without any of those (nearly all) are left pointing into the input.
+ */
+
+void OSMXMLTokenizer::decodeValue(Attribute& a)
+{
+	const string_ref v = a.value;
+
+	if (find_if(v.begin(),v.end(),[](char c){ return c == '&' || c == '\t' || c == '\n' || c == '\r'; }) == v.end())
+		return;
+
+	std::string& s = a.scratch;
+	s.clear();
+
+	for(std::size_t i=0;i<v.size();++i)
+	{
+		const char c = v[i];
+
+		if (c == '\r')
+		{
+			s.push_back(' ');
+			if (i+1 < v.size() && v[i+1] == '\n')
+				++i;
+		}
+		else if (c == '\t' || c == '\n')
+			s.push_back(' ');
+		else if (c == '&')
+		{
+			const std::size_t semi = std::find(v.begin()+i+1,v.end(),';')-v.begin();
+			if (semi == v.size())
+				error("unterminated entity reference in attribute value");
+
+			const string_ref ent = v.substr(i+1,semi-i-1);
+
+			if (ent == "lt")
+				s.push_back('<');
+			else if (ent == "gt")
+				s.push_back('>');
+			else if (ent == "amp")
+				s.push_back('&');
+			else if (ent == "quot")
+				s.push_back('"');
+			else if (ent == "apos")
+				s.push_back('\'');
+			else if (ent.size() > 1 && ent[0] == '#')
+			{
+				const bool hex = ent[1] == 'x';
+				const string_ref digits = ent.substr(hex ? 2 : 1);
+				const std::string ds = digits.to_string();
+
+				char* e;
+				unsigned long cp = strtoul(ds.c_str(),&e,hex ? 16 : 10);
+				if (ds.empty() || *e || cp == 0 || cp > 0x10ffff)
+					error("invalid character reference &" + ent.to_string() + ";");
+				appendUTF8(s,cp);
+			}
+			else
+				error("undefined entity &" + ent.to_string() + ";");
+
+			i = semi;
+		}
+		else
+			s.push_back(c);
+	}
+
+	a.value = string_ref(s);
+}
+
+void OSMXMLTokenizer::unknownAttribute(Element e,string_ref name)
+{
+	auto p = m_unknownAttributes[e].insert(name,0);
+	if (p.second)
+		cout << "WARNING: Unhandled attribute '" << name << "' on element of type '<" << elementName(e) << ">' (notifying on first occurrence only)" << endl;
+	++*p.first;
+}
+
+
+
+void OSMXMLTokenizer::startElement(string_ref name,bool empty)
+{
+	const Element parent = m_stack.back();
+	Element e = Unknown;
+
+	switch(parent)
+	{
+	case Document:
+		if (name == "osm")
+			e = Osm;
+		else if (name == "osmChange")
+			e = OsmChange;
+		break;
+
+	case OsmChange:
+		if (name == "create")
+			e = Create;
+		else if (name == "modify")
+			e = Modify;
+		else if (name == "delete")
+			e = Delete;
+		break;
+
+	case Osm:
+	case Create:
+	case Modify:
+	case Delete:
+		if (name == "node")
+			e = Node;
+		else if (name == "way")
+			e = Way;
+		else if (name == "relation")
+			e = Relation;
+		else if (name == "bounds" && parent == Osm)
+			e = Bounds;
+		break;
+
+	case Node:
+		if (name == "tag")
+			e = Tag;
+		break;
+
+	case Way:
+		if (name == "nd")
+			e = Nd;
+		else if (name == "tag")
+			e = Tag;
+		break;
+
+	case Relation:
+		if (name == "member")
+			e = Member;
+		else if (name == "tag")
+			e = Tag;
+		break;
+
+	default:
+		break;
+	}
+
+	// unrecognized elements are skipped along with everything they contain
+	if (e == Unknown && parent != Unknown && m_unknownElements.insert(name,0).second)
+		cerr << "Failed to find a handler for XML element type '" << name << "' inside <" << elementName(parent) << "> (skipping; notifying on first occurrence only)" << endl;
+
+	if (e == Unknown)
+		++m_unknownElements[name];
+
+	++m_count[e];
+	m_stack.push_back(e);
+
+	switch(e)
+	{
+	case Osm:
+	case OsmChange:
+		for(unsigned i=0;i<m_nAttrs;++i)
+			if (m_attrs[i].name != "generator" && m_attrs[i].name != "version" && m_attrs[i].name != "timestamp")
+				unknownAttribute(e,m_attrs[i].name);
+		break;
+
+	case Bounds:
+		boundsAttributes();
+		break;
+
+	case Node:
+	case Way:
+	case Relation:
+		startEntity(e);
+		if (m_change)
+			recordChangeAction(e,parent);
+		break;
+
+	case Tag:
+		tag(parent == Node ? m_nodeTags : parent == Way ? m_wayTags : m_relationTags);
+		break;
+
+	case Nd:
+		nd();
+		break;
+
+	case Member:
+		memberStart();
+		break;
+
+	default:
+		break;
+	}
+
+	if (empty)
+		endElement(name);
+}
+
+void OSMXMLTokenizer::endElement(string_ref name)
+{
+	if (m_stack.size() == 1)
+		error("unexpected end tag </" + name.to_string() + ">");
+
+	const Element e = m_stack.back();
+
+	if (e != Unknown && name != elementName(e))
+		error("end tag </" + name.to_string() + "> does not match <" + elementName(e) + ">");
+
+	switch(e)
+	{
+	case Node:
+		m_dbb.finishEntity<OSMNode>();
+		break;
+	case Way:
+		m_dbb.finishEntity<OSMWay>();
+		break;
+	case Relation:
+		m_dbb.finishEntity<OSMRelation>();
+		break;
+	case Member:
+		memberEnd();
+		break;
+	default:
+		break;
+	}
+
+	m_stack.pop_back();
+}
+
+void OSMXMLTokenizer::boundsAttributes()
+{
+	for(unsigned i=0;i<m_nAttrs;++i)
+	{
+		const Attribute& a = m_attrs[i];
+		float* dst = nullptr;
+
+		if (a.name == "minlat")
+			dst = &m_dbb.bounds.first.lat;
+		else if (a.name == "minlon")
+			dst = &m_dbb.bounds.first.lon;
+		else if (a.name == "maxlat")
+			dst = &m_dbb.bounds.second.lat;
+		else if (a.name == "maxlon")
+			dst = &m_dbb.bounds.second.lon;
+		else if (a.name != "origin")
+			unknownAttribute(Bounds,a.name);
+
+		if (dst && !parseNumber(a.value,*dst))
+			cerr << "Failed to parse '" << a.value << "' as type " << endl;
+	}
+}
+
+void OSMXMLTokenizer::startEntity(Element e)
+{
+	switch(e)
+	{
+	case Node:
+		m_dbb.createNew<OSMNode>();
+		break;
+	case Way:
+		m_dbb.createNew<OSMWay>();
+		break;
+	default:
+		m_dbb.createNew<OSMRelation>();
+		break;
+	}
+
+	for(unsigned i=0;i<m_nAttrs;++i)
+	{
+		const Attribute& a = m_attrs[i];
+
+		if (a.name == "id")
+		{
+			unsigned long long id;
+			if (parseNumber(a.value,id))
+				m_dbb.currentEntity()->id(id);
+			else
+				cerr << "Failed to parse '" << a.value << "' as type " << endl;
+		}
+		else if (e == Node && (a.name == "lat" || a.name == "lon"))
+		{
+			double x;
+			if (!parseNumber(a.value,x))
+				cerr << "Failed to parse '" << a.value << "' as type " << endl;
+			else if (a.name == "lat")
+				m_dbb.currentNode()->fixedCoords().lat = FixedLatLon::fromDegrees(x);
+			else
+				m_dbb.currentNode()->fixedCoords().lon = FixedLatLon::fromDegrees(x);
+		}
+		else if (a.name != "timestamp" && a.name != "version" && a.name != "changeset" && a.name != "uid" && a.name != "user")
+			unknownAttribute(e,a.name);
+	}
+}
+
+void OSMXMLTokenizer::recordChangeAction(Element e,Element section)
+{
+	const OSMChangeAction a = section == Delete ? OSMDelete : section == Modify ? OSMModify : OSMCreate;
+
+	switch(e)
+	{
+	case Node:
+		m_change->nodeActions.push_back(a);
+		break;
+	case Way:
+		m_change->wayActions.push_back(a);
+		break;
+	default:
+		m_change->relationActions.push_back(a);
+		break;
+	}
+}
+
+void OSMXMLTokenizer::tag(TagTable& t)
+{
+	const Attribute *k=nullptr, *v=nullptr;
+
+	for(unsigned i=0;i<m_nAttrs;++i)
+		if (m_attrs[i].name == "k")
+			k = &m_attrs[i];
+		else if (m_attrs[i].name == "v")
+			v = &m_attrs[i];
+
+	if (!k)
+	{
+		cerr << "ERROR: tag element missing attribute 'k' (key)" << endl;
+		return;
+	}
+	else if (!v)
+	{
+		cerr << "ERROR: tag element missing attribute 'v' (value)" << endl;
+		return;
+	}
+
+	TagTable::KeyInfo* ki = t.keys.find(k->value);
+
+	if (!ki)			// first occurrence of this key: apply the rules once
+	{
+		TagTable::KeyInfo info;
+
+		if (t.classifier.keep(k->value))
+			info.idx = t.tbl->addKey(k->value.to_string());
+
+		ki = t.keys.insert(k->value,info).first;
+	}
+
+	ki->count++;
+
+	if (ki->idx == -1U)
+		return;
+
+	unsigned* vi = t.values.find(v->value);
+	if (!vi)
+		vi = t.values.insert(v->value,t.tbl->addValue(v->value.to_string())).first;
+
+	t.tbl->addTag(ki->idx,*vi);
+}
+
+void OSMXMLTokenizer::nd()
+{
+	if (m_nAttrs != 1)
+		cerr << "ERROR: Unexpected number of attributes for element type 'nd' (" << m_nAttrs << ", expecting 1)" << endl;
+	else if (m_attrs[0].name != "ref")
+		cerr << "ERROR: Element 'nd' attribute is not 'ref' as expected" << endl;
+	else
+	{
+		unsigned long long id=0;
+		if (!parseNumber(m_attrs[0].value,id))
+			cerr << "ERROR: Failed to parse '" << m_attrs[0].value << "' as integer node reference" << endl;
+		m_dbb.addNdRef(id);
+	}
+}
+
+void OSMXMLTokenizer::memberStart()
+{
+	if (m_nAttrs != 3)
+		cerr << "ERROR: Unexpected number of attributes for element type 'member' (" << m_nAttrs << ", expecting 3)" << endl;
+
+	for(unsigned i=0;i<m_nAttrs;++i)
+	{
+		const Attribute& a = m_attrs[i];
+
+		if (a.name == "ref")
+		{
+			unsigned long long id;
+			if (parseNumber(a.value,id))
+				m_memberRef = id;
+			else
+				cerr << "Failed to parse '" << a.value << "' as type " << endl;
+		}
+		else if (a.name == "role")
+		{
+			unsigned* r = m_roles.find(a.value);
+			if (!r)
+				r = m_roles.insert(a.value,m_dbb.relationMemberRoles().addValue(a.value)).first;
+			m_memberRole = *r;
+		}
+		else if (a.name == "type")
+		{
+			if (a.value == "node")
+				m_memberType = OSMRelation::Node;
+			else if (a.value == "way")
+				m_memberType = OSMRelation::Way;
+			else if (a.value == "relation")
+				m_memberType = OSMRelation::Relation;
+			else
+				cout << "Unknown enum member " << a.value << endl;
+		}
+		else
+			unknownAttribute(Member,a.name);
+	}
+}
+
+void OSMXMLTokenizer::memberEnd()
+{
+	// same validity test as OSMMemberElementHandler (note the id sentinel is the unsigned -1U)
+	if (m_memberType == OSMRelation::InvalidType || m_memberRef == -1U || m_memberRole == -1U)
+		cerr << "ERROR: Invalid relation member type" << endl;
+	else
+		m_dbb.addMember(m_memberRef,OSMRelation::MemberType(m_memberType),m_memberRole);
+
+	m_memberType = OSMRelation::InvalidType;
+	m_memberRef = -1U;
+	m_memberRole = -1U;
+}
+
+
+
+void OSMXMLTokenizer::printSummary(std::ostream& os) const
+{
+	os << "Element counts: " << endl;
+	for(unsigned e=Osm; e<NElementTypes; ++e)
+		os << "  " << setw(30) << elementName(Element(e)) << "  " << m_count[e] << endl;
+
+	for(const auto& p : m_unknownElements)
+		os << "  " << setw(30) << p.first << "  " << p.second << " (skipped)" << endl;
+
+	auto printKeys = [&os](const char* title,const TagTable& t)
+	{
+		vector<pair<string,unsigned>> v;
+		v.reserve(t.keys.size());
+		for(const auto& p : t.keys)
+			v.push_back(make_pair(p.first.to_string(),p.second.count));
+
+		sort(v.begin(),v.end(),[](const pair<string,unsigned>& lhs,const pair<string,unsigned>& rhs){ return lhs.first < rhs.first; });
+
+		os << title << " tag keys: " << endl;
+		for(const auto& p : v)
+			os << "  " << setw(30) << p.first << "  " << p.second << endl;
+	};
+
+	printKeys("Node",m_nodeTags);
+	printKeys("Relation",m_relationTags);
+	printKeys("Way",m_wayTags);
+}
+
+
+
+void OSMXMLTokenizer::addCounts(const OSMXMLTokenizer& rhs)
+{
+	for(unsigned e=0; e<NElementTypes; ++e)
+		m_count[e] += rhs.m_count[e];
+
+	for(const auto& p : rhs.m_unknownElements)
+		m_unknownElements[p.first] += p.second;
+
+	auto add = [](TagTable& t,const TagTable& r)
+	{
+		for(const auto& p : r.keys)
+			t.keys[p.first].count += p.second.count;
+	};
+
+	add(m_nodeTags,rhs.m_nodeTags);
+	add(m_wayTags,rhs.m_wayTags);
+	add(m_relationTags,rhs.m_relationTags);
+}
+
+std::uint64_t OSMXMLTokenizer::entities(OSMEntityType t) const
+{
+	switch(t)
+	{
+	case ::Node: 		return m_count[Node];
+	case ::Way: 		return m_count[Way];
+	case ::Relation: 	return m_count[Relation];
+	default: 			return 0;
+	}
+}
+
+void OSMXMLTokenizer::addTagStats(IngestStats& stats) const
+{
+	auto add = [&stats](OSMEntityType type,const TagTable& t)
+	{
+		for(const auto& p : t.keys)
+			if (p.second.count)
+				stats.addTagKey(type,t.classifier,p.first,p.second.count);
+	};
+
+	add(::Node,m_nodeTags);
+	add(::Way,m_wayTags);
+	add(::Relation,m_relationTags);
+}
+
+
+
+namespace {
+
+/// True if p (which points to '<') begins a <node>, <way> or <relation> start tag
+bool isEntityStart(const char* p,const char* end)
+{
+	for(const char* name : { "node", "way", "relation" })
+	{
+		const std::size_t n = strlen(name);
+		if (std::size_t(end-p) > n+1 && memcmp(p+1,name,n) == 0)
+			return isSpace(p[n+1]) || p[n+1] == '>' || p[n+1] == '/';
+	}
+	return false;
+}
+
+/// Returns the first entity start tag in [p,end), or end if none
+const char* nextEntityStart(const char* p,const char* end)
+{
+	for(; (p = static_cast<const char*>(memchr(p,'<',end-p))); ++p)
+		if (isEntityStart(p,end))
+			return p;
+	return end;
+}
+
+/// Returns the last entity start tag in [begin,end), or begin if none
+const char* lastEntityStart(const char* begin,const char* end)
+{
+	for(const char* p=end; p != begin; )
+		if (*--p == '<' && isEntityStart(p,end))
+			return p;
+	return begin;
+}
+
+
+
+/** A byte range of the document tokenized into its own builder.
+ *
+ * ok is set if the range parsed completely and ended between entities (or properly ended the document, if last). A range
+ * can fail without error (incomplete) when its end was cut inside a comment or an unknown element; it is then retried
+ * together with the next range. An exception is a genuine error, because ranges are only ever started at a clean end.
+ */
+
+struct Shard
+{
+	const char* 						begin=nullptr;
+	const char* 						end=nullptr;
+	std::uint64_t 						offset=0;			// position of begin in the document
+	bool 								last=false;			// range ends the document
+
+	std::unique_ptr<OSMDatabaseBuilder> dbb;
+	std::unique_ptr<OSMXMLTokenizer> 	tok;
+	bool 								ok=false;
+	std::exception_ptr 					error;
+
+	const OSMTagFilterProfile* 			filters=nullptr;
+
+	void parse()
+	{
+		dbb.reset(new OSMDatabaseBuilder());
+		tok.reset(new OSMXMLTokenizer(*dbb,filters->node,filters->way,filters->relation));
+		error = nullptr;
+
+		try {
+			if (offset != 0)
+				tok->fragment(offset);
+
+			const char* rest = tok->parse(begin,end);
+
+			if (last)
+				tok->finish(rest,end);
+
+			ok = last || (rest == end && tok->betweenEntities());
+		}
+		catch(...)
+		{
+			ok = false;
+			error = current_exception();
+		}
+	}
+};
+
+
+
+/** Appends shards to the global builder in file order, translating their string table indices (cf. PBFBlockMerger).
+ * Global indices are assigned in order of first occurrence, as a single tokenizer would.
+ */
+
+class ShardMerger
+{
+public:
+	explicit ShardMerger(OSMDatabaseBuilder& dbb) : m_dbb(dbb){}
+
+	void merge(OSMDatabaseBuilder& shard)
+	{
+		BoundKeyValueTable& nt = m_dbb.nodeTags();
+		BoundKeyValueTable& wt = m_dbb.wayTags();
+		BoundKeyValueTable& rt = m_dbb.relationTags();
+		ValueTable& roles = m_dbb.relationMemberRoles();
+
+		m_nodeKeys.map(shard.nodeTags().keys(),			[&nt](string_ref s){ return nt.addKey(s); });
+		m_nodeValues.map(shard.nodeTags().values(),		[&nt](string_ref s){ return nt.addValue(s); });
+		m_wayKeys.map(shard.wayTags().keys(),			[&wt](string_ref s){ return wt.addKey(s); });
+		m_wayValues.map(shard.wayTags().values(),		[&wt](string_ref s){ return wt.addValue(s); });
+		m_relationKeys.map(shard.relationTags().keys(),	[&rt](string_ref s){ return rt.addKey(s); });
+		m_relationValues.map(shard.relationTags().values(),[&rt](string_ref s){ return rt.addValue(s); });
+		m_roles.map(shard.relationMemberRoles().values(),	[&roles](string_ref s){ return roles.addValue(s); });
+
+		for(float LatLon::* c : { &LatLon::lat, &LatLon::lon })
+		{
+			if (!std::isnan(shard.bounds.first.*c))
+				m_dbb.bounds.first.*c = shard.bounds.first.*c;
+			if (!std::isnan(shard.bounds.second.*c))
+				m_dbb.bounds.second.*c = shard.bounds.second.*c;
+		}
+
+		for(OSMNode& n : shard.nodes())
+		{
+			n.remapTags(m_nodeKeys.local,m_nodeValues.local);
+			m_dbb.addNode(std::move(n));
+			m_dbb.finishEntity<OSMNode>();
+		}
+
+		for(size_t i=0;i<shard.ways().size();++i)
+		{
+			OSMWay& w = shard.ways()[i];
+			w.remapTags(m_wayKeys.local,m_wayValues.local);
+			m_dbb.addWay(std::move(w));
+			m_dbb.addNdRefs(shard.wayNdRefs(i));
+			m_dbb.finishEntity<OSMWay>();
+		}
+
+		for(size_t i=0;i<shard.relations().size();++i)
+		{
+			OSMRelation& r = shard.relations()[i];
+			r.remapTags(m_relationKeys.local,m_relationValues.local);
+			m_dbb.addRelation(std::move(r));
+			for(OSMRelation::Member m : shard.relationMembers(i))
+			{
+				m.role = m_roles.local[m.role];
+				m_dbb.addMember(m);
+			}
+			m_dbb.finishEntity<OSMRelation>();
+		}
+	}
+
+private:
+	/// Maps the indices of a shard's string table to global indices, adding new strings to the global table with add
+	struct IndexMap
+	{
+		StringRefMap<unsigned> 	global;
+		vector<unsigned> 		local;
+
+		template<class AddFunction>void map(const FlatStringTable& strings,AddFunction add)
+		{
+			local.resize(strings.size());
+			for(std::size_t i=0;i<strings.size();++i)
+			{
+				unsigned* g = global.find(strings[i]);
+				if (!g)
+					g = global.insert(strings[i],add(strings[i])).first;
+				local[i] = *g;
+			}
+		}
+	};
+
+	OSMDatabaseBuilder& m_dbb;
+
+	IndexMap m_nodeKeys, m_nodeValues, m_wayKeys, m_wayValues, m_relationKeys, m_relationValues, m_roles;
+};
+
+
+
+/** Tokenizes a document presented as a sequence of buffers, either on one tokenizer or split across threads */
+
+class ChunkedTokenizer
+{
+public:
+	ChunkedTokenizer(OSMDatabaseBuilder& dbb,unsigned nThreads,const OSMTagFilterProfile& filters) :
+		m_nThreads(nThreads),
+		m_filters(filters),
+		m_merger(dbb)
+	{
+		if (nThreads == 1)
+			m_serial.reset(new OSMXMLTokenizer(dbb,filters.node,filters.way,filters.relation));
+	}
+
+	/// Parses [begin,end) (all of it if eof) and returns where the unparsed remainder begins
+	const char* parse(const char* begin,const char* end,bool eof);
+
+	void printSummary(std::ostream& os) const
+	{
+		if (m_serial)
+			m_serial->printSummary(os);
+		else if (m_summary.tok)
+			m_summary.tok->printSummary(os);
+	}
+
+	void addTagStats(IngestStats& stats) const
+	{
+		if (m_serial)
+			m_serial->addTagStats(stats);
+		else if (m_summary.tok)
+			m_summary.tok->addTagStats(stats);
+	}
+
+private:
+	void merge(Shard& s);
+
+	/// Adds the entities counted by t since the last call (for the serial tokenizer) or in all (for a shard)
+	void publishCounts(const OSMXMLTokenizer& t,bool delta);
+
+	unsigned 							m_nThreads=1;
+	const OSMTagFilterProfile& 			m_filters;
+	std::unique_ptr<OSMXMLTokenizer> 	m_serial;
+
+	ShardMerger 						m_merger;
+	std::uint64_t 						m_offset=0;			// document position of the next byte to parse
+	Shard 								m_summary;			// first shard merged; the others' counts are added to it
+	std::uint64_t 						m_published[4]={};	// entities of the serial tokenizer added to ingestStats()
+};
+
+const char* ChunkedTokenizer::parse(const char* begin,const char* end,bool eof)
+{
+	if (m_serial)
+	{
+		const char* rest = m_serial->parse(begin,end);
+		if (eof)
+			m_serial->finish(rest,end);
+		publishCounts(*m_serial,true);
+		return rest;
+	}
+
+	// cut into about 4 ranges per thread at entity start tags; everything after the last entity start is kept for the
+	// next call unless this is the end of the document
+	const char* limit = eof ? end : lastEntityStart(begin,end);
+	const std::size_t step = std::max<std::size_t>((limit-begin)/(4*m_nThreads),std::size_t(1) << 16);
+
+	vector<Shard> shards;
+	for(const char* p=begin; p != limit; )
+	{
+		const char* q = std::size_t(limit-p) > step ? nextEntityStart(p+step,limit) : limit;
+
+		shards.emplace_back();
+		shards.back().begin = p;
+		shards.back().end = q;
+		shards.back().offset = m_offset + (p-begin);
+		shards.back().last = eof && q == end;
+		shards.back().filters = &m_filters;
+		p = q;
+	}
+
+	atomic<std::size_t> next(0);
+	auto worker = [&shards,&next]()
+	{
+		for(std::size_t i; (i = next++) < shards.size(); )
+			shards[i].parse();
+	};
+
+	vector<thread> threads;
+	for(unsigned t=1; t<m_nThreads && t<shards.size(); ++t)
+		threads.emplace_back(worker);
+	worker();
+
+	for(auto& t : threads)
+		t.join();
+
+	for(std::size_t i=0;i<shards.size();++i)
+	{
+		// incomplete range: retry it together with the next
+		while(!shards[i].ok && !shards[i].error && i+1 < shards.size())
+		{
+			shards[i+1].begin = shards[i].begin;
+			shards[i+1].offset = shards[i].offset;
+			shards[i] = Shard();
+			shards[++i].parse();
+		}
+
+		if (shards[i].error)
+			rethrow_exception(shards[i].error);
+		else if (!shards[i].ok)
+		{
+			// last range of the batch is incomplete: hand it back to be parsed with the next batch
+			const char* rest = shards[i].begin;
+			m_offset += rest-begin;
+			return rest;
+		}
+
+		merge(shards[i]);
+		shards[i] = Shard();
+	}
+
+	m_offset += limit-begin;
+	return limit;
+}
+
+void ChunkedTokenizer::publishCounts(const OSMXMLTokenizer& t,bool delta)
+{
+	for(const OSMEntityType e : { Node, Way, Relation })
+	{
+		const std::uint64_t n = t.entities(e);
+		ingestStats().addElements(e,delta ? n-m_published[e] : n);
+		if (delta)
+			m_published[e] = n;
+	}
+}
+
+void ChunkedTokenizer::merge(Shard& s)
+{
+	m_merger.merge(*s.dbb);
+	publishCounts(*s.tok,false);
+
+	if (!m_summary.tok)
+		m_summary = std::move(s);
+	else
+		m_summary.tok->addCounts(*s.tok);
+}
+
+}
+
+
+
+OSMDatabase parseOSMTokenized(const std::string fn,unsigned nThreads,const OSMTagFilterProfile& filters)
+{
+	OSMDatabaseBuilder dbb;
+	parseOSMTokenized(fn,dbb,nThreads,filters);
+	return dbb.getDatabase();
+}
+
+void parseOSMTokenized(const std::string fn,OSMDatabaseBuilder& dbb,unsigned nThreads,const OSMTagFilterProfile& filters)
+{
+	if (nThreads == 0)
+		nThreads = std::max(1U,thread::hardware_concurrency());
+
+	ChunkedTokenizer tok(dbb,nThreads,filters);
+
+	// bytes handed to the tokenizer per call; grown if a single entity does not fit
+	std::size_t batchSize = std::size_t(nThreads) << 24;
+
+	const Compression compression = detectInputFormat(fn).compression;
+
+	if (compression == Compression::None && !isStdin(fn))
+	{
+		// tokenize the mapped file in place
+		MappedFile f(fn);
+		const char* end = f.data()+f.size();
+
+		for(const char* p=f.data(); ; )
+		{
+			const char* window = std::size_t(end-p) > batchSize ? p+batchSize : end;
+			const char* rest = tok.parse(p,window,window == end);
+
+			ingestStats().inputBytes += (window == end ? end : rest)-p;
+			ingestStats().decompressedBytes += (window == end ? end : rest)-p;
+
+			if (window == end)
+				break;
+			else if (rest == p)
+				batchSize *= 2;
+			p = rest;
+		}
+	}
+	else
+	{
+		// tokenize directly out of the decompressed chunks; only a construct straddling two batches is moved. Reading
+		// (eg. from a pipe) and decompression run ahead on their own thread while a batch is tokenized.
+		DecompressingReader rd(fn,compression,nThreads);
+		ReadAheadSource ra([&rd](char* s,std::streamsize n)
+		{
+			const std::size_t N = rd.read(s,n);
+			return N == 0 && n > 0 ? std::streamsize(-1) : std::streamsize(N);
+		});
+
+		std::vector<char> buf(std::min(batchSize,std::size_t(4) << 20));
+		std::size_t fill=0;
+
+		for(bool eof=false; !eof; )
+		{
+			while(fill < buf.size() && !eof)
+			{
+				const std::streamsize N = ra.read(buf.data()+fill,buf.size()-fill);
+				fill += std::max(N,std::streamsize(0));
+				eof = N <= 0;
+			}
+
+			const char* rest = tok.parse(buf.data(),buf.data()+fill,eof);
+
+			const std::size_t carry = buf.data()+fill-rest;
+			memmove(buf.data(),rest,carry);
+
+			if (carry == fill && !eof)			// nothing could be parsed: batch too small
+				buf.resize(2*buf.size());
+			else if (buf.size() < batchSize)
+				buf.resize(std::min(2*buf.size(),batchSize));
+			fill = carry;
+		}
+	}
+
+	tok.printSummary(cout);
+	tok.addTagStats(ingestStats());
+}
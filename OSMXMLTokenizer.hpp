@@ -0,0 +1,224 @@
+/*
+ * OSMXMLTokenizer.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef OSMXMLTOKENIZER_HPP_
+#define OSMXMLTOKENIZER_HPP_
+
+#include "OSMDatabase.hpp"
+#include "OSMTagFilter.hpp"
+#include "StringRefHash.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/utility/string_ref.hpp>
+
+class OSMDatabaseBuilder;
+class IngestStats;
+struct OSMChange;
+class BoundKeyValueTable;
+class ValueTable;
+
+/** Hash map from strings to T which is queried by string_ref (no allocation on lookup); inserted keys are copied into
+ * storage owned by the map.
+ */
+
+template<typename T>class StringRefMap
+{
+public:
+	T* find(boost::string_ref k)
+	{
+		auto it = m_map.find(k);
+		return it == m_map.end() ? nullptr : &it->second;
+	}
+
+	/// Inserts k -> v if k is not already present; returns the mapped value and true if inserted
+	std::pair<T*,bool> insert(boost::string_ref k,const T& v)
+	{
+		if (T* p = find(k))
+			return std::make_pair(p,false);
+
+		m_strings.emplace_back(k.data(),k.size());
+		auto p = m_map.insert(std::make_pair(boost::string_ref(m_strings.back()),v));
+		return std::make_pair(&p.first->second,true);
+	}
+
+	T& operator[](boost::string_ref k){ return *insert(k,T()).first; }
+
+	typename std::unordered_map<boost::string_ref,T,StringRefHash>::const_iterator begin() const { return m_map.begin(); }
+	typename std::unordered_map<boost::string_ref,T,StringRefHash>::const_iterator end() const { return m_map.end(); }
+
+	std::size_t size() const { return m_map.size(); }
+
+private:
+	std::unordered_map<boost::string_ref,T,StringRefHash> 	m_map;
+	std::deque<std::string> 								m_strings;		// deque: growth does not move elements
+};
+
+
+
+/** OSM-specific XML tokenizer, an alternative to the generic Xerces SAX2 parser (parseOSM).
+ *
+ * Scans UTF-8 bytes in place and recognizes only the OSM vocabulary (osm, bounds, node, way, relation, tag, nd, member);
+ * comments, processing instructions, DOCTYPE, CDATA and text are skipped, and other elements are reported and skipped
+ * along with their content. There is no validation beyond well-formedness of tags. Attribute values are handed out as
+ * string_refs into the input, except the rare ones containing entity references or literal whitespace, which are
+ * decoded and normalized into a scratch buffer as XML requires.
+ *
+ * It drives OSMDatabaseBuilder with the same semantics as the Xerces element handlers (tag filtering & key/value index
+ * assignment, member role de-duplication, number parsing), so both produce identical databases.
+ *
+ * Input may be presented in pieces: parse() consumes as much as it can and returns where an incomplete trailing
+ * construct begins; those bytes must be presented again at the start of the next call.
+ */
+
+class OSMXMLTokenizer
+{
+public:
+	typedef boost::string_ref string_ref;
+
+	OSMXMLTokenizer(OSMDatabaseBuilder& dbb,
+			const OSMTagFilter& nodeFilter=defaultNodeTagFilter(),
+			const OSMTagFilter& wayFilter=defaultWayTagFilter(),
+			const OSMTagFilter& relationFilter=defaultRelationTagFilter());
+	~OSMXMLTokenizer();
+
+	OSMXMLTokenizer(const OSMXMLTokenizer&) = delete;
+	OSMXMLTokenizer& operator=(const OSMXMLTokenizer&) = delete;
+
+	/// Tokenizes [begin,end), returning a pointer to the first byte not consumed (end if the input ended cleanly)
+	const char* parse(const char* begin,const char* end);
+
+	/// Call at end of input with the bytes left over from the last parse(); throws std::runtime_error if incomplete
+	void finish(const char* begin,const char* end);
+
+	/** Starts the tokenizer inside <osm>, to parse a piece of a document which begins at a <node>/<way>/<relation>
+	 * start tag. offset is the position of that piece in the document (for error messages).
+	 */
+	void fragment(std::uint64_t offset);
+
+	/// True if everything opened so far has been closed except <osm> (ie. the input ended between entities)
+	bool betweenEntities() const;
+
+	/** Accepts an OsmChange document (<osmChange> with <create>, <modify> and <delete> sections) and appends the action of
+	 * each entity parsed to the corresponding action list of c. Entities must not be dropped by the builder's retention
+	 * predicates, or the actions would no longer line up.
+	 */
+	void recordChangeActions(OSMChange* c){ m_change=c; }
+
+	/// Element counts and the tag keys seen per entity type (as parseOSM prints)
+	void printSummary(std::ostream& os) const;
+
+	/// Adds the element & tag key counts of another tokenizer (which parsed another piece of the document) to this one
+	void addCounts(const OSMXMLTokenizer& rhs);
+
+	/// Number of <node>, <way> or <relation> elements parsed so far
+	std::uint64_t entities(OSMEntityType t) const;
+
+	/// Adds the tag occurrences seen to stats, attributed to the filter rule which decided each key
+	void addTagStats(IngestStats& stats) const;
+
+private:
+	enum Element { Document, Osm, Bounds, Node, Way, Relation, Tag, Nd, Member, OsmChange, Create, Modify, Delete, Unknown,
+		NElementTypes };
+
+	struct Attribute
+	{
+		string_ref 	name;
+		string_ref 	value;
+		std::string	scratch;		// holds the decoded value if it needed entity expansion/normalization
+	};
+
+	/// Key & value tables for the tags of one entity type
+	struct TagTable
+	{
+		struct KeyInfo
+		{
+			unsigned idx=-1U;		// index in the key table, -1U if the key is ignored
+			unsigned count=0;
+		};
+
+		BoundKeyValueTable* 		tbl=nullptr;
+		OSMTagKeyClassifier 		classifier;
+		StringRefMap<KeyInfo> 		keys;
+		StringRefMap<unsigned> 		values;
+	};
+
+	const char* startTag(const char* p,const char* end);
+	void startElement(string_ref name,bool empty);
+	void endElement(string_ref name);
+
+	void startEntity(Element e);
+	void recordChangeAction(Element e,Element section);
+	void boundsAttributes();
+	void tag(TagTable& t);
+	void nd();
+	void memberStart();
+	void memberEnd();
+
+	void decodeValue(Attribute& a);
+	void unknownAttribute(Element e,string_ref name);
+	void error(const std::string& msg) const;
+
+	static const char* elementName(Element e);
+
+	OSMDatabaseBuilder& 		m_dbb;
+
+	TagTable 					m_nodeTags;
+	TagTable 					m_wayTags;
+	TagTable 					m_relationTags;
+
+	StringRefMap<unsigned> 		m_roles;			// role string -> index in the relation member role table
+
+	std::vector<Element> 		m_stack;
+	std::vector<Attribute> 		m_attrs;
+	unsigned 					m_nAttrs=0;
+
+	// member under construction
+	unsigned long long 			m_memberRef=-1U;
+	unsigned 					m_memberRole=-1U;
+	unsigned 					m_memberType=0;
+
+	std::uint64_t 				m_consumed=0;		// bytes consumed by previous parse() calls (for error messages)
+
+	OSMChange* 					m_change=nullptr;	// receives entity actions when parsing an OsmChange document
+
+	std::uint64_t 				m_count[NElementTypes]={};
+	std::vector<StringRefMap<unsigned>> m_unknownAttributes;
+	StringRefMap<unsigned> 		m_unknownElements;
+};
+
+
+
+/** Parses an OSM XML file or standard input ("-"), plain or compressed (format detected by detectInputFormat), with
+ * OSMXMLTokenizer.
+ *
+ * Plain files are memory-mapped and tokenized in place. Compressed files and standard input are read through a
+ * DecompressingReader (gzip & bzip2 files on a ParallelDecompressor), running ahead of the tokenizer on a
+ * ReadAheadSource, and tokenized directly out of the decompressed buffers.
+ *
+ * With nThreads != 1 (0 -> hardware concurrency), the text is cut into byte ranges at <node>/<way>/<relation> start
+ * tags, a batch at a time. Each range is tokenized on a worker thread into its own OSMDatabaseBuilder shard, and the
+ * shards are appended in file order, remapping tag key/value and member role indices into the global tables. Indices are
+ * assigned in order of first occurrence either way, so the database is identical to that of a single-threaded parse.
+ * A range which does not parse cleanly by itself (a cut inside a comment or unknown element) is re-parsed together with
+ * the following one.
+ */
+
+OSMDatabase parseOSMTokenized(const std::string fn,unsigned nThreads=0,
+		const OSMTagFilterProfile& filters=defaultTagFilterProfile());
+
+/// Parses into an existing builder (eg. one with entity retention predicates set)
+void parseOSMTokenized(const std::string fn,OSMDatabaseBuilder& dbb,unsigned nThreads=0,
+		const OSMTagFilterProfile& filters=defaultTagFilterProfile());
+
+#endif /* OSMXMLTOKENIZER_HPP_ */
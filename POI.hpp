@@ -12,19 +12,24 @@
 #include "OSMNode.hpp"
 #include "LatLon.h"
 
+#include <boost/serialization/version.hpp>
+
 class POI {
 public:
 
     POI() {
     }
 
-    POI(OSMID osmid, LatLon ll, std::string type, std::string name) :
+    POI(OSMID osmid, FixedLatLon ll, std::string type, std::string name) :
     m_osmNodeID(osmid),
     m_pos(ll),
     m_name(name),
     m_type(type) {
     }
 
+    POI(OSMID osmid, LatLon ll, std::string type, std::string name) : POI(osmid, FixedLatLon(ll), type, name) {
+    }
+
     const std::string& name() const {
         return m_name;
     }
@@ -41,19 +46,33 @@ public:
         return m_pos;
     }
 
+    FixedLatLon fixedPos() const {
+        return m_pos;
+    }
+
 private:
     OSMID m_osmNodeID = -1U;
-    LatLon m_pos;
+    FixedLatLon m_pos;
     std::string m_name;
     std::string m_type;
 
     friend boost::serialization::access;
 
+    // version 0 archives hold a float LatLon position
     template<class Archive>void serialize(Archive& ar, const unsigned ver) {
-        ar & m_osmNodeID & m_pos & m_name & m_type;
+        ar & m_osmNodeID;
+        if (ver == 0) {
+            LatLon ll;
+            ar & ll;
+            m_pos = FixedLatLon(ll);
+        } else
+            ar & m_pos;
+        ar & m_name & m_type;
     }
 };
 
+BOOST_CLASS_VERSION(POI, 1)
+
 
 
 
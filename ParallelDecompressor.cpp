@@ -0,0 +1,555 @@
+/*
+ * ParallelDecompressor.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "ParallelDecompressor.hpp"
+#include "IngestStats.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <zlib.h>
+
+#ifndef NO_BZIP2
+#include <bzlib.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+/// Reads n (<=64) bits MSB-first starting at bit offset pos
+uint64_t getBits(const unsigned char* p,uint64_t pos,unsigned n)
+{
+	uint64_t v=0;
+	for(unsigned i=0;i<n;++i,++pos)
+		v = (v << 1) | ((p[pos >> 3] >> (7 - (pos & 7))) & 1);
+	return v;
+}
+
+/// Appends bits MSB-first to a byte string
+class BitWriter
+{
+public:
+	BitWriter(string& s) : m_s(s){}
+
+	void put(uint64_t v,unsigned n)
+	{
+		for(int i=n-1;i>=0;--i)
+		{
+			m_acc = (m_acc << 1) | ((v >> i) & 1);
+			if (++m_n == 8)
+			{
+				m_s.push_back(char(m_acc));
+				m_acc=m_n=0;
+			}
+		}
+	}
+
+	/// Appends bits [begin,end) of p; fast when the writer is byte-aligned (as it is after the stream header)
+	void copy(const unsigned char* p,uint64_t begin,uint64_t end)
+	{
+		uint64_t nBytes = m_n == 0 ? (end-begin) >> 3 : 0;
+		const unsigned sh = begin & 7;
+		const unsigned char* q = p + (begin >> 3);
+
+		if (sh == 0)
+			m_s.append(reinterpret_cast<const char*>(q),nBytes);
+		else
+			for(uint64_t i=0;i<nBytes;++i)
+				m_s.push_back(char((q[i] << sh) | (q[i+1] >> (8-sh))));
+
+		for(uint64_t b=begin+(nBytes << 3); b<end; ++b)
+			put(getBits(p,b,1),1);
+	}
+
+	void flush()
+	{
+		if (m_n)
+			put(0,8-m_n);
+	}
+
+private:
+	string& 	m_s;
+	unsigned 	m_acc=0;
+	unsigned 	m_n=0;
+};
+
+const uint64_t bzBlockMagic = 0x314159265359ULL;
+const uint64_t bzEOSMagic = 0x177245385090ULL;
+
+#ifndef NO_BZIP2
+
+/** Decodes the bzip2 data in bit range [begin,end), which must start at a block magic and end at the following magic.
+ * The range is wrapped as a stream (header, blocks, end-of-stream marker) and handed to libbz2. With a single block, the
+ * stream CRC equals the block CRC. findBzip2Blocks drops end-of-stream marks which are not followed by the end of the
+ * file or another stream, so a chunk can only be cut short by a spurious block magic, and a merged (retried) range
+ * spanning such boundaries is still one real block.
+ */
+
+bool decodeBzip2(const unsigned char* p,uint64_t begin,uint64_t end,string& out)
+{
+	string in;
+	in.reserve(((end-begin) >> 3) + 16);
+	in = "BZh9";		// largest block size accepts blocks from any level
+
+	BitWriter w(in);
+	w.copy(p,begin,end);
+	w.put(bzEOSMagic,48);
+	w.put(getBits(p,begin+48,32),32);		// block CRC follows the block magic
+	w.flush();
+
+	bz_stream s;
+	memset(&s,0,sizeof(s));
+	if (BZ2_bzDecompressInit(&s,0,0) != BZ_OK)
+		return false;
+
+	s.next_in = &in[0];
+	s.avail_in = in.size();
+
+	out.clear();
+	size_t pos=0;
+	int ret=BZ_OK;
+
+	while(ret == BZ_OK)
+	{
+		out.resize(pos + max(size_t(1) << 20,in.size()*4));
+		s.next_out = &out[pos];
+		s.avail_out = out.size()-pos;
+
+		ret = BZ2_bzDecompress(&s);
+		pos = out.size() - s.avail_out;
+
+		if (ret == BZ_OK && s.avail_in == 0 && s.avail_out > 0)
+			ret = BZ_UNEXPECTED_EOF;
+	}
+
+	BZ2_bzDecompressEnd(&s);
+	out.resize(pos);
+	return ret == BZ_STREAM_END;
+}
+
+#endif
+
+/// Plausible gzip member header at byte k: magic, deflate, no reserved flags, known XFL & OS bytes
+bool isGzipHeader(const unsigned char* p,size_t N,size_t k)
+{
+	return k+10 <= N && p[k] == 0x1f && p[k+1] == 0x8b && p[k+2] == 8 && (p[k+3] & 0xe0) == 0 &&
+			(p[k+8] == 0 || p[k+8] == 2 || p[k+8] == 4) && (p[k+9] <= 13 || p[k+9] == 255);
+}
+
+/// Largest output a worker buffers for one gzip chunk; bigger members are streamed by the reader instead
+const size_t maxGzipChunkOutput = size_t(1) << 24;
+
+/** Inflates the gzip member(s) in byte range [begin,end), giving up (false) once the output exceeds maxOut */
+
+bool decodeGzip(const unsigned char* p,uint64_t begin,uint64_t end,string& out,size_t maxOut)
+{
+	z_stream z;
+	memset(&z,0,sizeof(z));
+	if (inflateInit2(&z,16+MAX_WBITS) != Z_OK)
+		return false;
+
+	out.clear();
+	size_t pos=0;
+	uint64_t inPos=begin;
+	int ret=Z_OK;
+
+	for(;;)
+	{
+		// zlib counts are 32-bit: feed large members in pieces
+		if (z.avail_in == 0 && inPos < end)
+		{
+			z.next_in = const_cast<unsigned char*>(p+inPos);
+			z.avail_in = uInt(min<uint64_t>(end-inPos,1U << 30));
+			inPos += z.avail_in;
+		}
+
+		if (out.size()-pos < (1 << 16))
+			out.resize(max(out.size()*2,pos+(size_t(1) << 20)));
+		z.next_out = reinterpret_cast<unsigned char*>(&out[pos]);
+		z.avail_out = uInt(min<size_t>(out.size()-pos,1U << 30));
+		const uInt before = z.avail_out;
+
+		ret = inflate(&z,Z_NO_FLUSH);
+		pos += before - z.avail_out;
+
+		if (pos > maxOut)
+		{
+			ret = Z_MEM_ERROR;
+			break;
+		}
+		else if (ret == Z_STREAM_END)
+		{
+			// another member may follow in this chunk (boundary not split, or spurious boundary retried)
+			const uint64_t next = inPos - z.avail_in;
+			if (next+2 <= end && p[next] == 0x1f && p[next+1] == 0x8b)
+			{
+				inPos = next;
+				z.avail_in = 0;
+				if ((ret = inflateReset(&z)) != Z_OK)
+					break;
+			}
+			else
+				break;		// end of chunk (trailing padding is ignored, as gzip does)
+		}
+		else if (ret == Z_BUF_ERROR && z.avail_in == 0 && inPos == end)
+			break;			// truncated: chunk ended mid-member
+		else if (ret != Z_OK && ret != Z_BUF_ERROR)
+			break;
+	}
+
+	inflateEnd(&z);
+	out.resize(pos);
+	return ret == Z_STREAM_END;
+}
+
+}
+
+
+
+/** Incremental inflate from a byte offset to the end of the file, used by the reader for gzip chunks which a worker
+ * could not decode: members larger than maxGzipChunkOutput, or members cut short by a spurious boundary.
+ */
+
+struct ParallelDecompressor::InflateStream
+{
+	InflateStream(const unsigned char* p_,uint64_t begin,uint64_t N_) : p(p_),inPos(begin),N(N_)
+	{
+		memset(&z,0,sizeof(z));
+		if (inflateInit2(&z,16+MAX_WBITS) != Z_OK)
+			throw std::runtime_error("ParallelDecompressor: inflateInit2 failed");
+	}
+
+	~InflateStream()
+	{
+		inflateEnd(&z);
+	}
+
+	/// Inflates up to bufSize bytes into out; returns true when the current member ended (at input offset memberEnd)
+	bool inflateSome(string& out)
+	{
+		const size_t bufSize = size_t(1) << 20;
+		out.resize(bufSize);
+		z.next_out = reinterpret_cast<unsigned char*>(&out[0]);
+		z.avail_out = bufSize;
+
+		int ret=Z_OK;
+		while(z.avail_out > 0 && (ret == Z_OK || ret == Z_BUF_ERROR))
+		{
+			if (z.avail_in == 0)
+			{
+				if (inPos == N)
+					throw std::runtime_error("ParallelDecompressor: corrupt or truncated compressed data");
+				z.next_in = const_cast<unsigned char*>(p+inPos);
+				z.avail_in = uInt(min<uint64_t>(N-inPos,1U << 30));
+				inPos += z.avail_in;
+			}
+			ret = inflate(&z,Z_NO_FLUSH);
+		}
+
+		out.resize(bufSize - z.avail_out);
+
+		if (ret == Z_STREAM_END)
+		{
+			memberEnd = inPos - z.avail_in;
+			return true;
+		}
+		else if (ret != Z_OK && ret != Z_BUF_ERROR)
+			throw std::runtime_error("ParallelDecompressor: corrupt or truncated compressed data");
+		return false;
+	}
+
+	const unsigned char* 	p;
+	uint64_t 				inPos;
+	uint64_t 				N;
+	uint64_t 				memberEnd=0;
+	z_stream 				z;
+};
+
+
+
+ParallelDecompressor::ParallelDecompressor(const std::string& fn,Format fmt,unsigned nThreads) :
+	m_file(fn),
+	m_format(fmt)
+{
+	if (m_format == Bzip2)
+	{
+#ifdef NO_BZIP2
+		throw std::logic_error("ParallelDecompressor: compiled without bzip2 support");
+#else
+		findBzip2Blocks();
+#endif
+	}
+	else
+		findGzipMembers();
+
+	if (nThreads == 0)
+		nThreads = max(1U,thread::hardware_concurrency());
+
+	m_window = 2*nThreads;
+	m_slots.resize(m_chunks.size());
+
+	for(unsigned t=0; t<nThreads && t<m_chunks.size(); ++t)
+		m_threads.emplace_back(&ParallelDecompressor::worker,this);
+}
+
+ParallelDecompressor::~ParallelDecompressor()
+{
+	{
+		lock_guard<mutex> L(m_mutex);
+		m_stop=true;
+	}
+	m_cv.notify_all();
+
+	for(auto& t : m_threads)
+		t.join();
+}
+
+ParallelDecompressor::Format ParallelDecompressor::formatFromFileName(const std::string& fn)
+{
+	std::size_t pos = fn.find_last_of('.');
+	std::string sfx = pos == std::string::npos ? std::string() : fn.substr(pos+1);
+
+	if (sfx == "gz")
+		return Gzip;
+	else if (sfx == "bz2")
+		return Bzip2;
+	else
+		throw std::logic_error("Invalid file extension in ParallelDecompressor::formatFromFileName");
+}
+
+void ParallelDecompressor::findBzip2Blocks()
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(m_file.data());
+	const size_t N = m_file.size();
+
+	if (N < 4 || memcmp(p,"BZh",3) != 0 || p[3] < '1' || p[3] > '9')
+		throw std::runtime_error("ParallelDecompressor: input is not a bzip2 file");
+
+	// bit offsets of every block (true) and end-of-stream (false) magic; neither is byte-aligned in general
+	vector<pair<uint64_t,bool>> marks;
+
+	const uint64_t mask = (1ULL << 48) - 1;
+	uint64_t r=0;
+
+	for(size_t k=0;k<N;++k)
+	{
+		r = (r << 8) | p[k];
+
+		for(int s=7;s>=0;--s)
+		{
+			const uint64_t w = (r >> s) & mask;
+			const uint64_t endBit = 8*(k+1)-s;
+
+			if ((w == bzBlockMagic || w == bzEOSMagic) && endBit >= 48)
+				marks.emplace_back(endBit-48,w == bzBlockMagic);
+		}
+	}
+
+	// a real end-of-stream mark is followed by the 32-bit stream CRC, padding to a byte, then end of file or the header
+	// of a concatenated stream; a match of the magic inside compressed data almost never is
+	auto isStreamEnd = [p,N](uint64_t bit)
+	{
+		const uint64_t next = (bit + 48 + 32 + 7) >> 3;
+		return next == N || (next+4 <= N && memcmp(p+next,"BZh",3) == 0 && p[next+3] >= '1' && p[next+3] <= '9');
+	};
+
+	marks.erase(remove_if(marks.begin(),marks.end(),[&isStreamEnd](const pair<uint64_t,bool>& m){
+		return !m.second && !isStreamEnd(m.first); }),marks.end());
+
+	for(size_t i=0;i<marks.size();++i)
+		if (marks[i].second)
+			m_chunks.push_back(Chunk{ marks[i].first, i+1 < marks.size() ? marks[i+1].first : 8*uint64_t(N) });
+}
+
+void ParallelDecompressor::findGzipMembers()
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(m_file.data());
+	const size_t N = m_file.size();
+
+	if (!isGzipHeader(p,N,0))
+		throw std::runtime_error("ParallelDecompressor: input is not a gzip file");
+
+	vector<uint64_t> starts(1,0);
+
+	for(const unsigned char* q=p+1; (q = static_cast<const unsigned char*>(memchr(q,0x1f,N-(q-p)))) != nullptr; ++q)
+		if (isGzipHeader(p,N,q-p))
+			starts.push_back(q-p);
+
+	for(size_t i=0;i<starts.size();++i)
+		m_chunks.push_back(Chunk{ starts[i], i+1 < starts.size() ? starts[i+1] : uint64_t(N) });
+}
+
+bool ParallelDecompressor::hasGzipSplitPoints(const std::string& fn)
+{
+	MappedFile f(fn);
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(f.data());
+	const size_t N = f.size();
+
+	if (N < 2)
+		return false;
+
+	for(const unsigned char* q=p+1; (q = static_cast<const unsigned char*>(memchr(q,0x1f,N-(q-p)))) != nullptr; ++q)
+		if (isGzipHeader(p,N,q-p))
+			return true;
+	return false;
+}
+
+bool ParallelDecompressor::decode(std::uint64_t begin,std::uint64_t end,std::string& out) const
+{
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(m_file.data());
+#ifndef NO_BZIP2
+	if (m_format == Bzip2)
+		return decodeBzip2(p,begin,end,out);
+#endif
+	return decodeGzip(p,begin,end,out,maxGzipChunkOutput);
+}
+
+void ParallelDecompressor::worker()
+{
+	for(;;)
+	{
+		size_t i;
+		{
+			unique_lock<mutex> L(m_mutex);
+			m_cv.wait(L,[this]{ return m_stop || m_nextToDecode >= m_chunks.size() || m_nextToDecode < m_nextToRead+m_window; });
+
+			if (m_stop || m_nextToDecode >= m_chunks.size())
+				return;
+			i = m_nextToDecode++;
+		}
+
+		string out;
+		bool ok=false;
+		try {
+			ok = decode(m_chunks[i].begin,m_chunks[i].end,out);
+		}
+		catch(...)
+		{
+			ok=false;
+		}
+
+		{
+			lock_guard<mutex> L(m_mutex);
+			m_slots[i].data.swap(out);
+			m_slots[i].ok = ok;
+			m_slots[i].done = true;
+		}
+		m_cv.notify_all();
+	}
+}
+
+bool ParallelDecompressor::nextSlot()
+{
+	unique_lock<mutex> L(m_mutex);
+
+	const size_t i = m_nextToRead;
+	if (i >= m_chunks.size())
+		return false;
+
+	m_cv.wait(L,[this,i]{ return m_slots[i].done; });
+
+	m_currentPos=0;
+	if (m_slots[i].ok)
+	{
+		m_current.swap(m_slots[i].data);
+		consumeTo(i+1,L);
+	}
+	else if (m_format == Gzip)
+	{
+		// too large to buffer or cut short by a spurious boundary: stream it from here, running past the chunk end if
+		// need be, until the member ends (see streamMore)
+		m_current.clear();
+		m_inflate.reset(new InflateStream(reinterpret_cast<const unsigned char*>(m_file.data()),m_chunks[i].begin,
+				m_file.size()));
+	}
+	else
+	{
+		// chunk i failed: assume the following boundary was spurious and merge until it decodes
+		size_t j=i+1;
+		bool ok=false;
+		while(!ok && j < m_chunks.size())
+		{
+			L.unlock();
+			ok = decode(m_chunks[i].begin,m_chunks[j].end,m_current);
+			L.lock();
+			++j;
+		}
+
+		if (!ok)
+			throw std::runtime_error("ParallelDecompressor: corrupt or truncated compressed data");
+
+		consumeTo(j,L);
+	}
+	return true;
+}
+
+void ParallelDecompressor::streamMore()
+{
+	m_currentPos=0;
+	if (!m_inflate->inflateSome(m_current))
+		return;
+
+	const uint64_t next = m_inflate->memberEnd;
+	m_inflate.reset();
+
+	// resume at the first chunk starting at or after the member end; bytes in between are padding, ignored as in decode
+	unique_lock<mutex> L(m_mutex);
+	const size_t j = lower_bound(m_chunks.begin()+m_nextToRead+1,m_chunks.end(),next,
+			[](const Chunk& c,uint64_t b){ return c.begin < b; }) - m_chunks.begin();
+	consumeTo(j,L);
+}
+
+void ParallelDecompressor::consumeTo(std::size_t j,std::unique_lock<std::mutex>& L)
+{
+	const size_t i = m_nextToRead;
+
+	// don't decode chunks before j, and wait for any in flight before discarding them
+	const size_t dispatched = m_nextToDecode;
+	m_nextToDecode = max(m_nextToDecode,j);
+
+	m_cv.wait(L,[this,i,j,dispatched]{
+		for(size_t k=i;k<j && k<dispatched;++k)
+			if (!m_slots[k].done)
+				return false;
+		return true; });
+
+	for(size_t k=i;k<j;++k)
+		string().swap(m_slots[k].data);
+
+	m_nextToRead = j;
+
+	// compressed bytes consumed (chunk bounds are bit offsets for bzip2)
+	const uint64_t consumed = m_chunks[j-1].end-m_chunks[i].begin;
+	ingestStats().inputBytes += m_format == Bzip2 ? consumed/8 : consumed;
+
+	L.unlock();
+	m_cv.notify_all();
+}
+
+std::size_t ParallelDecompressor::read(char* dst,std::size_t n)
+{
+	size_t total=0;
+	while(total < n)
+	{
+		if (m_currentPos == m_current.size())
+		{
+			if (m_inflate)
+				streamMore();
+			else if (!nextSlot())
+				break;
+			continue;
+		}
+
+		const size_t k = min(n-total,m_current.size()-m_currentPos);
+		memcpy(dst+total,m_current.data()+m_currentPos,k);
+		m_currentPos += k;
+		total += k;
+	}
+	return total;
+}
@@ -0,0 +1,133 @@
+/*
+ * ParallelDecompressor.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef PARALLELDECOMPRESSOR_HPP_
+#define PARALLELDECOMPRESSOR_HPP_
+
+#include "FlatFile.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/iostreams/categories.hpp>
+
+/** Decompresses a .bz2 or .gz file on a pool of worker threads, delivering the output strictly in order.
+ *
+ * The mapped input is split into independently-decodable chunks:
+ *
+ *   bzip2	every compressed block (found by bit-level search for the 48-bit block magic) is wrapped into a synthetic
+ *   		one-block stream, as bzip2recover does. This works for single- and multi-stream (pbzip2/lbzip2, planet) files.
+ *   gzip	each gzip member (pigz/bgzip style multi-member files) is one chunk. A single-member file has no usable
+ *   		split points; DecompressingReader checks hasGzipSplitPoints and streams such files serially instead.
+ *
+ * A spurious boundary (magic bytes occurring by chance inside compressed data) makes a chunk fail to decode. For bzip2
+ * the reader retries it merged with its successor(s); for gzip it inflates the chunk itself, incrementally, running past
+ * the chunk end until the member ends. Either way the output is identical to serial decompression.
+ *
+ * At most window chunks are decoded ahead of the reader. bzip2 chunks are one block (<= ~46 MB out, 900 kB in the
+ * usual case); a worker gives up on a gzip chunk whose output exceeds 16 MB and leaves it to the reader to stream, so
+ * memory use is bounded by the window whatever the member sizes.
+ */
+
+class ParallelDecompressor
+{
+public:
+	enum Format { Gzip, Bzip2 };
+
+	ParallelDecompressor(const std::string& fn,Format fmt,unsigned nThreads=0);
+	~ParallelDecompressor();
+
+	ParallelDecompressor(const ParallelDecompressor&) = delete;
+	ParallelDecompressor& operator=(const ParallelDecompressor&) = delete;
+
+	/// Copies up to n decompressed bytes to dst, returning the number copied (0 at end of input)
+	std::size_t read(char* dst,std::size_t n);
+
+	std::size_t chunks() const { return m_chunks.size(); }
+	unsigned threads() const { return m_threads.size(); }
+
+	/// True if the .gz file has a plausible member header past the first, ie. it may be worth decompressing in parallel
+	static bool hasGzipSplitPoints(const std::string& fn);
+
+	/// Returns the format implied by a file name's last extension (.gz/.bz2); throws std::logic_error otherwise
+	static Format formatFromFileName(const std::string& fn);
+
+private:
+	/// Range of the input making up one chunk; bit offsets for bzip2, byte offsets for gzip
+	struct Chunk
+	{
+		std::uint64_t begin;
+		std::uint64_t end;
+	};
+
+	struct Slot
+	{
+		std::string data;
+		bool done=false;
+		bool ok=false;
+	};
+
+	void findBzip2Blocks();
+	void findGzipMembers();
+
+	bool decode(std::uint64_t begin,std::uint64_t end,std::string& out) const;
+	void worker();
+	bool nextSlot();
+	void streamMore();
+	void consumeTo(std::size_t j,std::unique_lock<std::mutex>& L);
+
+	struct InflateStream;
+
+	MappedFile 					m_file;
+	Format 						m_format;
+
+	std::vector<Chunk> 			m_chunks;
+	std::vector<Slot> 			m_slots;
+
+	std::mutex 					m_mutex;
+	std::condition_variable 	m_cv;
+	std::size_t 				m_nextToDecode=0;
+	std::size_t 				m_nextToRead=0;
+	std::size_t 				m_window=0;
+	bool 						m_stop=false;
+
+	std::vector<std::thread> 	m_threads;
+
+	std::string 				m_current;		// chunk currently being read out
+	std::size_t 				m_currentPos=0;
+	std::unique_ptr<InflateStream> m_inflate;		// gzip chunk being streamed by the reader, if any
+};
+
+
+
+/** Boost.Iostreams Source adaptor so that the decompressor can be used where BoostInputStream expects a stream */
+
+class ParallelDecompressorSource
+{
+public:
+	typedef char 							char_type;
+	typedef boost::iostreams::source_tag 	category;
+
+	ParallelDecompressorSource(){}
+	explicit ParallelDecompressorSource(const std::shared_ptr<ParallelDecompressor>& d) : m_decompressor(d){}
+
+	std::streamsize read(char* s,std::streamsize n)
+	{
+		std::size_t N = m_decompressor->read(s,n);
+		return N == 0 && n > 0 ? -1 : std::streamsize(N);
+	}
+
+private:
+	std::shared_ptr<ParallelDecompressor> m_decompressor;
+};
+
+#endif /* PARALLELDECOMPRESSOR_HPP_ */
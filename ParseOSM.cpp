@@ -5,6 +5,7 @@
  *      Author: jcassidy
  */
 
+#include "ParseOSM.hpp"
 #include "ParseXML.hpp"
 
 #include "OSMDatabase.hpp"
@@ -14,17 +15,37 @@
 #include "OSMElementHandler.hpp"
 
 #include "SAX2ElementHandler.hpp"
+#include "OSMTagFilter.hpp"
+#include "IngestStats.hpp"
 
 #include <iostream>
 #include <iomanip>
 
 using namespace std;
 
-OSMDatabase parseOSM(xercesc::InputSource *src)
+/** Installs a tag filter on a <tag> element handler.
+ * Kept keys are added to the string table handler h up front; other keys are classified on first occurrence by the
+ * compiled filter, and routed to h or ignoreTag.
+ */
+
+void applyTagFilter(OSMTagElementHandler& tagH,const OSMTagFilter& f,OSMTagHandler* h)
+{
+	for(const auto& k : f.keep)
+		tagH.addKey(k,h);
+
+	tagH.addRule(new OSMTagClassifierKeyRule(f,h,&ignoreTag));
+}
+
+OSMDatabase parseOSM(xercesc::InputSource *src,const OSMTagFilterProfile& filters)
 {
 	//  Builder for the basic OSM database
 	OSMDatabaseBuilder dbb;
+	parseOSM(src,dbb,filters);
+	return dbb.getDatabase();
+}
 
+void parseOSM(xercesc::InputSource *src,OSMDatabaseBuilder& dbb,const OSMTagFilterProfile& filters)
+{
 	// base element handler for all OSM entities (node, way, rel) with some common attribute rules and ID extraction
 	OSMEntityHandlerBase baseEntityHandler("???",&dbb);
 
@@ -85,142 +106,11 @@ OSMDatabase parseOSM(xercesc::InputSource *src)
 	nodeHandler.setDefaultAttributeHandler(&warnNode);
 
 	nodeHandler.addAttributeHandler("lat",
-			makeTypedAttributeHandler<double>([&dbb](double lat){dbb.currentNode()->coords().lat=lat; }));
+			makeTypedAttributeHandler<double>([&dbb](double lat){dbb.currentNode()->fixedCoords().lat=FixedLatLon::fromDegrees(lat); }));
 	nodeHandler.addAttributeHandler("lon",
-			makeTypedAttributeHandler<double>([&dbb](double lon){dbb.currentNode()->coords().lon=lon; }));
-
-	nodeTagHandler.addKey("name",&nodeTagStringTable);
-
-	std::vector<std::string> nodeTagKeysToIgnore{
-		"source",
-		"created_by",
-		"crossing",
-		"gates",
-		"lights",
-		"go_zone",
-		"crossing_ref",
-		"red_light_camera",
-		"button",
-		"wheelchair",
-		"fixme",
-		"noexit",
-		"guidepost",
-		"layer",
-		"power",
-		"aeroway",
-		"drive_through",
-		"dispensing",
-		"alt_name",
-		"drive_thru",
-		"brand",
-		"opening_hours",
-		"tower:type",
-		"phone",
-		"barrier",
-		"traffic_calming",
-		"emergency",
-		"note",
-		"fee",
-		"fireplace",
-		"FIXME",
-		"indoor",
-		"old_name",
-		"internet_access",
-		"building:levels",
-		"board_type",
-		"information",
-		"office",
-		"route",
-		"attribution",
-		"material",
-		"contents",
-		"height",
-		"works:type",
-		"pipeline",
-		"landuse",
-		"content",
-		"color",
-		"trim",
-		"bench",
-		"countdown_signal",
-		"covered",
-		"hiking",
-		"map_size",
-		"map_type",
-		"entrance",
-		"toilets",
-		"signal",
-		"colour",
-		"designation",
-		"motor_vehicle",
-		"vehicle",
-		"disused",
-		"vending",
-		"email",
-		"smoking",
-		"capacity",
-		"computer",
-		"backrest",
-		"street_lamp",
-		"booth",
-		"banquet",
-		"crossing:barrier",
-		"crossing:bell",
-		"supervised",
-		"lanes",
-		"surface",
-		"motorcar",
-		"bollard",
-		"url",
-		"services",
-		"seats",
-		"tactile_paving"
-	};
-
-	std::vector<std::string> wayTagKeysToIgnore{
-		"source",
-		"electrified",
-		"gauge",
-		"line",
-		"operator",
-		"created_by",
-		"handrail:right",
-		"handrail:left",
-		"attribution",
-		"note",
-		"FIXME",
-		"alt_name",
-		"wikipedia",
-		"website",
-		"voltage",
-		"fee",
-		"park_ride",
-		"iata",
-		"parking:condition:area",
-		"validate:no_name",
-		"trail_visibility",
-		"color",
-		"evangelical",
-		"start_date",
-		"fireplace",
-		"fax",
-		"roof:height"
-	};
+			makeTypedAttributeHandler<double>([&dbb](double lon){dbb.currentNode()->fixedCoords().lon=FixedLatLon::fromDegrees(lon); }));
 
-	nodeTagHandler.addRule(new OSMTagRegexKeyRule("addr:.*",&ignoreTag));
-	nodeTagHandler.addRule(new OSMTagRegexKeyRule("name:.*",&ignoreTag));
-	nodeTagHandler.addRule(new OSMTagRegexKeyRule("is_in.*",&ignoreTag));
-	nodeTagHandler.addRule(new OSMTagRegexKeyRule("payment:.*",&ignoreTag));
-	nodeTagHandler.addRule(new OSMTagRegexKeyRule("contact:.*",&ignoreTag));
-	nodeTagHandler.addRule(new OSMTagRegexKeyRule("currency:.*",&ignoreTag));
-	nodeTagHandler.addRule(new OSMTagRegexKeyRule("canvec:.*",&ignoreTag));
-	nodeTagHandler.addRule(new OSMTagRegexKeyRule("generator:.*",&ignoreTag));
-	nodeTagHandler.addRule(new OSMTagRegexKeyRule("toilets:.*",&ignoreTag));
-	nodeTagHandler.addRule(new OSMTagRegexKeyRule("wetap:.*",&ignoreTag));
-
-
-	for(const auto& k : nodeTagKeysToIgnore)
-		nodeTagHandler.ignoreTagWithKey(k);
+	applyTagFilter(nodeTagHandler,filters.node,&nodeTagStringTable);
 
 	osmHandler.addElementHandler("way",&wayHandler);
 
@@ -230,20 +120,7 @@ OSMDatabase parseOSM(xercesc::InputSource *src)
 	WarnAttribute warnWay("<way>");
 	wayHandler.setDefaultAttributeHandler(&warnWay);
 
-	wayTagHandler.addKey("name",&wayTagStringTable);
-	wayTagHandler.addKey("name:en",&wayTagStringTable);
-
-
-	wayTagHandler.addRule(new OSMTagRegexKeyRule("geobase:.*",&ignoreTag));
-	wayTagHandler.addRule(new OSMTagRegexKeyRule("canvec:.*",&ignoreTag));
-	wayTagHandler.addRule(new OSMTagRegexKeyRule("statscan:.*",&ignoreTag));
-	wayTagHandler.addRule(new OSMTagRegexKeyRule("addr:.*",&ignoreTag));
-	wayTagHandler.addRule(new OSMTagRegexKeyRule("name:.*",&ignoreTag));
-	wayTagHandler.addRule(new OSMTagRegexKeyRule("payment:.*",&ignoreTag));
-	wayTagHandler.addRule(new OSMTagRegexKeyRule("capacity:.*",&ignoreTag));
-
-	for(const auto& k : wayTagKeysToIgnore)
-		wayTagHandler.ignoreTagWithKey(k);
+	applyTagFilter(wayTagHandler,filters.way,&wayTagStringTable);
 
 	osmHandler.addElementHandler("relation",&relationHandler);
 	relationHandler.addElementHandler("tag",&relationTagHandler);
@@ -258,31 +135,7 @@ OSMDatabase parseOSM(xercesc::InputSource *src)
 	relationHandler.ignoreAttribute("uid");
 	relationHandler.ignoreAttribute("user");
 
-	std::vector<std::string> relationTagKeysToIgnore{
-		"wikipedia",
-		"note",
-		"attribution",
-		"is_in",
-		"fixme",
-		"day_off",
-		"day_on",
-		"hour_off",
-		"hour_on",
-		"FXIME",
-		"FIXME",
-		"source"
-	};
-
-	relationTagHandler.addKey("name",&relationTagStringTable);
-	relationTagHandler.addKey("name:en",&relationTagStringTable);
-
-	relationTagHandler.addRule(new OSMTagRegexKeyRule("name:.*",&ignoreTag));
-	relationTagHandler.addRule(new OSMTagRegexKeyRule("canvec:.*",&ignoreTag));
-	relationTagHandler.addRule(new OSMTagRegexKeyRule("wikipedia:.*",&ignoreTag));
-	relationTagHandler.addRule(new OSMTagRegexKeyRule("addr:.*",&ignoreTag));
-
-	for(const auto& k : relationTagKeysToIgnore)
-		relationTagHandler.ignoreTagWithKey(k);
+	applyTagFilter(relationTagHandler,filters.relation,&relationTagStringTable);
 
 	SAX2ContentHandler handler(&rootHandler);
 
@@ -307,6 +160,16 @@ OSMDatabase parseOSM(xercesc::InputSource *src)
 	for(const auto p : v)
 		cout << "  " << setw(30) << p.first << "  " << p.second << endl;
 
+	// tag occurrences by the filter rule which decided each key
+	auto addTagStats = [](OSMEntityType type,const OSMTagFilter& f,const vector<pair<string,unsigned>>& keys)
+	{
+		const OSMTagKeyClassifier c(f);
+		for(const auto& p : keys)
+			if (p.second)
+				ingestStats().addTagKey(type,c,p.first,p.second);
+	};
 
-	return dbb.getDatabase();
+	addTagStats(Node,filters.node,nodeTagHandler.tagKeys());
+	addTagStats(Way,filters.way,wayTagHandler.tagKeys());
+	addTagStats(Relation,filters.relation,relationTagHandler.tagKeys());
 }
@@ -9,9 +9,15 @@
 #define PARSEOSM_HPP_
 
 #include "OSMDatabase.hpp"
+#include "OSMTagFilter.hpp"
 #include <xercesc/sax/InputSource.hpp>
 
-OSMDatabase parseOSM(xercesc::InputSource *src);
+class OSMDatabaseBuilder;
+
+OSMDatabase parseOSM(xercesc::InputSource *src,const OSMTagFilterProfile& filters=defaultTagFilterProfile());
+
+/// Parses into an existing builder (eg. one with entity retention predicates set)
+void parseOSM(xercesc::InputSource *src,OSMDatabaseBuilder& dbb,const OSMTagFilterProfile& filters=defaultTagFilterProfile());
 
 
 #endif /* PARSEOSM_HPP_ */
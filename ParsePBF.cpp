@@ -0,0 +1,711 @@
+/*
+ * ParsePBF.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "ParsePBF.hpp"
+
+#include "OSMDatabase.hpp"
+#include "OSMDatabaseBuilder.hpp"
+#include "OSMTagFilter.hpp"
+#include "ProtobufReader.hpp"
+#include "InputFormat.hpp"
+#include "IngestStats.hpp"
+
+#include <zlib.h>
+
+#include <boost/iostreams/stream.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+/// Entities of one type decoded from a block, with tags held separately (CSR) since they still refer to the block string table
+template<class EntityType>struct PBFEntities {
+	vector<EntityType>					entities;
+	vector<pair<unsigned,unsigned>>		tags;			// (key,value) block string-table indices
+	vector<size_t>						tagEnd;			// tags for entity i are [tagEnd[i-1],tagEnd[i])
+
+	void finishEntity(){ tagEnd.push_back(tags.size()); }
+};
+
+/// A decoded OSMData block; relation member roles are also block string-table indices until merged
+struct PBFBlock {
+	vector<string>						strings;
+
+	PBFEntities<OSMNode>				nodes;
+	PBFEntities<OSMWay>					ways;
+	PBFEntities<OSMRelation>			relations;
+
+	vector<unsigned long long>			ndrefs;			// node refs of way i are [ndrefEnd[i-1],ndrefEnd[i])
+	vector<size_t>						ndrefEnd;
+
+	vector<OSMRelation::Member>			members;
+	vector<size_t>						memberEnd;
+};
+
+/// Raw blob as read from the file: type string ("OSMHeader"/"OSMData") and undecoded Blob message
+struct PBFRawBlob {
+	string			type;
+	vector<char>	data;
+};
+
+typedef pair<const char*,const char*> ByteRange;
+
+inline string asString(ByteRange r){ return string(r.first,r.second); }
+
+
+/** Reads the next (BlobHeader,Blob) pair from the stream. Returns false on clean end of file.
+ */
+
+bool readBlob(istream& is,PBFRawBlob& blob)
+{
+	unsigned char lenBytes[4];
+
+	is.read((char*)lenBytes,4);
+	if (is.gcount() == 0 && is.eof())
+		return false;
+	else if (is.gcount() != 4)
+		throw ios_base::failure("Truncated BlobHeader length in PBF file");
+
+	uint32_t headerLen = (uint32_t(lenBytes[0]) << 24) | (uint32_t(lenBytes[1]) << 16) | (uint32_t(lenBytes[2]) << 8) | uint32_t(lenBytes[3]);
+
+	if (headerLen > 64*1024)
+		throw runtime_error("BlobHeader exceeds 64kB limit in PBF file");
+
+	vector<char> header(headerLen);
+	if (!is.read(header.data(),headerLen))
+		throw ios_base::failure("Truncated BlobHeader in PBF file");
+
+	uint64_t dataSize=0;
+	blob.type.clear();
+
+	ProtobufReader r(header.data(),header.data()+header.size());
+	while(r.next())
+		switch(r.field())
+		{
+		case 1: blob.type = asString(r.bytes()); break;
+		case 3: dataSize = r.varint(); break;
+		default: r.skip();
+		}
+
+	if (dataSize > 32*1024*1024)
+		throw runtime_error("Blob exceeds 32MB limit in PBF file");
+
+	blob.data.resize(dataSize);
+	if (!is.read(blob.data.data(),dataSize))
+		throw ios_base::failure("Truncated Blob in PBF file");
+
+	ingestStats().inputBytes += 4+headerLen+dataSize;
+
+	return true;
+}
+
+
+/** Extracts the (possibly zlib-compressed) payload of a Blob message.
+ */
+
+void decompressBlob(const vector<char>& blob,vector<char>& out)
+{
+	ByteRange raw(nullptr,nullptr),zdata(nullptr,nullptr);
+	uint64_t rawSize=0;
+
+	ProtobufReader r(blob.data(),blob.data()+blob.size());
+	while(r.next())
+		switch(r.field())
+		{
+		case 1: raw = r.bytes(); break;
+		case 2: rawSize = r.varint(); break;
+		case 3: zdata = r.bytes(); break;
+		case 4: throw runtime_error("PBF blob uses unsupported lzma compression");
+		case 6: throw runtime_error("PBF blob uses unsupported lz4 compression");
+		case 7: throw runtime_error("PBF blob uses unsupported zstd compression");
+		default: r.skip();
+		}
+
+	if (raw.first)
+		out.assign(raw.first,raw.second);
+	else if (zdata.first)
+	{
+		out.resize(rawSize);
+		uLongf destLen = rawSize;
+		int ret = uncompress((Bytef*)out.data(),&destLen,(const Bytef*)zdata.first,zdata.second-zdata.first);
+		if (ret != Z_OK || destLen != rawSize)
+			throw runtime_error("zlib decompression failed for PBF blob");
+	}
+	else
+		throw runtime_error("PBF blob has no data");
+
+	ingestStats().decompressedBytes += out.size();
+}
+
+
+/** Parses the OSMHeader block, setting the database bounds from the bounding box if present.
+ */
+
+void decodeHeaderBlock(const vector<char>& data,OSMDatabaseBuilder& dbb)
+{
+	ProtobufReader r(data.data(),data.data()+data.size());
+	while(r.next())
+		switch(r.field())
+		{
+		case 1:						// HeaderBBox, in nanodegrees
+		{
+			int64_t left=0,right=0,top=0,bottom=0;
+			ProtobufReader bb(r.bytes());
+			while(bb.next())
+				switch(bb.field())
+				{
+				case 1: left = bb.svarint(); break;
+				case 2: right = bb.svarint(); break;
+				case 3: top = bb.svarint(); break;
+				case 4: bottom = bb.svarint(); break;
+				default: bb.skip();
+				}
+			dbb.bounds = make_pair(LatLon(1e-9*bottom,1e-9*left),LatLon(1e-9*top,1e-9*right));
+			break;
+		}
+		case 4:						// required_features
+		{
+			string feat = asString(r.bytes());
+			if (feat != "OsmSchema-V0.6" && feat != "DenseNodes")
+				cerr << "WARNING: PBF file requires unsupported feature '" << feat << "'" << endl;
+			break;
+		}
+		default: r.skip();
+		}
+}
+
+
+/** Decodes key/value index arrays (fields 2 & 3 of Node/Way/Relation) into the tag vector */
+
+template<class EntityType>void appendTags(PBFEntities<EntityType>& E,const vector<unsigned>& keys,const vector<unsigned>& vals)
+{
+	if (keys.size() != vals.size())
+		throw runtime_error("Mismatched key/value counts in PBF entity");
+	for(unsigned i=0;i<keys.size();++i)
+		E.tags.emplace_back(keys[i],vals[i]);
+}
+
+struct BlockCoordinates {
+	int64_t granularity=100;
+	int64_t latOffset=0;
+	int64_t lonOffset=0;
+
+	/// Converts in integer arithmetic, so the usual granularity of 100 nanodegrees is exact
+	FixedLatLon operator()(int64_t lat,int64_t lon) const
+	{
+		return FixedLatLon(toFixed(latOffset+granularity*lat),toFixed(lonOffset+granularity*lon));
+	}
+
+	/// Nanodegrees to 1e-7 degree units, rounding to nearest
+	static int32_t toFixed(int64_t nano)
+	{
+		return int32_t((nano + (nano < 0 ? -50 : 50)) / 100);
+	}
+};
+
+void decodeDenseNodes(ByteRange msg,const BlockCoordinates& C,PBFBlock& blk)
+{
+	vector<int64_t> ids,lats,lons;
+	vector<unsigned> kv;
+
+	ProtobufReader r(msg);
+	while(r.next())
+		switch(r.field())
+		{
+		case 1: r.packedSVarints([&ids](int64_t x){ ids.push_back(x); }); break;
+		case 8: r.packedSVarints([&lats](int64_t x){ lats.push_back(x); }); break;
+		case 9: r.packedSVarints([&lons](int64_t x){ lons.push_back(x); }); break;
+		case 10: r.packedVarints([&kv](uint64_t x){ kv.push_back(x); }); break;
+		default: r.skip();
+		}
+
+	if (ids.size() != lats.size() || ids.size() != lons.size())
+		throw runtime_error("Mismatched array lengths in PBF DenseNodes");
+
+	int64_t id=0,lat=0,lon=0;
+	size_t j=0;
+
+	for(unsigned i=0;i<ids.size();++i)
+	{
+		id += ids[i];
+		lat += lats[i];
+		lon += lons[i];
+
+		blk.nodes.entities.emplace_back(id);
+		blk.nodes.entities.back().coords(C(lat,lon));
+
+		// keys_vals is a sequence of (k,v)* 0 per node, or empty if no node in the block has tags
+		while(j < kv.size() && kv[j] != 0)
+		{
+			if (j+1 >= kv.size())
+				throw runtime_error("Truncated keys_vals in PBF DenseNodes");
+			blk.nodes.tags.emplace_back(kv[j],kv[j+1]);
+			j += 2;
+		}
+		++j;
+
+		blk.nodes.finishEntity();
+	}
+}
+
+void decodeNode(ByteRange msg,const BlockCoordinates& C,PBFBlock& blk)
+{
+	int64_t id=0,lat=0,lon=0;
+	vector<unsigned> keys,vals;
+
+	ProtobufReader r(msg);
+	while(r.next())
+		switch(r.field())
+		{
+		case 1: id = r.svarint(); break;
+		case 2: r.packedVarints([&keys](uint64_t x){ keys.push_back(x); }); break;
+		case 3: r.packedVarints([&vals](uint64_t x){ vals.push_back(x); }); break;
+		case 8: lat = r.svarint(); break;
+		case 9: lon = r.svarint(); break;
+		default: r.skip();
+		}
+
+	blk.nodes.entities.emplace_back(id);
+	blk.nodes.entities.back().coords(C(lat,lon));
+	appendTags(blk.nodes,keys,vals);
+	blk.nodes.finishEntity();
+}
+
+void decodeWay(ByteRange msg,PBFBlock& blk)
+{
+	OSMWay w;
+	vector<unsigned> keys,vals;
+
+	ProtobufReader r(msg);
+	while(r.next())
+		switch(r.field())
+		{
+		case 1: w.id(r.varint()); break;
+		case 2: r.packedVarints([&keys](uint64_t x){ keys.push_back(x); }); break;
+		case 3: r.packedVarints([&vals](uint64_t x){ vals.push_back(x); }); break;
+		case 8:
+		{
+			int64_t ref=0;
+			r.packedSVarints([&blk,&ref](int64_t d){ ref += d; blk.ndrefs.push_back(ref); });
+			break;
+		}
+		default: r.skip();
+		}
+
+	blk.ndrefEnd.push_back(blk.ndrefs.size());
+
+	blk.ways.entities.push_back(std::move(w));
+	appendTags(blk.ways,keys,vals);
+	blk.ways.finishEntity();
+}
+
+void decodeRelation(ByteRange msg,PBFBlock& blk)
+{
+	OSMRelation rel;
+	vector<unsigned> keys,vals,roles,types;
+	vector<int64_t> memids;
+
+	ProtobufReader r(msg);
+	while(r.next())
+		switch(r.field())
+		{
+		case 1: rel.id(r.varint()); break;
+		case 2: r.packedVarints([&keys](uint64_t x){ keys.push_back(x); }); break;
+		case 3: r.packedVarints([&vals](uint64_t x){ vals.push_back(x); }); break;
+		case 8: r.packedVarints([&roles](uint64_t x){ roles.push_back(x); }); break;
+		case 9: r.packedSVarints([&memids](int64_t x){ memids.push_back(x); }); break;
+		case 10: r.packedVarints([&types](uint64_t x){ types.push_back(x); }); break;
+		default: r.skip();
+		}
+
+	if (roles.size() != memids.size() || types.size() != memids.size())
+		throw runtime_error("Mismatched member array lengths in PBF Relation");
+
+	int64_t id=0;
+	for(unsigned i=0;i<memids.size();++i)
+	{
+		id += memids[i];
+
+		OSMRelation::MemberType t;
+		switch(types[i])
+		{
+		case 0: t = OSMRelation::Node; break;
+		case 1: t = OSMRelation::Way; break;
+		case 2: t = OSMRelation::Relation; break;
+		default: t = OSMRelation::InvalidType;
+		}
+		blk.members.push_back(OSMRelation::Member{ (unsigned long long)id, t, roles[i] });
+	}
+	blk.memberEnd.push_back(blk.members.size());
+
+	blk.relations.entities.push_back(std::move(rel));
+	appendTags(blk.relations,keys,vals);
+	blk.relations.finishEntity();
+}
+
+
+/** Decodes an OSMData PrimitiveBlock into a PBFBlock. Safe to call concurrently on different blocks.
+ */
+
+void decodePrimitiveBlock(const vector<char>& data,PBFBlock& blk)
+{
+	BlockCoordinates C;
+	vector<ByteRange> groups;
+
+	// first pass: string table and coordinate scaling (which follow the groups on the wire)
+	ProtobufReader r(data.data(),data.data()+data.size());
+	while(r.next())
+		switch(r.field())
+		{
+		case 1:
+		{
+			ProtobufReader st(r.bytes());
+			while(st.next())
+				if (st.field() == 1)
+					blk.strings.push_back(asString(st.bytes()));
+				else
+					st.skip();
+			break;
+		}
+		case 2: groups.push_back(r.bytes()); break;
+		case 17: C.granularity = r.varint(); break;
+		case 19: C.latOffset = r.varint(); break;
+		case 20: C.lonOffset = r.varint(); break;
+		default: r.skip();
+		}
+
+	// second pass: the primitive groups
+	for(const ByteRange& g : groups)
+	{
+		ProtobufReader gr(g);
+		while(gr.next())
+			switch(gr.field())
+			{
+			case 1: decodeNode(gr.bytes(),C,blk); break;
+			case 2: decodeDenseNodes(gr.bytes(),C,blk); break;
+			case 3: decodeWay(gr.bytes(),blk); break;
+			case 4: decodeRelation(gr.bytes(),blk); break;
+			default: gr.skip();
+			}
+	}
+}
+
+
+/** Maps block string-table indices for tags onto one of the database key-value tables, applying the tag filter.
+ *
+ * Key decisions and value indices are kept globally by string; per-block vectors cache the lookup for each block
+ * string-table index so each distinct string is hashed at most once per block. Occurrences of each key are counted
+ * for the ingest statistics.
+ */
+
+class PBFTagTableMapper {
+public:
+	PBFTagTableMapper(BoundKeyValueTable& tbl,const OSMTagFilter& filter) : tbl_(tbl),classifier_(filter)
+	{
+		for(const auto& k : filter.keep)
+			if (keys_.insert(make_pair(k,keyInfo_.size())).second)
+				keyInfo_.push_back(KeyInfo{ tbl_.addKey(k), 0 });
+	}
+
+	void startBlock(const vector<string>& strings)
+	{
+		strings_ = &strings;
+		blockKeys_.assign(strings.size(),unresolved);
+		blockValues_.assign(strings.size(),unresolved);
+	}
+
+	template<class EntityType>void addTags(const PBFEntities<EntityType>& E,unsigned i)
+	{
+		for(size_t t = i == 0 ? 0 : E.tagEnd[i-1]; t < E.tagEnd[i]; ++t)
+		{
+			KeyInfo& ki = keyInfo_[mapKey(E.tags[t].first)];
+			ki.count++;
+			if (ki.idx != -1U)
+				tbl_.addTag(ki.idx,mapValue(E.tags[t].second));
+		}
+	}
+
+	void addTagStats(IngestStats& stats,OSMEntityType type) const
+	{
+		for(const auto& p : keys_)
+			if (keyInfo_[p.second].count)
+				stats.addTagKey(type,classifier_,p.first,keyInfo_[p.second].count);
+	}
+
+private:
+	static constexpr unsigned unresolved=-2U;
+
+	struct KeyInfo
+	{
+		unsigned 		idx;				// key index, -1U if ignored
+		uint64_t 		count;
+	};
+
+	/// Returns the position in keyInfo_ of block string si
+	unsigned mapKey(unsigned si)
+	{
+		unsigned& ki = blockKeys_.at(si);
+		if (ki == unresolved)
+		{
+			const string& k = (*strings_)[si];
+			auto it = keys_.find(k);
+			if (it == keys_.end())
+			{
+				it = keys_.insert(make_pair(k,keyInfo_.size())).first;
+				keyInfo_.push_back(KeyInfo{ classifier_.keep(k) ? tbl_.addKey(k) : -1U, 0 });
+			}
+			ki = it->second;
+		}
+		return ki;
+	}
+
+	unsigned mapValue(unsigned si)
+	{
+		unsigned& vi = blockValues_.at(si);
+		if (vi == unresolved)
+		{
+			const string& v = (*strings_)[si];
+			auto it = values_.find(v);
+			if (it == values_.end())
+				it = values_.insert(make_pair(v,tbl_.addValue(v))).first;
+			vi = it->second;
+		}
+		return vi;
+	}
+
+	BoundKeyValueTable&					tbl_;
+	OSMTagKeyClassifier					classifier_;
+
+	unordered_map<string,unsigned>		keys_;				// key string -> position in keyInfo_
+	vector<KeyInfo>						keyInfo_;
+	unordered_map<string,unsigned>		values_;			// value string -> value index
+
+	const vector<string>*				strings_=nullptr;
+	vector<unsigned>					blockKeys_;
+	vector<unsigned>					blockValues_;
+};
+
+constexpr unsigned PBFTagTableMapper::unresolved;
+
+
+/** Merges decoded blocks into the database builder in order, remapping all string-table references */
+
+class PBFBlockMerger {
+public:
+	PBFBlockMerger(OSMDatabaseBuilder& dbb,const OSMTagFilterProfile& filters) :
+		dbb_(dbb),
+		nodeTags_(dbb.nodeTags(),filters.node),
+		wayTags_(dbb.wayTags(),filters.way),
+		relationTags_(dbb.relationTags(),filters.relation)
+	{}
+
+	void merge(PBFBlock& blk)
+	{
+		ingestStats().addElements(Node,blk.nodes.entities.size());
+		ingestStats().addElements(Way,blk.ways.entities.size());
+		ingestStats().addElements(Relation,blk.relations.entities.size());
+
+		nodeTags_.startBlock(blk.strings);
+		wayTags_.startBlock(blk.strings);
+		relationTags_.startBlock(blk.strings);
+
+		for(unsigned i=0;i<blk.nodes.entities.size();++i)
+		{
+			dbb_.addNode(std::move(blk.nodes.entities[i]));
+			nodeTags_.addTags(blk.nodes,i);
+			dbb_.finishEntity<OSMNode>();
+		}
+
+		for(unsigned i=0;i<blk.ways.entities.size();++i)
+		{
+			dbb_.addWay(std::move(blk.ways.entities[i]));
+			dbb_.addNdRefs(OSMWay::NdRefRange(blk.ndrefs.data() + (i == 0 ? 0 : blk.ndrefEnd[i-1]),blk.ndrefs.data() + blk.ndrefEnd[i]));
+			wayTags_.addTags(blk.ways,i);
+			dbb_.finishEntity<OSMWay>();
+		}
+
+		blockRoles_.assign(blk.strings.size(),-1U);
+		for(unsigned i=0;i<blk.relations.entities.size();++i)
+		{
+			dbb_.addRelation(std::move(blk.relations.entities[i]));
+			relationTags_.addTags(blk.relations,i);
+
+			for(size_t m = i == 0 ? 0 : blk.memberEnd[i-1]; m < blk.memberEnd[i]; ++m)
+			{
+				OSMRelation::Member mem = blk.members[m];
+				mem.role = mapRole(blk.strings,mem.role);
+				dbb_.addMember(mem);
+			}
+			dbb_.finishEntity<OSMRelation>();
+		}
+	}
+
+	void addTagStats(IngestStats& stats) const
+	{
+		nodeTags_.addTagStats(stats,Node);
+		wayTags_.addTagStats(stats,Way);
+		relationTags_.addTagStats(stats,Relation);
+	}
+
+private:
+	unsigned mapRole(const vector<string>& strings,unsigned si)
+	{
+		unsigned& ri = blockRoles_.at(si);
+		if (ri == -1U)
+		{
+			auto it = roles_.find(strings[si]);
+			if (it == roles_.end())
+				it = roles_.insert(make_pair(strings[si],dbb_.relationMemberRoles().addValue(strings[si]))).first;
+			ri = it->second;
+		}
+		return ri;
+	}
+
+	OSMDatabaseBuilder&					dbb_;
+
+	PBFTagTableMapper					nodeTags_;
+	PBFTagTableMapper					wayTags_;
+	PBFTagTableMapper					relationTags_;
+
+	unordered_map<string,unsigned>		roles_;
+	vector<unsigned>					blockRoles_;
+};
+
+
+/** Decompresses and decodes a batch of OSMData blobs on nThreads threads */
+
+void decodeBatch(vector<PBFRawBlob>& raw,vector<PBFBlock>& blocks,unsigned N,unsigned nThreads)
+{
+	atomic<unsigned> next(0);
+	vector<exception_ptr> errors(N);
+
+	auto worker = [&]()
+	{
+		vector<char> data;
+		for(unsigned i; (i = next++) < N; )
+		{
+			try {
+				decompressBlob(raw[i].data,data);
+				blocks[i] = PBFBlock();
+				decodePrimitiveBlock(data,blocks[i]);
+			}
+			catch(...)
+			{
+				errors[i] = current_exception();
+			}
+		}
+	};
+
+	vector<thread> threads;
+	for(unsigned t=1; t<nThreads && t<N; ++t)
+		threads.emplace_back(worker);
+	worker();
+
+	for(auto& t : threads)
+		t.join();
+
+	for(const auto& e : errors)
+		if (e)
+			rethrow_exception(e);
+}
+
+}
+
+
+
+OSMDatabase parsePBF(const std::string fn,unsigned nThreads,const OSMTagFilterProfile& filters)
+{
+	OSMDatabaseBuilder dbb;
+	parsePBF(fn,dbb,nThreads,filters);
+	return dbb.getDatabase();
+}
+
+void parsePBF(const std::string fn,OSMDatabaseBuilder& dbb,unsigned nThreads,const OSMTagFilterProfile& filters)
+{
+	if (nThreads == 0)
+		nThreads = max(1U,thread::hardware_concurrency());
+
+	// standard input is read in large blocks; PBF blobs carry their own compression
+	ifstream fs;
+	boost::iostreams::stream<StdinSource> ss;
+
+	if (isStdin(fn))
+		ss.open(StdinSource(),inputReadSize);
+	else
+	{
+		fs.open(fn.c_str(),ios_base::in | ios_base::binary);
+		if (!fs.good())
+		{
+			cerr << "Failed to open PBF file " << fn << endl;
+			return;
+		}
+	}
+
+	istream& is = isStdin(fn) ? static_cast<istream&>(ss) : fs;
+
+	cout << "Decoding PBF " << (isStdin(fn) ? "from standard input" : "file " + fn) << " with " << nThreads << " threads" << endl;
+
+	PBFBlockMerger merger(dbb,filters);
+
+	// blobs are read and merged sequentially, decoded in parallel a batch at a time
+	const unsigned batchSize = 4*nThreads;
+	vector<PBFRawBlob> raw(batchSize);
+	vector<PBFBlock> blocks(batchSize);
+
+	unsigned long long nBlocks=0;
+
+	try {
+		bool more=true;
+		while(more)
+		{
+			unsigned N=0;
+			while(N < batchSize && (more = readBlob(is,raw[N])))
+			{
+				if (raw[N].type == "OSMHeader")
+				{
+					vector<char> data;
+					decompressBlob(raw[N].data,data);
+					decodeHeaderBlock(data,dbb);
+				}
+				else if (raw[N].type == "OSMData")
+					++N;
+				else
+					cerr << "WARNING: Skipping unknown PBF blob type '" << raw[N].type << "'" << endl;
+			}
+
+			decodeBatch(raw,blocks,N,nThreads);
+
+			for(unsigned i=0;i<N;++i)
+			{
+				merger.merge(blocks[i]);
+				blocks[i] = PBFBlock();
+			}
+			nBlocks += N;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		cerr << endl << "std::exception caught during parsing of PBF file: what='" << e.what() << "'" << endl;
+		cerr << "Error in parsing" << endl;
+	}
+
+	cout << "Decoded " << nBlocks << " PBF data blocks" << endl;
+
+	merger.addTagStats(ingestStats());
+}
@@ -0,0 +1,32 @@
+/*
+ * ParsePBF.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef PARSEPBF_HPP_
+#define PARSEPBF_HPP_
+
+#include "OSMDatabase.hpp"
+#include "OSMTagFilter.hpp"
+
+#include <string>
+
+/** Reads an OSM PBF (.osm.pbf) file, or standard input if fn is "-", directly into an OSMDatabase.
+ *
+ * Blobs are read sequentially but decompressed & decoded on nThreads worker threads (0 -> hardware concurrency). Decoded
+ * blocks are merged in file order so the resulting database (entity order, string table indices) does not depend on the
+ * number of threads. Tags are filtered as by the XML parser (see OSMTagFilter); default rules unless a profile is given.
+ */
+
+OSMDatabase parsePBF(const std::string fn,unsigned nThreads=0,
+		const OSMTagFilterProfile& filters=defaultTagFilterProfile());
+
+class OSMDatabaseBuilder;
+
+/// Parses into an existing builder (eg. one with entity retention predicates set)
+void parsePBF(const std::string fn,OSMDatabaseBuilder& dbb,unsigned nThreads=0,
+		const OSMTagFilterProfile& filters=defaultTagFilterProfile());
+
+#endif /* PARSEPBF_HPP_ */
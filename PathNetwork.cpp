@@ -10,6 +10,9 @@
 #include "OSMDatabase.hpp"
 
 #include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
+
+#include <unordered_set>
 
 using namespace std;
 
@@ -31,20 +34,55 @@ const char* OSMWayFilterRoads::includeHighwayTagValueStrings_[] = {
     nullptr
 };
 
-PathNetwork buildNetwork(const OSMDatabase& db, const OSMEntityFilter<OSMWay>& wayFilter) {
-    PathNetwork G;
+namespace {
+
+struct NodeWithRefCount {
+    PathNetwork::vertex_descriptor graphVertexDescriptor = -1U;
+    unsigned nodeVectorIndex = -1U;
+    unsigned refcount = 0;
+};
 
-    float defaultMax = 50.0f;
+typedef std::unordered_map<unsigned long long, NodeWithRefCount> NodeRefMap;
+
+/** Turns ways into path network edges (shared by buildNetwork and updateNetwork): derives the speed and one-way
+ * attributes of the way from its tags, and splits it at the nodes referenced more than once, which become vertices
+ * (added to the graph when first met unless a vertex descriptor is already set).
+ */
+
+class WayEdgeBuilder {
+public:
+    explicit WayEdgeBuilder(const OSMDatabase& db);
 
-    struct NodeWithRefCount {
-        PathNetwork::vertex_descriptor graphVertexDescriptor = -1U;
-        unsigned nodeVectorIndex = -1U;
-        unsigned refcount = 0;
+    void addWay(PathNetwork& G, const OSMWay& w, NodeRefMap& nodesByOSMID);
+
+    size_t nCurvePoints = 0;
+    unsigned nOnewayForward = 0, nOnewayBackward = 0, nOnewayReversible = 0, nBidir = 0, nUnknown = 0;
+    unsigned nWays = 0;
+
+private:
+    enum OneWayType {
+        Bidir, Forward, Backward, Reversible, Unknown
     };
 
-    std::unordered_map<unsigned long long, NodeWithRefCount> nodesByOSMID;
+    float speedForWay(const OSMWay& w);
+    OneWayType onewayForWay(const OSMWay& w);
 
-    unsigned kiHighway = db.wayTags().getIndexForKeyString("highway");
+    const OSMDatabase& db;
+
+    unsigned kiHighway = -1U;
+
+    // tag numbers for the highway strings
+    boost::container::flat_map<unsigned,float> defaultMaxSpeedByHighwayTagValue;
+
+    unsigned k_maxspeed = -1U;
+    boost::container::flat_map<unsigned,float> speedValues;
+
+    unsigned k_oneway = -1U;
+    unsigned v_oneway_yes = -1U, v_oneway_one = -1U, v_oneway_minus_one = -1U, v_oneway_reversible = -1U, v_oneway_no = -1U;
+};
+
+WayEdgeBuilder::WayEdgeBuilder(const OSMDatabase& db) : db(db) {
+    kiHighway = db.wayTags().getIndexForKeyString("highway");
 
     if (kiHighway == -1U)
     	std::cerr << "ERROR in buildNetwork(db,wf): failed to find tag key 'highway'" << std::endl;
@@ -62,7 +100,6 @@ PathNetwork buildNetwork(const OSMDatabase& db, const OSMEntityFilter<OSMWay>& w
     };
 
     // fetch tag numbers for the highway strings
-    boost::container::flat_map<unsigned,float> defaultMaxSpeedByHighwayTagValue;
     for(const auto p : defaultMaxSpeedByHighwayString)
     {
     	unsigned viString = db.wayTags().getIndexForValueString(p.first);
@@ -74,240 +111,255 @@ PathNetwork buildNetwork(const OSMDatabase& db, const OSMEntityFilter<OSMWay>& w
     	}
     }
 
+    k_maxspeed = db.wayTags().getIndexForKeyString("maxspeed");
 
+    k_oneway = db.wayTags().getIndexForKeyString("oneway");
+    v_oneway_yes = db.wayTags().getIndexForValueString("yes");
+    v_oneway_one = db.wayTags().getIndexForValueString("1");
+    v_oneway_minus_one = db.wayTags().getIndexForValueString("-1");
+    v_oneway_reversible = db.wayTags().getIndexForValueString("reversible");
+    v_oneway_no = db.wayTags().getIndexForValueString("no");
+}
 
-    // create OSM ID -> vector index mapping for all nodes
-    std::cout << "Computing index map" << std::endl;
+float WayEdgeBuilder::speedForWay(const OSMWay& w) {
+    // max speed is per way; mark as NaN by default (change NaNs to other value later)
+    float speed = std::numeric_limits<float>::quiet_NaN();
 
-    for (unsigned i = 0; i < db.nodes().size(); ++i)
-        nodesByOSMID[db.nodes()[i].id()].nodeVectorIndex = i;
+    unsigned v;
 
+    if ((v = w.getValueForKey(k_maxspeed)) != -1U) // has maxspeed tag
+    {
+        boost::container::flat_map<unsigned, float>::iterator it;
+        bool inserted;
 
+        tie(it, inserted) = speedValues.insert(make_pair(v, std::numeric_limits<float>::quiet_NaN()));
 
-    // traverse the listed ways, marking node reference counts
-    std::cout << "Computing reference counts" << std::endl;
-    for (const OSMWay& w : db.ways() | boost::adaptors::filtered(std::cref(wayFilter)))
-        for (const unsigned long long nd : w.ndrefs()) {
-            auto it = nodesByOSMID.find(nd);
-            if (it == nodesByOSMID.end())
-                std::cerr << "WARNING: Dangling reference to node " << nd << " in way " << w.id() << std::endl;
-            else
-                it->second.refcount++;
-        }
+        if (inserted) // need to map this string value to a number
+        {
+            float spd;
+            string str = db.wayTags().getValue(v).to_string();
+            stringstream ss(str);
+            ss >> spd;
+            if (ss.fail()) {
+                ss.clear();
+                cout << "truncating '" << str << "' to substring '";
+                str = str.substr(str.find_first_of(':') + 1);
+                cout << str << "'" << endl;
+                ss.str(str);
 
+                ss >> spd;
+            }
 
+            if (ss.fail())
+                std::cout << "Failed to convert value for maxspeed='" << str << "'" << endl;
+            else if (!ss.eof()) {
+                string rem;
+                ss >> rem;
+                if (rem == "kph")
+                    it->second = spd;
+                else if (rem == "mph")
+                    it->second = spd * 1.609f;
+                else {
+                    std::cout << "Warning: trailing characters in maxspeed='" << str << "'" << endl;
+                    std::cout << "  remaining: '" << rem << "'" << endl;
+                }
+            } else
+                it->second = spd;
 
-    // calculate and print reference-count (# way refs for each node) histogram for fun
-    std::vector<unsigned> refhist;
-    std::cout << "Computing reference-count frequency histogram" << std::endl;
-    for (const auto ni : nodesByOSMID | boost::adaptors::map_values) {
-        if (ni.refcount >= refhist.size())
-            refhist.resize(ni.refcount + 1, 0);
-        refhist[ni.refcount]++;
+            if (!isnan(it->second))
+                std::cout << "Added new speed '" << str << "' = " << it->second << endl;
+            else
+                std::cout << "Failed to convert speed '" << str << "'" << endl;
+        }
+        speed = it->second;
+    }
+    else	// no maxspeed -> default based on road type
+    {
+    	unsigned viHighwayValue = w.getValueForKey(kiHighway);
+    	if (viHighwayValue == -1U)
+    		std::cerr << "ERROR in buildNetwork(db,wf): missing highway tag!" << std::endl;
+    	else
+    	{
+    		const auto it = defaultMaxSpeedByHighwayTagValue.find(viHighwayValue);
+    		if (it != defaultMaxSpeedByHighwayTagValue.end())
+    			speed = it->second;
+    	}
     }
 
-    for (unsigned i = 0; i < refhist.size(); ++i)
-        if (refhist[i] > 0)
-            std::cout << "  " << std::setw(3) << i << " refs: " << refhist[i] << " nodes" << std::endl;
+    return speed;
+}
 
+WayEdgeBuilder::OneWayType WayEdgeBuilder::onewayForWay(const OSMWay& w) {
+    // assume bidirectional if not specified
 
+    OneWayType oneway = Unknown;
 
+    if (k_oneway == -1U) {
+        oneway = Bidir;
+        ++nBidir;
+    } else {
+        unsigned v_oneway = w.getValueForKey(k_oneway);
 
-    // iterate over ways, creating edges in the intersection graph with associated curvepoints)
+        if (v_oneway == -1U || v_oneway == v_oneway_no) {
+            oneway = Bidir;
+            ++nBidir;
+        } else if (v_oneway == v_oneway_one) {
+            oneway = Forward;
+            ++nOnewayForward;
+        } else if (v_oneway == v_oneway_yes) {
+            oneway = Forward;
+            ++nOnewayForward;
+        } else if (v_oneway == v_oneway_minus_one) {
+            oneway = Backward;
+            ++nOnewayBackward;
+        } else if (v_oneway == v_oneway_reversible) {
+            oneway = Reversible;
+            ++nOnewayReversible;
+        } else {
+            cout << "Unrecognized tag oneway='" << db.wayTags().getValue(v_oneway);
+            ++nUnknown;
+        }
+    }
 
-    size_t nCurvePoints = 0;
+    // hamilton_canada and newyork: k=oneway v=-1 | 1 | yes | no | yes;-1 | reversible
 
-    unsigned k_maxspeed = db.wayTags().getIndexForKeyString("maxspeed");
+    return oneway;
+}
 
-    enum OneWayType {
-        Bidir, Forward, Backward, Reversible, Unknown
-    };
+void WayEdgeBuilder::addWay(PathNetwork& G, const OSMWay& w, NodeRefMap& nodesByOSMID) {
+    ++nWays;
+    PathNetwork::vertex_descriptor segmentStartVertex = -1ULL, segmentEndVertex = -1ULL;
+    vector<FixedLatLon> curvePoints;
 
-    unsigned k_oneway = db.wayTags().getIndexForKeyString("oneway");
-    unsigned v_oneway_yes = db.wayTags().getIndexForValueString("yes");
-    unsigned v_oneway_one = db.wayTags().getIndexForValueString("1");
-    unsigned v_oneway_minus_one = db.wayTags().getIndexForValueString("-1");
-    unsigned v_oneway_reversible = db.wayTags().getIndexForValueString("reversible");
-    unsigned v_oneway_no = db.wayTags().getIndexForValueString("no");
+    const float speed = speedForWay(w);
+    const OneWayType oneway = onewayForWay(w);
 
-    unsigned nOnewayForward = 0, nOnewayBackward = 0, nOnewayReversible = 0, nBidir = 0, nUnknown = 0;
-    unsigned nWays = 0;
+    for (unsigned i = 0; i < w.ndrefs().size(); ++i) {
+        const auto currNodeIt = nodesByOSMID.find(w.ndrefs()[i]);
 
-    boost::container::flat_map<unsigned,float> speedValues;
+        FixedLatLon prevCurvePoint;
+
+        if (currNodeIt == nodesByOSMID.end()) // dangling node reference: discard
+        {
+            cout << "WARNING: Dangling node with OSM ID " << w.ndrefs()[i] << " on way with OSM ID " << w.id() << endl;
+            segmentEndVertex = -1U;
+            continue;
+        } else if (currNodeIt->second.refcount == 1) // referenced by only 1 way -> curve point
+        {
+            FixedLatLon ll = db.nodes().at(currNodeIt->second.nodeVectorIndex).fixedCoords();
+            curvePoints.push_back(ll);
+        } else if (currNodeIt->second.refcount > 1 || i == 0 || i == w.ndrefs().size() - 1)
+            // referenced by >1 way or first/last node ref in a way -> node is an intersection
+        {
+            segmentEndVertex = currNodeIt->second.graphVertexDescriptor;
 
-    for (const auto& w : db.ways() | boost::adaptors::filtered(std::cref(wayFilter))) {
-        ++nWays;
-        PathNetwork::vertex_descriptor segmentStartVertex = -1ULL, segmentEndVertex = -1ULL;
-        vector<LatLon> curvePoints;
+            // if vertex hasn't been added yet, add now
+            if (segmentEndVertex == -1U) {
+                currNodeIt->second.graphVertexDescriptor = segmentEndVertex = add_vertex(G);
+                G[segmentEndVertex].latlon = db.nodes().at(currNodeIt->second.nodeVectorIndex).fixedCoords();
+                G[segmentEndVertex].osmid = currNodeIt->first;
+            }
 
-        // max speed is per way; mark as NaN by default (change NaNs to other value later)
-        float speed = std::numeric_limits<float>::quiet_NaN();
+            // arriving at an intersection node via a way
+            if (segmentStartVertex != -1ULL) {
+                PathNetwork::edge_descriptor e;
+                bool inserted;
+                assert(segmentStartVertex < num_vertices(G));
+                assert(segmentEndVertex < num_vertices(G));
 
-        unsigned v;
 
-        if ((v = w.getValueForKey(k_maxspeed)) != -1U) // has maxspeed tag
-        {
-            boost::container::flat_map<unsigned, float>::iterator it;
-            bool inserted;
+                std::tie(e, inserted) = add_edge(segmentStartVertex, segmentEndVertex, G);
 
-            tie(it, inserted) = speedValues.insert(make_pair(v, std::numeric_limits<float>::quiet_NaN()));
+                assert(inserted && "Duplicate edge");
+                G[e].wayOSMID = w.id();
 
-            if (inserted) // need to map this string value to a number
-            {
-                float spd;
-                string str = db.wayTags().getValue(v);
-                stringstream ss(str);
-                ss >> spd;
-                if (ss.fail()) {
-                    ss.clear();
-                    cout << "truncating '" << str << "' to substring '";
-                    str = str.substr(str.find_first_of(':') + 1);
-                    cout << str << "'" << endl;
-                    ss.str(str);
-
-                    ss >> spd;
-                }
+                if (oneway == Forward || oneway == Backward) {
+                    // goes towards end vertex; if greater then goes towards greater
+                    // flip it
+                    bool towardsGreater = (segmentEndVertex > segmentStartVertex) ^ (oneway == Backward);
+
+                    G[e].oneWay = towardsGreater ?
+                            EdgeProperties::ToGreaterVertexNumber :
+                            EdgeProperties::ToLesserVertexNumber;
 
-                if (ss.fail())
-                    std::cout << "Failed to convert value for maxspeed='" << str << "'" << endl;
-                else if (!ss.eof()) {
-                    string rem;
-                    ss >> rem;
-                    if (rem == "kph")
-                        it->second = spd;
-                    else if (rem == "mph")
-                        it->second = spd * 1.609f;
-                    else {
-                        std::cout << "Warning: trailing characters in maxspeed='" << str << "'" << endl;
-                        std::cout << "  remaining: '" << rem << "'" << endl;
-                    }
                 } else
-                    it->second = spd;
+                    G[e].oneWay = EdgeProperties::Bidir;
 
-                if (!isnan(it->second))
-                    std::cout << "Added new speed '" << str << "' = " << it->second << endl;
-                else
-                    std::cout << "Failed to convert speed '" << str << "'" << endl;
+                G[e].maxspeed = speed;
+
+                nCurvePoints += curvePoints.size();
+
+                G[e].curvePoints = std::move(curvePoints);
             }
-            speed = it->second;
-        }
-        else	// no maxspeed -> default based on road type
-        {
-        	unsigned viHighwayValue = w.getValueForKey(kiHighway);
-        	if (viHighwayValue == -1U)
-        		std::cerr << "ERROR in buildNetwork(db,wf): missing highway tag!" << std::endl;
-        	else
-        	{
-        		const auto it = defaultMaxSpeedByHighwayTagValue.find(viHighwayValue);
-        		if (it != defaultMaxSpeedByHighwayTagValue.end())
-        			speed = it->second;
-        	}
+
+            segmentStartVertex = segmentEndVertex;
         }
 
-        // assume bidirectional if not specified
+        prevCurvePoint = db.nodes().at(currNodeIt->second.nodeVectorIndex).fixedCoords();
+    }
+}
 
-        OneWayType oneway = Unknown;
+const float defaultMax = 50.0f;
 
-        if (k_oneway == -1U) {
-            oneway = Bidir;
-            ++nBidir;
-        } else {
-            unsigned v_oneway = w.getValueForKey(k_oneway);
-
-            if (v_oneway == -1U || v_oneway == v_oneway_no) {
-                oneway = Bidir;
-                ++nBidir;
-            } else if (v_oneway == v_oneway_one) {
-                oneway = Forward;
-                ++nOnewayForward;
-            } else if (v_oneway == v_oneway_yes) {
-                oneway = Forward;
-                ++nOnewayForward;
-            } else if (v_oneway == v_oneway_minus_one) {
-                oneway = Backward;
-                ++nOnewayBackward;
-            } else if (v_oneway == v_oneway_reversible) {
-                oneway = Reversible;
-                ++nOnewayReversible;
-            } else {
-                cout << "Unrecognized tag oneway='" << db.wayTags().getValue(v_oneway);
-                ++nUnknown;
-            }
-        }
+}
 
+PathNetwork buildNetwork(const OSMDatabase& db, const OSMEntityFilter<OSMWay>& wayFilter) {
+    PathNetwork G;
 
-        // hamilton_canada and newyork: k=oneway v=-1 | 1 | yes | no | yes;-1 | reversible
+    NodeRefMap nodesByOSMID;
 
+    WayEdgeBuilder wayEdges(db);
 
-        for (unsigned i = 0; i < w.ndrefs().size(); ++i) {
-            const auto currNodeIt = nodesByOSMID.find(w.ndrefs()[i]);
 
-            LatLon prevCurvePoint;
 
-            if (currNodeIt == nodesByOSMID.end()) // dangling node reference: discard
-            {
-                cout << "WARNING: Dangling node with OSM ID " << w.ndrefs()[i] << " on way with OSM ID " << w.id() << endl;
-                segmentEndVertex = -1U;
-                continue;
-            } else if (currNodeIt->second.refcount == 1) // referenced by only 1 way -> curve point
-            {
-                LatLon ll = db.nodes().at(currNodeIt->second.nodeVectorIndex).coords();
-                curvePoints.push_back(ll);
-            } else if (currNodeIt->second.refcount > 1 || i == 0 || i == w.ndrefs().size() - 1)
-                // referenced by >1 way or first/last node ref in a way -> node is an intersection
-            {
-                segmentEndVertex = currNodeIt->second.graphVertexDescriptor;
-
-                // if vertex hasn't been added yet, add now
-                if (segmentEndVertex == -1U) {
-                    currNodeIt->second.graphVertexDescriptor = segmentEndVertex = add_vertex(G);
-                    G[segmentEndVertex].latlon = db.nodes().at(currNodeIt->second.nodeVectorIndex).coords();
-                    G[segmentEndVertex].osmid = currNodeIt->first;
-                }
+    // create OSM ID -> vector index mapping for all nodes
+    std::cout << "Computing index map" << std::endl;
 
-                // arriving at an intersection node via a way
-                if (segmentStartVertex != -1ULL) {
-                    PathNetwork::edge_descriptor e;
-                    bool inserted;
-                    assert(segmentStartVertex < num_vertices(G));
-                    assert(segmentEndVertex < num_vertices(G));
+    for (unsigned i = 0; i < db.nodes().size(); ++i)
+        nodesByOSMID[db.nodes()[i].id()].nodeVectorIndex = i;
 
 
-                    std::tie(e, inserted) = add_edge(segmentStartVertex, segmentEndVertex, G);
 
-                    assert(inserted && "Duplicate edge");
-                    G[e].wayOSMID = w.id();
+    // traverse the listed ways, marking node reference counts
+    std::cout << "Computing reference counts" << std::endl;
+    for (const OSMWay& w : db.ways() | boost::adaptors::filtered(std::cref(wayFilter)))
+        for (const unsigned long long nd : w.ndrefs()) {
+            auto it = nodesByOSMID.find(nd);
+            if (it == nodesByOSMID.end())
+                std::cerr << "WARNING: Dangling reference to node " << nd << " in way " << w.id() << std::endl;
+            else
+                it->second.refcount++;
+        }
 
-                    if (oneway == Forward || oneway == Backward) {
-                        // goes towards end vertex; if greater then goes towards greater
-                        // flip it
-                        bool towardsGreater = (segmentEndVertex > segmentStartVertex) ^ (oneway == Backward);
 
-                        G[e].oneWay = towardsGreater ?
-                                EdgeProperties::ToGreaterVertexNumber :
-                                EdgeProperties::ToLesserVertexNumber;
 
-                    } else
-                        G[e].oneWay = EdgeProperties::Bidir;
+    // calculate and print reference-count (# way refs for each node) histogram for fun
+    std::vector<unsigned> refhist;
+    std::cout << "Computing reference-count frequency histogram" << std::endl;
+    for (const auto ni : nodesByOSMID | boost::adaptors::map_values) {
+        if (ni.refcount >= refhist.size())
+            refhist.resize(ni.refcount + 1, 0);
+        refhist[ni.refcount]++;
+    }
 
-                    G[e].maxspeed = speed;
+    for (unsigned i = 0; i < refhist.size(); ++i)
+        if (refhist[i] > 0)
+            std::cout << "  " << std::setw(3) << i << " refs: " << refhist[i] << " nodes" << std::endl;
 
-                    nCurvePoints += curvePoints.size();
 
-                    G[e].curvePoints = std::move(curvePoints);
-                }
 
-                segmentStartVertex = segmentEndVertex;
-            }
 
-            prevCurvePoint = db.nodes().at(currNodeIt->second.nodeVectorIndex).coords();
-        }
-    }
+    // iterate over ways, creating edges in the intersection graph with associated curvepoints)
+
+    for (const auto& w : db.ways() | boost::adaptors::filtered(std::cref(wayFilter)))
+        wayEdges.addWay(G, w, nodesByOSMID);
 
-    std::cout << "PathNetwork created with " << num_vertices(G) << " vertices and " << num_edges(G) << " edges, with " << nCurvePoints << " curve points" << std::endl;
+    const unsigned nWays = wayEdges.nWays;
+
+    std::cout << "PathNetwork created with " << num_vertices(G) << " vertices and " << num_edges(G) << " edges, with " << wayEdges.nCurvePoints << " curve points" << std::endl;
     std::cout << "  Used " << nWays << "/" << db.ways().size() << " ways" << endl;
-    std::cout << "  One-way streets: " << (nOnewayForward + nOnewayBackward) << "/" << nWays << " (" << nOnewayReversible << " reversible and " << nUnknown << " unknown)" << std::endl;
-    assert(nOnewayForward + nOnewayBackward + nOnewayReversible + nBidir + nUnknown == nWays);
+    std::cout << "  One-way streets: " << (wayEdges.nOnewayForward + wayEdges.nOnewayBackward) << "/" << nWays << " (" << wayEdges.nOnewayReversible << " reversible and " << wayEdges.nUnknown << " unknown)" << std::endl;
+    assert(wayEdges.nOnewayForward + wayEdges.nOnewayBackward + wayEdges.nOnewayReversible + wayEdges.nBidir + wayEdges.nUnknown == nWays);
 
     // create/print edge-degree histogram
     std::cout << "Vertex degree histogram:" << std::endl;
@@ -356,6 +408,22 @@ public:
         return std::move(m_streets);
     }
 
+    /** Assigns streets to the unassigned edges among seeds (and everything they reach) on top of an existing street
+     * vector, using the indices in freeIndices before appending; the unused free indices are left in freeIndices
+     */
+    void reassign(std::vector<std::string>& streets, const std::vector<PathNetwork::edge_descriptor>& seeds,
+            std::vector<unsigned>& freeIndices) {
+        m_streets = std::move(streets);
+        m_freeStreetIndices = std::move(freeIndices);
+
+        for (const auto e : seeds)
+            if ((*m_G)[e].streetVectorIndex == 0)
+                startWithEdge(e);
+
+        streets = std::move(m_streets);
+        freeIndices = std::move(m_freeStreetIndices);
+    }
+
     // pick up the street name from the specified edge, add it to the vertex, and expand the source/target vertices
     void startWithEdge(PathNetwork::edge_descriptor e);
 
@@ -380,7 +448,7 @@ private:
         if (valTag == -1U)
             return std::string();
         else
-            return m_osmDatabase->wayTags().getValue(valTag);
+            return m_osmDatabase->wayTags().getValue(valTag).to_string();
     }
 
     static const std::string np;
@@ -393,6 +461,7 @@ private:
     unsigned m_keyIndexName = -1U, m_keyIndexNameEn = -1U; // cached values for key-value tables
 
     std::vector<std::string> m_streets; // street name vector being built
+    std::vector<unsigned> m_freeStreetIndices; // unused indices in m_streets, to be filled before appending
     unsigned m_currStreetVectorIndex = 0; // index of current street
 };
 
@@ -406,8 +475,14 @@ void StreetEdgeVisitor::startWithEdge(PathNetwork::edge_descriptor e) {
 
     if (!streetName.empty()) {
         // insert the street name
-        (*m_G)[e].streetVectorIndex = m_currStreetVectorIndex = m_streets.size();
-        m_streets.push_back(streetName);
+        if (m_freeStreetIndices.empty()) {
+            (*m_G)[e].streetVectorIndex = m_currStreetVectorIndex = m_streets.size();
+            m_streets.push_back(streetName);
+        } else {
+            (*m_G)[e].streetVectorIndex = m_currStreetVectorIndex = m_freeStreetIndices.back();
+            m_freeStreetIndices.pop_back();
+            m_streets[m_currStreetVectorIndex] = streetName;
+        }
 
         // expand the vertices at both ends
         expandVertex(source(e, *m_G), wID);
@@ -429,7 +504,7 @@ void StreetEdgeVisitor::expandVertex(PathNetwork::vertex_descriptor v, OSMID cur
 
         if (wID == currWayID) // (connected,same way -> same name) -> same street
             (*m_G)[e].streetVectorIndex = m_currStreetVectorIndex;
-        else if (streetNameForWay(wID) == m_streets.back()) // (connected,same name) -> same street
+        else if (streetNameForWay(wID) == m_streets[m_currStreetVectorIndex]) // (connected,same name) -> same street
             (*m_G)[e].streetVectorIndex = m_currStreetVectorIndex;
         else // different way, different name -> done expanding
             continue;
@@ -449,3 +524,338 @@ std::vector<std::string> assignStreets(OSMDatabase* db, PathNetwork& G) {
 
     return sev.assign();
 }
+
+RoadNodeIndex::RoadNodeIndex(const OSMDatabase& db, const OSMEntityFilter<OSMWay>& wayFilter) {
+    std::vector<unsigned long long> refs;
+    for (const OSMWay& w : db.ways() | boost::adaptors::filtered(std::cref(wayFilter))) {
+        add(w, refs);
+        refs.clear();
+    }
+}
+
+unsigned RoadNodeIndex::refcount(unsigned long long nd) const {
+    const auto it = waysByNode_.find(nd);
+    return it == waysByNode_.end() ? 0 : it->second.size();
+}
+
+const std::vector<unsigned long long>& RoadNodeIndex::waysThrough(unsigned long long nd) const {
+    static const std::vector<unsigned long long> none;
+    const auto it = waysByNode_.find(nd);
+    return it == waysByNode_.end() ? none : it->second;
+}
+
+void RoadNodeIndex::add(const OSMWay& w, std::vector<unsigned long long>& refs) {
+    std::vector<unsigned long long>& ndrefs = ndrefsByWay_[w.id()];
+    ndrefs.assign(w.ndrefs().begin(), w.ndrefs().end());
+
+    for (const unsigned long long nd : ndrefs)
+        waysByNode_[nd].push_back(w.id());
+    refs.insert(refs.end(), ndrefs.begin(), ndrefs.end());
+}
+
+void RoadNodeIndex::remove(unsigned long long wayID, std::vector<unsigned long long>& refs) {
+    const auto it = ndrefsByWay_.find(wayID);
+    if (it == ndrefsByWay_.end())
+        return;
+
+    for (const unsigned long long nd : it->second) {
+        const auto n = waysByNode_.find(nd);
+        assert(n != waysByNode_.end());
+
+        std::vector<unsigned long long>& ways = n->second;
+        ways.erase(boost::find(ways, wayID)); // one entry per reference
+        if (ways.empty())
+            waysByNode_.erase(n);
+    }
+
+    refs.insert(refs.end(), it->second.begin(), it->second.end());
+    ndrefsByWay_.erase(it);
+}
+
+std::vector<unsigned long long> RoadNodeIndex::update(const OSMDatabase& db, const OSMEntityFilter<OSMWay>& wayFilter,
+        const std::vector<unsigned long long>& changedWays) {
+    std::vector<unsigned long long> refs;
+
+    for (const unsigned long long id : changedWays) {
+        remove(id, refs);
+        if (const OSMWay* w = db.wayPtrFromID(id))
+            if (wayFilter(*w))
+                add(*w, refs);
+    }
+    return refs;
+}
+
+namespace {
+
+/** Patches the network given an up-to-date road node index and the nodes whose reference counts may have changed */
+
+void patchNetwork(PathNetwork& G, std::vector<std::string>& streets, OSMDatabase* db,
+        const OSMEntityFilter<OSMWay>& wayFilter, const RoadNodeIndex& roadNodes,
+        const std::vector<unsigned long long>& changedWays, const std::vector<unsigned long long>& changedNodes,
+        const std::vector<unsigned long long>& candidates) {
+    const std::unordered_set<unsigned long long> changedWaySet(changedWays.begin(), changedWays.end());
+
+    // current vertex for each intersection node
+    std::unordered_map<unsigned long long, PathNetwork::vertex_descriptor> vertexByOSMID;
+    vertexByOSMID.reserve(num_vertices(G));
+    for (const auto v : boost::make_iterator_range(vertices(G)))
+        vertexByOSMID.insert(std::make_pair(G[v].osmid, v));
+
+    // reference counts of the nodes which may become or stop being an intersection
+    std::unordered_map<unsigned long long, unsigned> refcount(candidates.size());
+
+    for (const unsigned long long nd : candidates)
+        refcount[nd] = roadNodes.refcount(nd);
+
+
+
+    // nodes which gained/lost their vertex or moved
+    std::unordered_set<unsigned long long> affectedNodes(changedNodes.begin(), changedNodes.end());
+
+    std::vector<PathNetwork::vertex_descriptor> removedVertices;
+    std::vector<unsigned long long> addedVertexNodes;
+
+    for (const auto& p : refcount) {
+        const unsigned ni = db->nodeIndexFromID(p.first);
+        const auto vIt = vertexByOSMID.find(p.first);
+
+        const bool wasVertex = vIt != vertexByOSMID.end();
+        const bool isVertex = ni != -1U && p.second > 1;
+
+        if (wasVertex && !isVertex)
+            removedVertices.push_back(vIt->second);
+        else if (isVertex && !wasVertex)
+            addedVertexNodes.push_back(p.first);
+        else if (isVertex && affectedNodes.count(p.first))
+            G[vIt->second].latlon = db->nodes()[ni].fixedCoords();
+
+        if (wasVertex != isVertex)
+            affectedNodes.insert(p.first);
+    }
+
+    // ways to re-split: the changed ways, and those through an affected node (in database order, as buildNetwork)
+    std::unordered_set<unsigned long long> rebuildWaySet(changedWaySet);
+
+    for (const unsigned long long nd : affectedNodes)
+        for (const unsigned long long id : roadNodes.waysThrough(nd))
+            rebuildWaySet.insert(id);
+
+    std::vector<unsigned> rebuildWayIndices;
+    for (const unsigned long long id : rebuildWaySet) {
+        const unsigned wi = db->wayIndexFromID(id);
+        if (wi != -1U && wayFilter(db->ways()[wi]))
+            rebuildWayIndices.push_back(wi);
+    }
+    boost::sort(rebuildWayIndices);
+
+    std::vector<const OSMWay*> rebuildWays;
+    for (const unsigned wi : rebuildWayIndices)
+        rebuildWays.push_back(&db->ways()[wi]);
+
+    boost::sort(removedVertices);
+    boost::sort(addedVertexNodes);
+
+
+
+    // renumber vertices: new intersections fill the slots of removed ones, then remaining slots are filled from the end,
+    // so unaffected intersections keep their numbers wherever possible
+    const unsigned nOld = num_vertices(G);
+    std::vector<PathNetwork::vertex_descriptor> newIndex(nOld);
+    for (unsigned i = 0; i < nOld; ++i)
+        newIndex[i] = i;
+
+    for (const auto v : removedVertices)
+        newIndex[v] = -1U;
+
+    std::vector<PathNetwork::vertex_descriptor> freeSlots(removedVertices.rbegin(), removedVertices.rend());
+    std::vector<std::pair<unsigned long long, PathNetwork::vertex_descriptor>> addedVertices;
+
+    unsigned nNew = nOld;
+    for (const unsigned long long id : addedVertexNodes) {
+        if (freeSlots.empty())
+            addedVertices.push_back(std::make_pair(id, nNew++));
+        else {
+            addedVertices.push_back(std::make_pair(id, freeSlots.back()));
+            freeSlots.pop_back();
+        }
+    }
+
+    // vertices beyond the new end move down into the remaining slots
+    nNew = nOld - removedVertices.size() + addedVertexNodes.size();
+
+    for (unsigned i = nNew, j = freeSlots.size(); i < nOld; ++i)
+        if (newIndex[i] != -1U) {
+            while (freeSlots[j - 1] >= nNew)
+                --j;
+            newIndex[i] = freeSlots[--j];
+        }
+
+
+
+    // copy the surviving part of the graph across under the new numbering
+    PathNetwork G2(nNew);
+
+    for (unsigned i = 0; i < nOld; ++i)
+        if (newIndex[i] != -1U)
+            G2[newIndex[i]] = G[i];
+
+    for (const auto& p : addedVertices) {
+        G2[p.second].osmid = p.first;
+        G2[p.second].latlon = db->nodeFromID(p.first).fixedCoords();
+    }
+
+    boost::container::flat_set<unsigned> dirtyStreets;
+
+    unsigned nRemovedEdges = 0;
+    for (const auto e : boost::make_iterator_range(edges(G))) {
+        if (rebuildWaySet.count(G[e].wayOSMID)) {
+            if (G[e].streetVectorIndex < streets.size())
+                dirtyStreets.insert(G[e].streetVectorIndex);
+            ++nRemovedEdges;
+            continue;
+        }
+
+        const PathNetwork::vertex_descriptor s = source(e, G), t = target(e, G);
+        assert(newIndex[s] != -1U && newIndex[t] != -1U);
+
+        EdgeProperties p = std::move(G[e]);
+
+        // one-way direction is stored relative to the vertex numbers
+        if (p.oneWay != EdgeProperties::Bidir && s != t) {
+            const bool towardsT = (p.oneWay == EdgeProperties::ToGreaterVertexNumber) == (t > s);
+            p.oneWay = (newIndex[t] > newIndex[s]) == towardsT ?
+                    EdgeProperties::ToGreaterVertexNumber :
+                    EdgeProperties::ToLesserVertexNumber;
+        }
+
+        add_edge(newIndex[s], newIndex[t], std::move(p), G2);
+    }
+
+    const unsigned nKeptEdges = num_edges(G2);
+
+
+
+    // re-split the affected ways; every vertex they can meet already exists
+    NodeRefMap nodesByOSMID;
+
+    for (const OSMWay* w : rebuildWays)
+        for (const unsigned long long nd : w->ndrefs()) {
+            const unsigned ni = db->nodeIndexFromID(nd);
+            if (ni == -1U || nodesByOSMID.count(nd))
+                continue;
+
+            NodeWithRefCount& info = nodesByOSMID[nd];
+            info.nodeVectorIndex = ni;
+            info.refcount = roadNodes.refcount(nd);
+
+            const auto v = vertexByOSMID.find(nd);
+            if (info.refcount > 1 && v != vertexByOSMID.end())
+                info.graphVertexDescriptor = newIndex[v->second];
+        }
+
+    for (const auto& p : addedVertices) {
+        const auto it = nodesByOSMID.find(p.first);
+        assert(it != nodesByOSMID.end());
+        it->second.graphVertexDescriptor = p.second;
+    }
+
+    WayEdgeBuilder wayEdges(*db);
+    for (const OSMWay* w : rebuildWays)
+        wayEdges.addWay(G2, *w, nodesByOSMID);
+
+    assert(num_vertices(G2) == nNew);
+
+    // streets: new edges, and all edges of the streets which lost edges or meet a new edge, are assigned afresh
+    {
+        unsigned i = 0;
+        for (const auto e : boost::make_iterator_range(edges(G2)))
+            if (i++ >= nKeptEdges) {
+                if (isnan(G2[e].maxspeed))
+                    G2[e].maxspeed = defaultMax;
+
+                G2[e].streetVectorIndex = 0;
+                for (const auto v : { source(e, G2), target(e, G2) })
+                    for (const auto f : boost::make_iterator_range(out_edges(v, G2)))
+                        if (G2[f].streetVectorIndex < streets.size())
+                            dirtyStreets.insert(G2[f].streetVectorIndex);
+            }
+    }
+
+    dirtyStreets.erase(0U);
+
+    std::vector<PathNetwork::edge_descriptor> seeds;
+
+    for (const auto e : boost::make_iterator_range(edges(G2))) {
+        unsigned& si = G2[e].streetVectorIndex;
+        if (dirtyStreets.count(si))
+            si = 0;
+        if (si == 0)
+            seeds.push_back(e);
+    }
+
+    std::vector<unsigned> freeStreets(dirtyStreets.rbegin(), dirtyStreets.rend());
+
+    StreetEdgeVisitor sev(&G2);
+    sev.osmDatabase(db);
+    sev.reassign(streets, seeds, freeStreets);
+
+    // close the gaps left by streets which disappeared, moving the last streets down
+    if (!freeStreets.empty()) {
+        boost::sort(freeStreets);
+        const unsigned nStreets = streets.size() - freeStreets.size();
+
+        std::vector<unsigned> streetIndex(streets.size());
+        for (unsigned i = 0; i < streets.size(); ++i)
+            streetIndex[i] = i;
+
+        std::vector<bool> isFree(streets.size());
+        for (const unsigned i : freeStreets)
+            isFree[i] = true;
+
+        for (unsigned i = nStreets, j = 0; i < streets.size(); ++i)
+            if (!isFree[i]) {
+                streetIndex[i] = freeStreets[j++];
+                streets[streetIndex[i]] = std::move(streets[i]);
+            }
+        streets.resize(nStreets);
+
+        for (const auto e : boost::make_iterator_range(edges(G2)))
+            G2[e].streetVectorIndex = streetIndex[G2[e].streetVectorIndex];
+    }
+
+    std::cout << "PathNetwork updated: " << removedVertices.size() << " intersections removed, " << addedVertexNodes.size() <<
+            " added; " << rebuildWays.size() << " ways re-split, replacing " << nRemovedEdges << " edges with " <<
+            (num_edges(G2) - nKeptEdges) << "; " << dirtyStreets.size() << " streets re-assigned (now " << streets.size() <<
+            ")" << std::endl;
+
+    G = std::move(G2);
+}
+}
+
+void updateNetwork(PathNetwork& G, std::vector<std::string>& streets, OSMDatabase* db,
+        const OSMEntityFilter<OSMWay>& wayFilter, RoadNodeIndex& roadNodes,
+        const std::vector<unsigned long long>& changedWays, const std::vector<unsigned long long>& changedNodes) {
+    std::vector<unsigned long long> candidates = roadNodes.update(*db, wayFilter, changedWays);
+    candidates.insert(candidates.end(), changedNodes.begin(), changedNodes.end());
+
+    patchNetwork(G, streets, db, wayFilter, roadNodes, changedWays, changedNodes, candidates);
+}
+
+void updateNetwork(PathNetwork& G, std::vector<std::string>& streets, OSMDatabase* db,
+        const OSMEntityFilter<OSMWay>& wayFilter,
+        const std::vector<unsigned long long>& changedWays, const std::vector<unsigned long long>& changedNodes) {
+    const RoadNodeIndex roadNodes(*db, wayFilter);
+
+    // old versions of the changed ways are unknown: re-count every current intersection as well as their new nodes
+    std::vector<unsigned long long> candidates(changedNodes);
+    candidates.reserve(candidates.size() + num_vertices(G));
+    for (const auto v : boost::make_iterator_range(vertices(G)))
+        candidates.push_back(G[v].osmid);
+
+    for (const unsigned long long id : changedWays)
+        if (const OSMWay* w = db->wayPtrFromID(id))
+            if (wayFilter(*w))
+                candidates.insert(candidates.end(), w->ndrefs().begin(), w->ndrefs().end());
+
+    patchNetwork(G, streets, db, wayFilter, roadNodes, changedWays, changedNodes, candidates);
+}
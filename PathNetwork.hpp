@@ -28,6 +28,7 @@
 
 
 #include <boost/graph/adjacency_list.hpp>
+#include <boost/serialization/version.hpp>
 
 #include "OSMEntity.hpp"
 #include "OSMNode.hpp"
@@ -43,7 +44,7 @@
 class OSMWayFilterRoads : public OSMEntityFilter<OSMWay> {
 public:
 
-    OSMWayFilterRoads(const OSMDatabase& db, const std::vector<OSMNode>& nodes) :
+    OSMWayFilterRoads(const OSMDatabase& db, const OSMNodeTable& nodes) :
     OSMEntityFilter<OSMWay>(db),
     kvt_(db.wayTags()),
     kiName_(db.wayTags().getIndexForKeyString("name")),
@@ -70,18 +71,27 @@ private:
 
 struct NodeInfo {
     OSMID osmid = -1ULL;
-    LatLon latlon;
+    FixedLatLon latlon;
 
 private:
     friend boost::serialization::access;
 
+    // version 0 archives hold float LatLon coordinates
     template<class Archive>void serialize(Archive& ar, const unsigned ver) {
-        ar & osmid & latlon;
+        ar & osmid;
+        if (ver == 0) {
+            LatLon ll;
+            ar & ll;
+            latlon = FixedLatLon(ll);
+        } else
+            ar & latlon;
     }
 };
 
+BOOST_CLASS_VERSION(NodeInfo, 1)
+
 struct EdgeProperties {
-    std::vector<LatLon> curvePoints;
+    std::vector<FixedLatLon> curvePoints;
     unsigned long long wayOSMID = -1U;
 
     unsigned streetVectorIndex = -1U;
@@ -97,11 +107,22 @@ struct EdgeProperties {
 private:
     friend boost::serialization::access;
 
+    // version 0 archives hold float LatLon curve points
     template<class Archive>void serialize(Archive& ar, const unsigned ver) {
-        ar & curvePoints & wayOSMID & streetVectorIndex & maxspeed & oneWay;
+        if (ver == 0) {
+            std::vector<LatLon> pts;
+            ar & pts;
+            curvePoints.clear();
+            for (const LatLon ll : pts)
+                curvePoints.push_back(FixedLatLon(ll));
+        } else
+            ar & curvePoints;
+        ar & wayOSMID & streetVectorIndex & maxspeed & oneWay;
     }
 };
 
+BOOST_CLASS_VERSION(EdgeProperties, 1)
+
 typedef boost::adjacency_list<
 boost::vecS, // outedgelist
 boost::vecS, // vertex list
@@ -136,4 +157,68 @@ std::vector<std::string> assignStreets(OSMDatabase* db, PathNetwork& G);
 
 void nameIntersections(PathNetwork& G);
 
+/** Reverse index from node IDs to the road ways (those passing the network's way filter) through them, kept alongside a
+ * network so that updateNetwork finds the reference counts and the ways to re-split without scanning every way.
+ *
+ * Building costs one pass over the road ways; it holds a copy of their node refs so that the entries of a way can be
+ * removed when it changes.
+ */
+
+class RoadNodeIndex {
+public:
+
+    RoadNodeIndex() {
+    }
+
+    RoadNodeIndex(const OSMDatabase& db, const OSMEntityFilter<OSMWay>& wayFilter);
+
+    /// Number of references to the node from road ways, counting a node repeated within a way each time (as buildNetwork)
+    unsigned refcount(unsigned long long nd) const;
+
+    /// IDs of the road ways through the node, once per reference
+    const std::vector<unsigned long long>& waysThrough(unsigned long long nd) const;
+
+    /** Re-indexes the given ways as they now are in db (removed if deleted or no longer roads), returning the node refs of
+     * their previous and current versions: the nodes whose reference counts may have changed
+     */
+    std::vector<unsigned long long> update(const OSMDatabase& db, const OSMEntityFilter<OSMWay>& wayFilter,
+            const std::vector<unsigned long long>& changedWays);
+
+private:
+    void add(const OSMWay& w, std::vector<unsigned long long>& refs);
+    void remove(unsigned long long wayID, std::vector<unsigned long long>& refs);
+
+    std::unordered_map<unsigned long long, std::vector<unsigned long long>> waysByNode_;
+    std::unordered_map<unsigned long long, std::vector<unsigned long long>> ndrefsByWay_;
+};
+
+/** Patches a network built by buildNetwork (with streets from assignStreets) after the database has changed, given the
+ * IDs of the ways & nodes created, modified or deleted (eg. from an OSMChange applied with OSMDatabase::applyChange).
+ *
+ * roadNodes must describe the road ways as they were when the network was built or last patched; it is updated to the
+ * current database. Reference counts are then looked up only for the nodes of the changed ways (old and new versions)
+ * and the changed nodes, and the ways to re-split are those changed plus those through a node which becomes or stops
+ * being an intersection (or moved), found through the index. Only the streets touching the replaced edges are
+ * re-assigned.
+ *
+ * Cost: O(refs of the changed & re-split ways + streets re-assigned) for the OSM side, plus O(V+E) to renumber the
+ * graph: every vertex & edge is copied into a new graph, since vecS storage cannot remove vertices in place. That copy
+ * touches no OSM data and is much cheaper than buildNetwork, but it is not proportional to the size of the change.
+ *
+ * The result matches a full rebuild up to the numbering of vertices, edges and streets. Unaffected intersections keep
+ * their vertex numbers where possible: new ones fill the slots of removed ones, and the highest-numbered vertices move
+ * down into any slots left over. Street indices are compacted the same way.
+ */
+void updateNetwork(PathNetwork& G, std::vector<std::string>& streets, OSMDatabase* db,
+        const OSMEntityFilter<OSMWay>& wayFilter, RoadNodeIndex& roadNodes,
+        const std::vector<unsigned long long>& changedWays, const std::vector<unsigned long long>& changedNodes);
+
+/** As above for a caller without a RoadNodeIndex. The index is built from the current database, so this costs a pass
+ * over every road way (O(all road node refs)) per call; the old versions of the changed ways are unknown, so every
+ * current intersection is re-counted as well.
+ */
+void updateNetwork(PathNetwork& G, std::vector<std::string>& streets, OSMDatabase* db,
+        const OSMEntityFilter<OSMWay>& wayFilter,
+        const std::vector<unsigned long long>& changedWays, const std::vector<unsigned long long>& changedNodes);
+
 #endif /* PATHNETWORK_HPP_ */
@@ -0,0 +1,130 @@
+/*
+ * ProtobufReader.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef PROTOBUFREADER_HPP_
+#define PROTOBUFREADER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+/** Minimal forward-only reader for the protocol buffer wire format, sufficient to walk the OSM PBF messages
+ * without generated code. Does not allocate; length-delimited fields are returned as ranges into the source buffer.
+ *
+ * Usage:
+ * 		ProtobufReader r(begin,end);
+ * 		while(r.next())
+ * 			switch(r.field())
+ * 			{
+ * 				case 1: x = r.varint(); break;
+ * 				default: r.skip();
+ * 			}
+ *
+ * Throws std::runtime_error if the message is truncated or malformed.
+ */
+
+class ProtobufReader
+{
+public:
+	enum WireType { Varint=0, Fixed64=1, LengthDelimited=2, Fixed32=5 };
+
+	ProtobufReader(){}
+	ProtobufReader(const char* begin,const char* end) : p_(begin),end_(end){}
+	explicit ProtobufReader(std::pair<const char*,const char*> r) : p_(r.first),end_(r.second){}
+
+	/// Advances to the next field key, returning false at end of message
+	bool next()
+	{
+		if (p_ == end_)
+			return false;
+		std::uint64_t key = readVarint_();
+		field_ = key >> 3;
+		wireType_ = WireType(key & 0x7);
+		return true;
+	}
+
+	unsigned field() 		const { return field_; 		}
+	WireType wireType() 	const { return wireType_; 	}
+
+	std::uint64_t 	varint()		{ return readVarint_(); 			}
+	std::int64_t	svarint()		{ return zigzag(readVarint_()); 	}
+
+	/// Returns the range of a length-delimited field (string, bytes, sub-message, packed repeated)
+	std::pair<const char*,const char*> bytes()
+	{
+		std::uint64_t N = readVarint_();
+		if (N > std::uint64_t(end_-p_))
+			throw std::runtime_error("ProtobufReader: length-delimited field runs past end of message");
+		const char* b=p_;
+		p_ += N;
+		return std::make_pair(b,p_);
+	}
+
+	/// Skips the value of the current field
+	void skip()
+	{
+		switch(wireType_)
+		{
+		case Varint:			readVarint_(); break;
+		case Fixed64:			advance_(8); break;
+		case LengthDelimited:	bytes(); break;
+		case Fixed32:			advance_(4); break;
+		default:
+			throw std::runtime_error("ProtobufReader: unsupported wire type");
+		}
+	}
+
+	/// Calls f(v) for each varint in a packed repeated field
+	template<class UnaryFunction>void packedVarints(UnaryFunction f)
+	{
+		ProtobufReader r(bytes());
+		while(r.p_ != r.end_)
+			f(r.readVarint_());
+	}
+
+	/// Calls f(v) for each zigzag-encoded varint in a packed repeated field
+	template<class UnaryFunction>void packedSVarints(UnaryFunction f)
+	{
+		ProtobufReader r(bytes());
+		while(r.p_ != r.end_)
+			f(zigzag(r.readVarint_()));
+	}
+
+	static std::int64_t zigzag(std::uint64_t u){ return std::int64_t(u >> 1) ^ -std::int64_t(u & 1); }
+
+private:
+	std::uint64_t readVarint_()
+	{
+		std::uint64_t v=0;
+		for(unsigned shift=0; shift < 64; shift += 7)
+		{
+			if (p_ == end_)
+				throw std::runtime_error("ProtobufReader: truncated varint");
+			std::uint8_t b = *p_++;
+			v |= std::uint64_t(b & 0x7f) << shift;
+			if (!(b & 0x80))
+				return v;
+		}
+		throw std::runtime_error("ProtobufReader: varint too long");
+	}
+
+	void advance_(std::size_t N)
+	{
+		if (N > std::size_t(end_-p_))
+			throw std::runtime_error("ProtobufReader: fixed-width field runs past end of message");
+		p_ += N;
+	}
+
+	const char*		p_=nullptr;
+	const char*		end_=nullptr;
+
+	unsigned		field_=0;
+	WireType		wireType_=Varint;
+};
+
+#endif /* PROTOBUFREADER_HPP_ */
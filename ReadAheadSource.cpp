@@ -0,0 +1,226 @@
+/*
+ * ReadAheadSource.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include "ReadAheadSource.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+void ReadAheadStats::print(std::ostream& os) const
+{
+	os << "Read-ahead: " << fixed << setprecision(1) << double(bytes)/double(1 << 20) << " MiB in " << buffers << " buffers" << endl;
+	os << "  parser waited for input " << consumerStalls << " times (" << setprecision(3) << double(consumerStallNs)*1e-9 << " s)" << endl;
+	os << "  reader waited for parser " << producerStalls << " times (" << setprecision(3) << double(producerStallNs)*1e-9 << " s)" << endl;
+	os.unsetf(ios_base::floatfield);
+}
+
+
+
+class ReadAheadSource::Pipeline
+{
+public:
+	Pipeline(ReadFunction upstream,std::shared_ptr<ReadAheadStats> stats,unsigned nBuffers,std::size_t bufferSize);
+	~Pipeline();
+
+	std::streamsize read(char* s,std::streamsize n);
+
+	const ReadAheadStats& stats() const { return *m_stats; }
+
+private:
+	void produce();
+
+	/// Blocks on cv until pred, counting the stall (if any) in the given counters
+	template<class Predicate>void waitCounted(unique_lock<mutex>& L,condition_variable& cv,Predicate pred,
+			atomic<uint64_t>& stalls,atomic<uint64_t>& stallNs)
+	{
+		if (pred())
+			return;
+		auto t0 = chrono::steady_clock::now();
+		cv.wait(L,pred);
+		++stalls;
+		stallNs += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now()-t0).count();
+	}
+
+	struct Buffer
+	{
+		vector<char> 	data;
+		size_t 			size=0;
+	};
+
+	ReadFunction 					m_upstream;
+	shared_ptr<ReadAheadStats> 		m_stats;
+
+	vector<Buffer> 					m_ring;
+	size_t 							m_head=0;		// next buffer to fill
+	size_t 							m_tail=0;		// buffer being / next to be consumed
+	size_t 							m_full=0;		// full buffers, including the one being consumed
+	size_t 							m_pos=0;		// read position within m_ring[m_tail]
+	bool 							m_holding=false;
+
+	bool 							m_eof=false;
+	bool 							m_stop=false;
+	exception_ptr 					m_error;
+
+	mutex 							m_mutex;
+	condition_variable 				m_notEmpty;
+	condition_variable 				m_notFull;
+
+	thread 							m_thread;
+};
+
+ReadAheadSource::Pipeline::Pipeline(ReadFunction upstream,std::shared_ptr<ReadAheadStats> stats,unsigned nBuffers,std::size_t bufferSize) :
+	m_upstream(upstream),
+	m_stats(stats),
+	m_ring(max(2U,nBuffers))
+{
+	for(auto& b : m_ring)
+		b.data.resize(bufferSize);
+	m_thread = thread(&Pipeline::produce,this);
+}
+
+ReadAheadSource::Pipeline::~Pipeline()
+{
+	{
+		lock_guard<mutex> L(m_mutex);
+		m_stop=true;
+	}
+	m_notFull.notify_all();
+	m_thread.join();
+}
+
+void ReadAheadSource::Pipeline::produce()
+{
+	try {
+		for(bool eof=false; !eof; )
+		{
+			size_t i;
+			{
+				unique_lock<mutex> L(m_mutex);
+				waitCounted(L,m_notFull,[this]{ return m_stop || m_full < m_ring.size(); },
+						m_stats->producerStalls,m_stats->producerStallNs);
+				if (m_stop)
+					return;
+				i = m_head;
+			}
+
+			// fill the buffer completely (unless input ends) without holding the lock
+			Buffer& b = m_ring[i];
+			b.size=0;
+			while(b.size < b.data.size())
+			{
+				streamsize N = m_upstream(b.data.data()+b.size,b.data.size()-b.size);
+				if (N < 0)
+				{
+					eof=true;
+					break;
+				}
+				b.size += N;
+			}
+
+			{
+				lock_guard<mutex> L(m_mutex);
+				if (b.size > 0)
+				{
+					m_head = (m_head+1) % m_ring.size();
+					++m_full;
+					m_stats->bytes += b.size;
+					++m_stats->buffers;
+				}
+				m_eof = eof;
+			}
+			m_notEmpty.notify_one();
+		}
+	}
+	catch(...)
+	{
+		{
+			lock_guard<mutex> L(m_mutex);
+			m_error = current_exception();
+			m_eof = true;
+		}
+		m_notEmpty.notify_one();
+	}
+}
+
+std::streamsize ReadAheadSource::Pipeline::read(char* s,std::streamsize n)
+{
+	streamsize total=0;
+
+	while(total < n)
+	{
+		if (!m_holding)
+		{
+			unique_lock<mutex> L(m_mutex);
+
+			// hand back what we have rather than wait for more
+			if (total > 0 && m_full == 0)
+				break;
+
+			waitCounted(L,m_notEmpty,[this]{ return m_full > 0 || m_eof; },
+					m_stats->consumerStalls,m_stats->consumerStallNs);
+
+			if (m_full == 0)
+			{
+				if (m_error)
+				{
+					exception_ptr e = m_error;
+					m_error = nullptr;
+					rethrow_exception(e);
+				}
+				break;
+			}
+			m_holding=true;
+			m_pos=0;
+		}
+
+		const Buffer& b = m_ring[m_tail];
+		const size_t k = min(size_t(n-total),b.size-m_pos);
+		memcpy(s+total,b.data.data()+m_pos,k);
+		m_pos += k;
+		total += k;
+
+		if (m_pos == b.size)
+		{
+			{
+				lock_guard<mutex> L(m_mutex);
+				m_tail = (m_tail+1) % m_ring.size();
+				--m_full;
+				m_holding=false;
+			}
+			m_notFull.notify_one();
+		}
+	}
+
+	return total == 0 && n > 0 ? -1 : total;
+}
+
+
+
+ReadAheadSource::ReadAheadSource(ReadFunction upstream,std::shared_ptr<ReadAheadStats> stats,unsigned nBuffers,std::size_t bufferSize) :
+	m_pipeline(make_shared<Pipeline>(upstream,stats,nBuffers,bufferSize))
+{
+}
+
+std::streamsize ReadAheadSource::read(char* s,std::streamsize n)
+{
+	return m_pipeline->read(s,n);
+}
+
+const ReadAheadStats& ReadAheadSource::stats() const
+{
+	return m_pipeline->stats();
+}
@@ -0,0 +1,74 @@
+/*
+ * ReadAheadSource.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef READAHEADSOURCE_HPP_
+#define READAHEADSOURCE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+
+#include <boost/iostreams/categories.hpp>
+
+/** Counters describing where a read-ahead pipeline spent its time waiting.
+ *
+ * consumerStalls counts the times the reader (the parser) found no full buffer ready, ie. input (I/O + decompression)
+ * was the bottleneck. producerStalls counts the times the producer found no free buffer, ie. the parser was.
+ */
+
+struct ReadAheadStats
+{
+	std::atomic<std::uint64_t> bytes{0};
+	std::atomic<std::uint64_t> buffers{0};
+
+	std::atomic<std::uint64_t> consumerStalls{0};
+	std::atomic<std::uint64_t> consumerStallNs{0};
+
+	std::atomic<std::uint64_t> producerStalls{0};
+	std::atomic<std::uint64_t> producerStallNs{0};
+
+	void print(std::ostream& os) const;
+};
+
+
+
+/** Boost.Iostreams Source which runs an upstream read function (file read + decompression) on its own thread, filling
+ * a bounded ring of large buffers ahead of the consumer. Reads from the upstream overlap with whatever the consumer does
+ * with the data (eg. SAX parsing), so throughput approaches that of the slowest stage rather than the sum.
+ *
+ * The upstream function has the Source::read signature: returns the number of bytes read, or -1 at end of input.
+ * Upstream exceptions are rethrown to the consumer.
+ *
+ * Copies share the same pipeline (as required to pass a Source by value).
+ */
+
+class ReadAheadSource
+{
+public:
+	typedef char 							char_type;
+	typedef boost::iostreams::source_tag 	category;
+
+	typedef std::function<std::streamsize(char*,std::streamsize)> ReadFunction;
+
+	ReadAheadSource(){}
+	ReadAheadSource(ReadFunction upstream,
+			std::shared_ptr<ReadAheadStats> stats=std::make_shared<ReadAheadStats>(),
+			unsigned nBuffers=4,
+			std::size_t bufferSize=std::size_t(4) << 20);
+
+	std::streamsize read(char* s,std::streamsize n);
+
+	const ReadAheadStats& stats() const;
+
+private:
+	class Pipeline;
+	std::shared_ptr<Pipeline> m_pipeline;
+};
+
+#endif /* READAHEADSOURCE_HPP_ */
@@ -11,6 +11,7 @@
 #include <string>
 #include <vector>
 #include "XercesUtils.hpp"
+#include "NumberParser.hpp"
 #include <sstream>
 #include <iostream>
 
@@ -127,8 +128,9 @@ template<class NewValueNotifier,class ValueNotifier>FlatMapAttributeHandler<NewV
 	}
 
 
-/** Uses the standard extraction operator to convert the string to a value of type T, then calls a unary notifier function
- * with that value
+/** Converts the string to a value of type T, then calls a unary notifier function with that value.
+ * Numeric types used by the OSM handlers (unsigned long long, double, float) are parsed in place from the XMLCh string
+ * without allocation (see NumberParser.hpp); other types use the standard extraction operator.
  *
  * @tparam Notifier 	Unary function object
  * @tparam T 			Value type
@@ -141,18 +143,27 @@ public:
 
 	void process(const std::string,const XMLCh* v)
 	{
-		std::string s=XMLChString(v);
 		T i;
-		std::stringstream ss(s);
-		ss >> i;
 
-		if (!ss.fail())
+		if (parse(v,i))
 			n_(i);
 		else
-			std::cerr << "Failed to parse '" << s << "' as type " << std::endl;
+			std::cerr << "Failed to parse '" << std::string(XMLChString(v)) << "' as type " << std::endl;
 	}
 
 private:
+	static bool parse(const XMLCh* v,unsigned long long& i){ return parseNumber(v,i); }
+	static bool parse(const XMLCh* v,double& i){ return parseNumber(v,i); }
+	static bool parse(const XMLCh* v,float& i){ return parseNumber(v,i); }
+
+	template<typename U>static bool parse(const XMLCh* v,U& i)
+	{
+		std::string s=XMLChString(v);
+		std::stringstream ss(s);
+		ss >> i;
+		return !ss.fail();
+	}
+
 	Notifier n_;
 };
 
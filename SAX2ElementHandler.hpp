@@ -23,6 +23,8 @@
 
 #include "SAX2AttributeHandler.hpp"
 #include "OSMDatabaseBuilder.hpp"
+#include "OSMNameHash.hpp"
+#include "IngestStats.hpp"
 
 class SAX2ElementHandler;
 
@@ -103,6 +105,13 @@ private:
 
 
 
+/** Element handler which dispatches child elements and attributes by name to handlers added with addElementHandler and
+ * addAttributeHandler, or to the defaults.
+ *
+ * Names in the OSM vocabulary are looked up through the compile-time perfect hash OSMNameHash into per-slot handler
+ * arrays; the flat maps are searched only for names outside it, and only if a handler was added for such a name.
+ */
+
 class FlatMapSAX2ElementHandler : public SAX2ElementHandler {
 
 public:
@@ -115,8 +124,13 @@ public:
 		auto p = elementMap_.insert(std::make_pair(xmlch,h));
 		if (!p.second)
 			xercesc::XMLString::release((XMLCh**)&xmlch);
+		p.first->second = h;
+
+		unsigned i = OSMNameHash::slot(elType.c_str());
+		if (i == -1U)
+			slowElements_ = true;
 		else
-			p.first->second = h;
+			elementSlots_[i] = h;
 	}
 
 	void addAttributeHandler(const std::string attrname,SAX2AttributeHandler* h)
@@ -125,8 +139,13 @@ public:
 		auto p = attributeMap_.insert(std::make_pair(xmlch,h));
 		if (!p.second)
 			xercesc::XMLString::release((XMLCh**)&xmlch);
+		p.first->second=h;
+
+		unsigned i = OSMNameHash::slot(attrname.c_str());
+		if (i == -1U)
+			slowAttributes_ = true;
 		else
-			p.first->second=h;
+			attributeSlots_[i] = h;
 	}
 
 	void ignoreAttribute(const std::string attrname)
@@ -144,22 +163,25 @@ public:
 			const XMLCh* t = attrs.getLocalName(i);
 			const XMLCh* v = attrs.getValue(i);
 
-			auto p = attributeMap_.find(t);
-			if (p == attributeMap_.end())		// not found
-			{
-				assert(defaultAttributeHandler_);
-				defaultAttributeHandler_->process(t,v);
-			}
-			else
-				p->second->process(t,v);
+			SAX2AttributeHandler* h = attributeHandler(t);
+			assert(h);
+			h->process(t,v);
 		}
 	}
 
 	virtual SAX2ElementHandler* getHandlerForElement(const XMLCh* const uri,const XMLCh* const localname,const XMLCh* const qname)
 	{
-		auto p = elementMap_.find(localname);
-		std::string s = XMLChString(localname);
-		return p == elementMap_.end() ? defaultElementHandler_ : p->second;
+		const unsigned i = OSMNameHash::slot(localname);
+
+		if (i != -1U)
+			return elementSlots_[i] ? elementSlots_[i] : defaultElementHandler_;
+		else if (slowElements_)
+		{
+			auto p = elementMap_.find(localname);
+			return p == elementMap_.end() ? defaultElementHandler_ : p->second;
+		}
+		else
+			return defaultElementHandler_;
 	}
 
 
@@ -189,11 +211,35 @@ private:
 
 	virtual void endElement_(const XMLCh* const,const XMLCh* const,const XMLCh* const){}
 
+	/// Handler for attribute name t: slot table for the OSM vocabulary, map search only if other names were added
+	SAX2AttributeHandler* attributeHandler(const XMLCh* t) const
+	{
+		const unsigned i = OSMNameHash::slot(t);
+
+		if (i != -1U)
+			return attributeSlots_[i] ? attributeSlots_[i] : defaultAttributeHandler_;
+		else if (slowAttributes_)
+		{
+			auto p = attributeMap_.find(t);
+			return p == attributeMap_.end() ? defaultAttributeHandler_ : p->second;
+		}
+		else
+			return defaultAttributeHandler_;
+	}
+
 	static bool xmlChLess(const XMLCh* lhs,const XMLCh* rhs){ return xercesc::XMLString::compareString(lhs,rhs)<0; }
 
+	// all handlers by name (for visiting, and lookup of names outside OSMNameHash)
 	ElementMap elementMap_ = ElementMap(xmlChLess);
 	AttributeMap attributeMap_ = AttributeMap(xmlChLess);
 
+	// handlers for names in the OSMNameHash vocabulary, indexed by slot
+	SAX2ElementHandler* elementSlots_[OSMNameHash::tableSize]={};
+	SAX2AttributeHandler* attributeSlots_[OSMNameHash::tableSize]={};
+
+	bool slowElements_=false;			// true if a handler was added for a name outside the vocabulary
+	bool slowAttributes_=false;
+
 	SAX2ElementHandler *defaultElementHandler_=nullptr;
 	SAX2AttributeHandler *defaultAttributeHandler_=nullptr;
 };
@@ -208,9 +254,9 @@ protected:
 };
 
 template<class EntityType>struct OSMEntityInfo;
-template<>struct OSMEntityInfo<OSMNode>{ static constexpr const char* xmlTag = "<node>"; };
-template<>struct OSMEntityInfo<OSMWay>{ static constexpr const char* xmlTag = "<way>"; };
-template<>struct OSMEntityInfo<OSMRelation>{ static constexpr const char* xmlTag = "<relation>"; };
+template<>struct OSMEntityInfo<OSMNode>{ static constexpr const char* xmlTag = "<node>"; static constexpr OSMEntityType type = Node; };
+template<>struct OSMEntityInfo<OSMWay>{ static constexpr const char* xmlTag = "<way>"; static constexpr OSMEntityType type = Way; };
+template<>struct OSMEntityInfo<OSMRelation>{ static constexpr const char* xmlTag = "<relation>"; static constexpr OSMEntityType type = Relation; };
 
 template<class EntityType>class OSMEntityHandler : public OSMEntityHandlerBase {
 public:
@@ -223,6 +269,7 @@ public:
 	virtual void startElement_(const XMLCh* const,const XMLCh* const,const XMLCh* const,const xercesc::Attributes& attrs)
 	{
 		dbb_->createNew<EntityType>();
+		ingestStats().addElements(OSMEntityInfo<EntityType>::type);
 		processAttributes(attrs);
 	}
 
@@ -7,57 +7,68 @@
 
 #include "StreetsDatabaseAPI.h"
 #include "StreetsDatabase.h"
+#include "FlatStreetsDatabase.hpp"
 
 #include <string>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <set>
 
 #include <boost/graph/adj_list_serialize.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 
-StreetsDatabase streetsDB;
+// all queries are answered directly from the flat (memory-mapped) representation
+FlatStreetsDatabase streetsDB;
 
 using namespace std;
 
 // load the layer-2 streets database
 
 bool loadStreetsDatabaseBIN(const std::string fn) {
-    ifstream is(fn.c_str());
+    ifstream is(fn.c_str(), ios_base::in | ios_base::binary);
     if (!is.good())
         return false;
 
-    boost::archive::binary_iarchive ia(is);
+    if (flatFileHasMagic(fn, FlatStreetsDatabase::s_magic))
+        streetsDB = FlatStreetsDatabase(fn);
+    else {
+        // legacy boost::serialization format: deserialize, then convert to an in-memory flat image
+        StreetsDatabase sdb;
+        boost::archive::binary_iarchive ia(is);
 
-    ia & streetsDB;
+        ia & sdb;
+
+        streetsDB = FlatStreetsDatabase(sdb);
+    }
 
     return true;
 }
 
 void closeStreetDatabase() {
-    streetsDB = StreetsDatabase();
+    streetsDB = FlatStreetsDatabase();
 }
 
 // aggregate queries
 
 unsigned getNumberOfStreets() {
-    return streetsDB.streets().size();
+    return streetsDB.streetCount();
 }
 
 unsigned getNumberOfStreetSegments() {
-    return num_edges(streetsDB.roads());
+    return streetsDB.segmentCount();
 }
 
 unsigned getNumberOfIntersections() {
-    return num_vertices(streetsDB.roads());
+    return streetsDB.intersectionCount();
 }
 
 unsigned getNumberOfPointsOfInterest() {
-    return streetsDB.getNumberOfPOIs();
+    return streetsDB.poiCount();
 }
 
 unsigned getNumberOfFeatures() {
-    return streetsDB.getNumberOfFeatures();
+    return streetsDB.featureCount();
 }
 
 
@@ -67,54 +78,46 @@ unsigned getNumberOfFeatures() {
 std::string getIntersectionName(unsigned intersectionID) {
     std::set<unsigned> streetIDs;
 
-    const auto& G = streetsDB.roads();
-    const auto v = streetsDB.intersection(intersectionID);
-
-    for (const auto e : out_edges(v, G))
-        streetIDs.insert(G[e].streetVectorIndex);
+    for (const auto s : streetsDB.intersectionSegments(intersectionID))
+        streetIDs.insert(streetsDB.segment(s).streetID);
 
     auto it = streetIDs.begin();
     stringstream ss;
 
     if (it != streetIDs.end())
-        ss << streetsDB.streets().at(*(it++));
+        ss << streetsDB.streetName(*(it++));
 
     for (; it != streetIDs.end(); ++it)
-        ss << " & " << streetsDB.streets().at(*it);
+        ss << " & " << streetsDB.streetName(*it);
 
     return ss.str();
 }
 
 LatLon getIntersectionPosition(unsigned intersectionID) {
-    return (streetsDB.roads())[streetsDB.intersection(intersectionID)].latlon;
+    return streetsDB.intersection(intersectionID).latlon;
 }
 
 OSMID getIntersectionOSMNodeID(unsigned intersectionID) {
-    return (streetsDB.roads())[streetsDB.intersection(intersectionID)].osmid;
+    return streetsDB.intersection(intersectionID).osmid;
 }
 
 
 //number of street segments at an intersection
 
 unsigned getIntersectionStreetSegmentCount(unsigned intersectionID) {
-    return out_degree(streetsDB.intersection(intersectionID), streetsDB.roads());
+    return streetsDB.intersectionSegments(intersectionID).size();
 }
 
 // find the street segments at an intersection. idx is from
 // 0..streetSegmentCount-1 (at this intersection)
 
 unsigned getIntersectionStreetSegment(unsigned intersectionID, unsigned idx) {
-    const auto& G = streetsDB.roads();
-    const auto u = streetsDB.intersection(intersectionID);
-
-    const auto Es = out_edges(u, G);
+    const auto segs = streetsDB.intersectionSegments(intersectionID);
 
-    if (idx >= out_degree(u, G))
+    if (idx >= segs.size())
         throw std::out_of_range("getIntersectionStreetSegment: idx");
 
-    const auto e = *(begin(Es) + idx);
-
-    return G[e].streetSegmentVectorIndex;
+    return segs[idx];
 }
 
 
@@ -127,24 +130,23 @@ unsigned getIntersectionStreetSegment(unsigned intersectionID, unsigned idx) {
 StreetSegmentInfo getStreetSegmentInfo(unsigned streetSegmentID) {
     StreetSegmentInfo info;
 
-    const PathNetwork& G = streetsDB.roads();
-    const auto e = streetsDB.streetSegment(streetSegmentID);
+    const FlatStreetSegment& s = streetsDB.segment(streetSegmentID);
 
-    info.from = source(e, G);
-    info.to = target(e, G);
+    info.from = s.from;
+    info.to = s.to;
 
-    info.oneWay = G[e].oneWay != EdgeProperties::Bidir;
+    info.oneWay = s.oneWay != EdgeProperties::Bidir;
 
     // if should be going to greater vertex number (T) but to < from (F) then swap
     // also if should be going to lesser vertex number (F) but to > from (T) also swap
 
-    if (info.oneWay && ((G[e].oneWay == EdgeProperties::ToGreaterVertexNumber) ^ (info.from < info.to)))
+    if (info.oneWay && ((s.oneWay == EdgeProperties::ToGreaterVertexNumber) ^ (info.from < info.to)))
         std::swap(info.from, info.to);
 
-    info.wayOSMID = G[e].wayOSMID;
-    info.streetID = G[e].streetVectorIndex;
-    info.speedLimit = G[e].maxspeed;
-    info.curvePointCount = G[e].curvePoints.size();
+    info.wayOSMID = s.wayOSMID;
+    info.streetID = s.streetID;
+    info.speedLimit = s.maxspeed;
+    info.curvePointCount = streetsDB.curvePoints(streetSegmentID).size();
 
     return info;
 }
@@ -152,10 +154,7 @@ StreetSegmentInfo getStreetSegmentInfo(unsigned streetSegmentID) {
 //fetch the latlon of the idx'th curve point
 
 LatLon getStreetSegmentCurvePoint(unsigned streetSegmentID, unsigned idx) {
-    const PathNetwork& G = streetsDB.roads();
-    const auto e = streetsDB.streetSegment(streetSegmentID);
-
-    return G[e].curvePoints.at(idx);
+    return streetsDB.curvePoints(streetSegmentID).at(idx);
 }
 
 
@@ -164,7 +163,7 @@ LatLon getStreetSegmentCurvePoint(unsigned streetSegmentID, unsigned idx) {
 // Street information
 
 std::string getStreetName(unsigned streetID) {
-    return streetsDB.streets().at(streetID); // throws exception if out of bounds
+    return streetsDB.streetName(streetID).to_string(); // throws exception if out of bounds
 }
 
 
@@ -173,21 +172,21 @@ std::string getStreetName(unsigned streetID) {
 // Points of interest
 
 std::string getPointOfInterestType(unsigned pointOfInterestID) {
-    return streetsDB.poi(pointOfInterestID).type();
+    return streetsDB.strings().at(streetsDB.poi(pointOfInterestID).type).to_string();
 }
 
 std::string getPointOfInterestName(unsigned pointOfInterestID) {
-    return streetsDB.poi(pointOfInterestID).name();
+    return streetsDB.strings().at(streetsDB.poi(pointOfInterestID).name).to_string();
 
 }
 
 LatLon getPointOfInterestPosition(unsigned pointOfInterestID) {
-    return streetsDB.poi(pointOfInterestID).pos();
+    return streetsDB.poi(pointOfInterestID).pos;
 
 }
 
 OSMID getPointOfInterestOSMNodeID(unsigned pointOfInterestID) {
-    return streetsDB.poi(pointOfInterestID).osmNodeID();
+    return streetsDB.poi(pointOfInterestID).osmid;
 }
 
 
@@ -196,28 +195,27 @@ OSMID getPointOfInterestOSMNodeID(unsigned pointOfInterestID) {
 // Natural features
 
 FeatureType getFeatureType(unsigned featureID) {
-    return streetsDB.feature(featureID).type();
+    return FeatureType(streetsDB.feature(featureID).type);
 }
 
-const string& getFeatureName(unsigned featureID) {
-    return streetsDB.feature(featureID).name();
+std::string getFeatureName(unsigned featureID) {
+    return streetsDB.strings().at(streetsDB.feature(featureID).name).to_string();
 }
 
 OSMID getFeatureOSMID(unsigned featureID) {
-    return streetsDB.feature(featureID).id().first;
+    return streetsDB.feature(featureID).osmid;
 
 }
 
 OSMEntityType getFeatureOSMEntityType(unsigned featureID) {
-    return streetsDB.feature(featureID).id().second;
+    return OSMEntityType(streetsDB.feature(featureID).osmType);
 }
 
 unsigned getFeaturePointCount(unsigned featureID) {
-    return streetsDB.feature(featureID).pointCount();
+    return streetsDB.featurePoints(featureID).size();
 
 }
 
 LatLon getFeaturePoint(unsigned featureID, unsigned idx) {
-    return streetsDB.feature(featureID).point(idx);
+    return streetsDB.featurePoints(featureID).at(idx);
 }
-
@@ -81,7 +81,7 @@ OSMID getPointOfInterestOSMNodeID(unsigned pointOfInterestID);
 
 //------------------------------------------------
 // Natural features
-const std::string& getFeatureName(unsigned featureID);
+std::string getFeatureName(unsigned featureID);
 FeatureType getFeatureType(unsigned featureID);
 OSMID getFeatureOSMID(unsigned featureID);
 OSMEntityType getFeatureOSMEntityType(unsigned featureID);
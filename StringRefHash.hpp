@@ -0,0 +1,29 @@
+/*
+ * StringRefHash.hpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#ifndef STRINGREFHASH_HPP_
+#define STRINGREFHASH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/utility/string_ref.hpp>
+
+/** Hash of the bytes referred to by a string_ref (FNV-1a) */
+
+struct StringRefHash
+{
+	std::size_t operator()(boost::string_ref s) const
+	{
+		std::uint64_t h=14695981039346656037ULL;
+		for(const char c : s)
+			h = (h ^ (unsigned char)c)*1099511628211ULL;
+		return std::size_t(h);
+	}
+};
+
+#endif /* STRINGREFHASH_HPP_ */
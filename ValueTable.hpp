@@ -8,72 +8,164 @@
 #ifndef VALUETABLE_HPP_
 #define VALUETABLE_HPP_
 
+#include <cstdint>
 #include <string>
 #include <functional>
+#include <stdexcept>
 #include <vector>
 #include <boost/serialization/serialization.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/string.hpp>
 #include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
+#include <boost/utility/string_ref.hpp>
 
-/** Wrapper on a vector of strings with a restricted interface to permit insertion only.
- * The container does not guarantee uniqueness, and values are in insertion order (not sorted) so inverse-lookup is linear time.
+#include "FlatFile.hpp"
+#include "StringRefHash.hpp"
+
+/** Insertion-only table of strings, addressed by index.
+ * The container does not guarantee uniqueness, and values are in insertion order (not sorted). Inverse lookup goes
+ * through a hash index kept alongside, so it is constant time.
+ *
+ * The strings are held back to back in one character arena with N+1 offsets (the layout of FlatStringTable), so a
+ * table costs one allocation rather than one per string and is archived and copied in bulk. Values are returned as
+ * string_refs into the arena, which stay valid until the next addValue.
  */
 
 class ValueTable {
 public:
+
+    ValueTable() {
+    }
+
+    /// Copies a flat string table (eg. from a mapped .osm.bin) in bulk
+    explicit ValueTable(const FlatStringTable& t) :
+    chars_(t.chars().data(), t.offsets().back()),
+    offsets_(t.offsets().begin(), t.offsets().end()) {
+        rebuildIndex_();
+    }
+
     /// adds a value, returns the index
 
-    unsigned addValue(const std::string v) {
-        values_.push_back(v);
-        return values_.size() - 1;
+    unsigned addValue(boost::string_ref v) {
+        chars_.append(v.data(), v.size());
+        offsets_.push_back(chars_.size());
+        if (2 * size() > index_.size())
+            rebuildIndex_();
+        else
+            insertIndex_(size() - 1);
+        return size() - 1;
     }
 
     /// gets a value
 
-    const std::string& getValue(unsigned vi) const {
-        return values_.at(vi);
+    boost::string_ref getValue(unsigned vi) const {
+        if (!valueValid(vi))
+            throw std::out_of_range("ValueTable::getValue");
+        return (*this)[vi];
     }
 
     /// Checks if an index is within the valid range
 
     bool valueValid(unsigned vi) const {
-        return vi < values_.size();
+        return vi < size();
+    }
+
+    std::size_t size() const {
+        return offsets_.size() - 1;
     }
 
-    /// Linear-time search for the index of a string value value within the table, returning -1U if not found
+    /// Hash lookup of the (first) index of a string value within the table, returning -1U if not found
 
-    unsigned getIndexOfValue(const std::string v) const {
-        auto it = find(values_.begin(), values_.end(), v);
-        if (it == values_.end())
+    unsigned getIndexOfValue(boost::string_ref v) const {
+        if (index_.empty())
             return -1U;
-        else
-            return it - values_.begin();
+
+        const std::size_t mask = index_.size() - 1;
+        for (std::size_t s = StringRefHash()(v) & mask; index_[s] != -1U; s = (s + 1) & mask)
+            if ((*this)[index_[s]] == v)
+                return index_[s];
+        return -1U;
     }
 
     /// Function object which takes an unsigned index and returns the corresponding string
 
-    std::function<const std::string&(unsigned) > valueLookup() const {
+    std::function<boost::string_ref(unsigned) > valueLookup() const {
         return [this](unsigned i) {
-            return cref(values_.at(i));
+            return getValue(i);
         };
     }
 
-    /// Returns all the values (unsorted)
+    /// Returns all the values (unsorted) as a view of the arena
 
-    const std::vector<std::string>& values() const {
-        return values_;
+    FlatStringTable values() const {
+        return FlatStringTable(FlatArray<std::uint64_t>(offsets_.data(), offsets_.size()), FlatArray<char>(chars_.data(), chars_.size()));
     }
 
 private:
-    /// Vector of all strings in insertion order (unsorted)
-    std::vector<std::string> values_;
+    /// All strings in insertion order (unsorted), string i being chars_[offsets_[i], offsets_[i+1])
+    std::string chars_;
+    std::vector<std::uint64_t> offsets_ = std::vector<std::uint64_t>(1, 0);
+
+    /** Open-addressed (linear probing) hash index: each slot holds a string index or -1U if empty. The size is a
+     * power of two at least twice size(), so probes are short and always reach an empty slot. Equal strings probe from
+     * the same slot and are inserted in index order, so the first one is found first.
+     */
+    std::vector<unsigned> index_;
+
+    boost::string_ref operator[](std::size_t i) const {
+        return boost::string_ref(chars_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]);
+    }
+
+    void insertIndex_(unsigned vi) {
+        const std::size_t mask = index_.size() - 1;
+        std::size_t s = StringRefHash()((*this)[vi]) & mask;
+        while (index_[s] != -1U)
+            s = (s + 1) & mask;
+        index_[s] = vi;
+    }
+
+    void rebuildIndex_() {
+        std::size_t n = 16;
+        while (n < 2 * size())
+            n *= 2;
+        index_.assign(n, -1U);
+        for (unsigned i = 0; i < size(); ++i)
+            insertIndex_(i);
+    }
+
+    // version 0 archives hold a std::vector<std::string>; version 1 holds the offsets and arena, each a single bulk
+    // array. The hash index is rebuilt on load rather than archived.
 
-    template<class Archive>void serialize(Archive& ar, const unsigned ver) {
-        ar & values_;
+    template<class Archive>void save(Archive& ar, const unsigned ver) const {
+        ar & offsets_ & chars_;
     }
+
+    template<class Archive>void load(Archive& ar, const unsigned ver) {
+        if (ver == 0) {
+            std::vector<std::string> v;
+            ar & v;
+            chars_.clear();
+            offsets_.assign(1, 0);
+            offsets_.reserve(v.size() + 1);
+            for (const auto& s : v) {
+                chars_ += s;
+                offsets_.push_back(chars_.size());
+            }
+        } else {
+            ar & offsets_ & chars_;
+            if (offsets_.empty() || offsets_.back() != chars_.size())
+                throw std::runtime_error("ValueTable: inconsistent archived offsets");
+        }
+        rebuildIndex_();
+    }
+
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
     friend class boost::serialization::access;
 };
 
-
+BOOST_CLASS_VERSION(ValueTable, 1)
 
 
 #endif /* VALUETABLE_HPP_ */
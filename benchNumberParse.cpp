@@ -0,0 +1,129 @@
+/*
+ * benchNumberParse.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ *
+ * Micro-benchmark of numeric attribute parsing: the previous std::string + std::stringstream conversion used by the SAX
+ * handlers, against parseNumber (NumberParser.hpp) directly on the XMLCh and UTF-8 strings. Also checks that both give
+ * identical results.
+ *
+ * usage: benchNumberParse [N]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdio>
+#include <cstring>
+
+#include <boost/timer/timer.hpp>
+
+#include "XercesUtils.hpp"
+#include "NumberParser.hpp"
+
+using namespace std;
+
+/// The conversion as done by TypedAttributeHandler and OSMNdElementHandler before NumberParser
+template<typename T>bool streamParse(const XMLCh* v,T& x)
+{
+	std::string s=XMLChString(v);
+	std::stringstream ss(s);
+	ss >> x;
+	return !ss.fail();
+}
+
+template<typename T>bool streamParse(const std::string& s,T& x)
+{
+	std::stringstream ss(s);
+	ss >> x;
+	return !ss.fail();
+}
+
+template<typename T>bool same(T a,T b)
+{
+	return memcmp(&a,&b,sizeof(T)) == 0;
+}
+
+/// Times f over all of the values, printing ns per value
+template<class Function>void time(const char* what,std::size_t N,Function f)
+{
+	boost::timer::cpu_timer t;
+	f();
+	t.stop();
+	cout << "  " << setw(40) << left << what << right << setw(8) << fixed << setprecision(1) << double(t.elapsed().wall)/N << " ns/value" << endl;
+}
+
+template<typename T>void bench(const char* title,const vector<string>& values)
+{
+	const std::size_t N = values.size();
+
+	vector<AutoXMLChPtr> xml;
+	xml.reserve(N);
+	for(const auto& s : values)
+		xml.emplace_back(s);
+
+	vector<T> ref(N),x(N);
+	std::size_t mismatches=0;
+
+	cout << title << " (" << N << " values)" << endl;
+
+	time("XMLCh -> std::string -> stringstream",N,[&](){
+		for(std::size_t i=0;i<N;++i)
+			streamParse(xml[i].get(),ref[i]);
+	});
+
+	time("XMLCh -> parseNumber",N,[&](){
+		for(std::size_t i=0;i<N;++i)
+			parseNumber(xml[i].get(),x[i]);
+	});
+
+	for(std::size_t i=0;i<N;++i)
+		mismatches += !same(ref[i],x[i]);
+
+	time("UTF-8 std::string -> stringstream",N,[&](){
+		for(std::size_t i=0;i<N;++i)
+			streamParse(values[i],ref[i]);
+	});
+
+	time("UTF-8 -> parseNumber",N,[&](){
+		for(std::size_t i=0;i<N;++i)
+			parseNumber(values[i].data(),values[i].data()+values[i].size(),x[i]);
+	});
+
+	for(std::size_t i=0;i<N;++i)
+		mismatches += !same(ref[i],x[i]);
+
+	cout << "  " << mismatches << " mismatches" << endl << endl;
+}
+
+int main(int argc,char **argv)
+{
+	XMLPlatform plat;
+
+	const std::size_t N = argc > 1 ? std::stoul(argv[1]) : 1000000;
+
+	mt19937_64 rng(1);
+	char buf[64];
+
+	// node references / ids as in a current planet file
+	vector<string> ids(N);
+	for(auto& s : ids)
+		s = to_string(rng() % 12000000000ULL);
+
+	// coordinates with the usual 7 decimal places
+	vector<string> coords(N);
+	uniform_real_distribution<double> lon(-180.0,180.0);
+	for(auto& s : coords)
+	{
+		snprintf(buf,sizeof(buf),"%.7f",lon(rng));
+		s = buf;
+	}
+
+	bench<unsigned long long>("Node reference (unsigned long long)",ids);
+	bench<double>("Coordinate (double)",coords);
+	bench<float>("Bounds coordinate (float)",coords);
+}
@@ -21,8 +21,8 @@
 
 using namespace std;
 
-// print all tags for a given entity
-void showEntityTags(const OSMEntity* e);
+// print all tags for a given entity (FlatOSMDatabase::NodeRef, WayRef or RelationRef)
+template<class Entity>void showEntityTags(const Entity& e);
 
 // TODO: handle multipolygon relations (<relation> type=multipolygon with roles=inner|outer
 
@@ -141,27 +141,27 @@ int main(int argc,char **argv)
 
 	for(unsigned i=0;i<100 && i<getNumberOfNodes();++i)
 	{
-		const OSMNode* n = getNodeByIndex(i);
-		cout << "Node #" << i << " (ID " << n->id() << ')' << endl;
+		FlatOSMDatabase::NodeRef n = getNodeByIndex(i);
+		cout << "Node #" << i << " (ID " << n.id() << ')' << endl;
 		showEntityTags(n);
 	}
 
 	for(unsigned i=0;i<100 && i<getNumberOfWays();++i)
 	{
-		const OSMWay* w = getWayByIndex(i);
-		cout << "Way #" << i << " (ID " << w->id() << ')' << endl;
+		FlatOSMDatabase::WayRef w = getWayByIndex(i);
+		cout << "Way #" << i << " (ID " << w.id() << ')' << endl;
 		showEntityTags(w);
 	}
 
 	for(unsigned i=0;i<100 && i<getNumberOfRelations();++i)
 	{
-		const OSMRelation* r = getRelationByIndex(i);
-		cout << "Relation #" << i << " (ID " << r->id() << ")" << endl;
+		FlatOSMDatabase::RelationRef r = getRelationByIndex(i);
+		cout << "Relation #" << i << " (ID " << r.id() << ")" << endl;
 		showEntityTags(r);
 	}
 }
 
-void showEntityTags(const OSMEntity* e)
+template<class Entity>void showEntityTags(const Entity& e)
 {
 	for(unsigned i=0;i<getTagCount(e); ++i)
 	{
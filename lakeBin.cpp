@@ -1,13 +1,9 @@
 #include <iostream>
 #include <fstream>
 
-#include "StreetsDatabase.h"
+#include "FlatStreetsDatabase.hpp"
 #include "Feature.hpp"
 
-#include <boost/archive/binary_iarchive.hpp>
-
-#include <boost/graph/adj_list_serialize.hpp>
-
 #include <cairomm/context.h>
 #include <cairomm/surface.h>
 
@@ -127,14 +123,7 @@ int main(int argc,char **argv)
 	if (argc > 2)
 		oFn = argv[2];
 
-	StreetsDatabase db;
-
-	{
-		ifstream is(fn);
-		boost::archive::binary_iarchive ia(is);
-
-		ia & db;
-	}
+	FlatStreetsDatabase db(fn);
 
 	bool image=false;
 
@@ -161,8 +150,8 @@ int main(int argc,char **argv)
 
 	LatLon llc(90.f,180.f), urc(-90.f,-180.f);
 
-	for(unsigned i=0;i<db.getNumberOfFeatures();++i)
-		for(const LatLon ll : db.feature(i).points())
+	for(unsigned i=0;i<db.featureCount();++i)
+		for(const LatLon ll : db.featurePoints(i))
 		{
 			llc.lat = std::min(llc.lat,ll.lat);
 			llc.lon = std::min(llc.lon,ll.lon);
@@ -234,8 +223,8 @@ int main(int argc,char **argv)
 
 	vector<Feature> F;
 
-	for(unsigned i=0;i<db.getNumberOfFeatures(); ++i)
-		F.push_back(db.feature(i));
+	for(unsigned i=0;i<db.featureCount(); ++i)
+		F.push_back(db.toFeature(i));
 
 	cout << "Database has " << F.size() << " features" << endl;
 
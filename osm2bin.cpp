@@ -11,27 +11,25 @@
 #include <string>
 #include <cinttypes>
 #include <utility>
+#include <vector>
 
-#include "NodePOIFilter.hpp"
-#include "MultipolyCloser.hpp"
+#include "ExtractFeatures.hpp"
 
 #include "XercesUtils.hpp"
 #include "LoadOSM.hpp"
+#include "InputFormat.hpp"
+#include "IngestStats.hpp"
 
 #include "OSMDatabase.hpp"
 #include "PathNetwork.hpp"
+#include "FlatOSMDatabase.hpp"
 
 #include <boost/timer/timer.hpp>
 
-// path network serializations
-#include <boost/graph/adj_list_serialize.hpp>
-#include <boost/archive/binary_oarchive.hpp>
-
 #include <boost/range/algorithm.hpp>
 
-#include "BasicWayFeatureFactory.hpp"
-#include "BasicRelationFeatureFactory.hpp"
 #include "StreetsDatabase.h"
+#include "FlatStreetsDatabase.hpp"
 
 using namespace std;
 
@@ -43,28 +41,106 @@ int main(int argc,char **argv)
 	string oFnRoot;
 	string fn("maps/hamilton_canada.osm.gz");
 
-	if (argc > 1)
-		fn=argv[1];
+	OSMXMLParser parser=XercesSAX2;
+	OSMTagFilterProfile filters=defaultTagFilterProfile();
+	OSMNodeRetention nodes=AllNodes;
+	OSMClipRegion clip;
+	string statsFn;
+	double progressInterval=10.0;
+	bool merge=false;
+	OSMBin::Encoding binEncoding=OSMBin::Plain;
+
+	// usage: osm2bin [--tokenizer] [--tag-filter profile] [--referenced-nodes]
+	//			[--clip-box minlon,minlat,maxlon,maxlat | --clip-poly file.poly] [--format fmt]
+	//			[--progress seconds] [--stats-json file] [--compact] [input [output-root]]
+	//		osm2bin [options] --merge input1 input2 ... output-root
+	//
+	// --merge loads the inputs (eg. adjacent tiles) concurrently and merges them into one database, keeping entities
+	// repeated between inputs once
+	// input "-" reads standard input (eg. curl ... | osm2bin - out); its format is detected unless given by --format
+	// (osm, osm.gz, osm.bz2, osm.zst, osm.xz, osm.lz4, osm.pbf)
+	//
+	// --progress prints bytes read, throughput, element counts and RSS every few seconds (default 10, 0 to disable);
+	// --stats-json writes the same counters with per-phase timings, peak RSS and tag filter rule counts at the end
+	//
+	// --compact writes the .osm.bin with delta/varint-coded node IDs, coordinates and node refs (smaller to distribute,
+	// decoded when opened)
+	vector<string> args;
+	for(int i=1;i<argc;++i)
+	{
+		if (string(argv[i]) == "--tokenizer")
+			parser = OSMTokenizer;
+		else if (string(argv[i]) == "--referenced-nodes")
+			nodes = ReferencedNodes;
+		else if (string(argv[i]) == "--tag-filter" && i+1 < argc)
+		{
+			cout << "Loading tag filter profile " << argv[i+1] << endl;
+			filters = loadTagFilterProfile(argv[++i]);
+		}
+		else if (string(argv[i]) == "--merge")
+			merge = true;
+		else if (string(argv[i]) == "--compact")
+			binEncoding = OSMBin::DeltaVarint;
+		else if (string(argv[i]) == "--progress" && i+1 < argc)
+			progressInterval = stod(argv[++i]);
+		else if (string(argv[i]) == "--stats-json" && i+1 < argc)
+			statsFn = argv[++i];
+		else if (string(argv[i]) == "--format" && i+1 < argc)
+			setStdinFormat(parseInputFormatName(argv[++i]));
+		else if (string(argv[i]) == "--clip-box" && i+1 < argc)
+			clip = parseClipBox(argv[++i]);
+		else if (string(argv[i]) == "--clip-poly" && i+1 < argc)
+		{
+			cout << "Loading clip polygon " << argv[i+1] << endl;
+			clip = loadClipPolygon(argv[++i]);
+		}
+		else
+			args.push_back(argv[i]);
+	}
+
+	vector<string> inputs;
 
-	if (argc > 2)
-		oFnRoot = argv[2];
+	if (merge)
+	{
+		if (args.size() < 2)
+		{
+			cerr << "--merge requires at least one input and an output root" << endl;
+			return 1;
+		}
+		oFnRoot = args.back();
+		inputs.assign(args.begin(),args.end()-1);
+	}
+	else
+	{
+		if (args.size() > 0)
+			fn=args[0];
+
+		if (args.size() > 1)
+			oFnRoot = args[1];
+	}
 
 	OSMDatabase db;
 
-	db = loadOSM(fn);
+	if (progressInterval > 0)
+		ingestStats().startProgress(cout,progressInterval);
+
+	if (merge)
+		db = loadOSMTiles(inputs,parser,filters,nodes,clip);
+	else
+		db = loadOSM(fn,parser,filters,nodes,clip);
 
 	if(!oFnRoot.empty())
 	{
 		string oBin = oFnRoot + ".osm.bin";
 
 		cout << "Writing to binary file " << oBin << endl;
+		ingestStats().beginPhase("write .osm.bin");
 
 		{
 			boost::timer::auto_cpu_timer t;
-			std::ofstream os(oBin.c_str(),ios_base::out | ios_base::binary);
-			boost::archive::binary_oarchive oa(os);
-			oa & db;
+			writeFlatOSMDatabase(db,oBin,binEncoding);
 		}
+		ingestStats().endPhase();
 
 		cout << "Done" << endl;
 	}
@@ -109,6 +185,7 @@ int main(int argc,char **argv)
 
 
 	cout << "==== BUILDING NETWORK" << endl;
+	ingestStats().beginPhase("road network");
 
 	OSMWayFilterRoads hwyFilt(db,db.nodes());
 
@@ -118,18 +195,8 @@ int main(int argc,char **argv)
 
 
 	cout << "==== Extracting points of interest" << endl;
-	NodePOIFilter poiFilt(db.nodeTags());
-
-	std::vector<POI> pois;
-
-	for(const OSMNode& n : db.nodes())
-	{
-		auto optPOI = poiFilt(n);
-		if (optPOI)
-			pois.push_back(*optPOI);
-	}
-
-
+	ingestStats().beginPhase("streets & features");
+	std::vector<POI> pois = extractPOIs(db);
 
 	cout << "==== DONE" << endl;
 
@@ -151,89 +218,7 @@ int main(int argc,char **argv)
 
 	cout << "==== Extracting basic features" << endl;
 
-
-
-	bool mapIsIsland=true;
-	bool mapHasUnboundedLake=false;
-
-	cout << "INFO: Starting on assumption that map is an island" << endl;
-
-	vector<Feature> features;
-	BasicWayFeatureFactory WF(db);
-	for(const auto& w : db.ways())
-	{
-		auto feat = WF(w);
-
-		if (feat)
-			features.emplace_back(std::move(*feat));
-	}
-
-	BasicRelationFeatureFactory FF(db);
-	for(const auto& r : db.relations())
-	{
-		// call the factory
-		auto feats = FF(r);
-		for(const auto f : feats)
-		{
-			cout << "  Created feature (" << asString(f.type()) << ") from relation ID " << r.id() << endl;
-
-			if (!f.bounded() && f.isWater())
-			{
-				mapIsIsland=false;
-				mapHasUnboundedLake=true;
-				cout << "INFO: Found an unbounded water feature, so we conclude this is not an island" << endl;
-			}
-			features.emplace_back(std::move(f));
-		}
-	}
-
-
-
-	vector<const OSMWay*> coastline;
-	unsigned m_kiNatural=db.wayTags().getIndexForKeyString("natural");
-	unsigned m_viCoastline=db.wayTags().getIndexForValueString("coastline");
-
-
-	// extract coastlines
-	for(const auto& w : db.ways())
-		if (w.hasTagWithValue(m_kiNatural,m_viCoastline))
-			coastline.push_back(&w);
-
-	cout << "Extracted " << coastline.size() << " ways with coastline tag" << endl;
-
-	MultipolyCloser C(db,coastline);
-	C.direction(MultipolyCloser::CCW);
-	vector<pair<vector<LatLon>,bool>> F = C.loops(MultipolyCloser::All);
-
-	mapIsIsland &= coastline.size()>0;
-
-	for(const auto& poly : F)
-		mapIsIsland &= poly.second;		// if none of the coastlines is unbounded, then we're looking at an island
-
-	if (F.size() == 0)
-	{
-		cout << "INFO: No coastlines, so I conclude this is not an island" << endl;
-		mapIsIsland=false;
-	}
-
-	if (mapIsIsland)
-		cout << "INFO: There are " << F.size() << " coastline ways, none unbounded so I still think the map is an island" << endl;
-
-	if (mapIsIsland)
-	{
-		cout << "INFO: Concluded the map is an island for lack of contradictory evidence" << endl;
-		features.emplace_back(0,Relation,Lake,"<big ocean>",db.corners());
-	}
-
-	for(auto& poly : F)
-	{
-		if (poly.second)	// was originally closed
-			features.emplace_back(0,Way,Island,"<unspecified>",std::move(poly.first));
-		else
-			features.emplace_back(0,Way,Lake,"<unspecified>",std::move(poly.first));
-	}
-
-	sdb.features(std::move(features));
+	sdb.features(extractFeatures(db));
 
 	cout << "Total " << sdb.getNumberOfFeatures() << " features" << endl;
 
@@ -245,14 +230,27 @@ int main(int argc,char **argv)
 
 		string oBin = oFnRoot+".streets.bin";
 		cout << "Writing to binary file " << oBin << endl;
+		ingestStats().beginPhase("write .streets.bin");
 
 		{
 			boost::timer::auto_cpu_timer t;
-			std::ofstream os(oBin.c_str(),ios_base::out | ios_base::binary);
-			boost::archive::binary_oarchive oa(os);
-			oa & sdb;
+			writeFlatStreetsDatabase(sdb,oBin);
 		}
 	}
 
 	cout << "Road network has " << num_edges(G) << " edges" << endl;
+
+	ingestStats().stopProgress();
+
+	if (!statsFn.empty())
+	{
+		ofstream os(statsFn.c_str());
+		if (!os.good())
+			cerr << "Failed to open " << statsFn << " for writing statistics" << endl;
+		else
+		{
+			ingestStats().writeJSON(os);
+			cout << "Wrote ingest statistics to " << statsFn << endl;
+		}
+	}
 }
@@ -0,0 +1,260 @@
+/*
+ * osmApplyChange.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "LoadOSM.hpp"
+#include "OSMChange.hpp"
+#include "OSMDatabase.hpp"
+#include "FlatOSMDatabase.hpp"
+#include "FlatStreetsDatabase.hpp"
+#include "StreetsDatabase.h"
+#include "ExtractFeatures.hpp"
+#include "PathNetwork.hpp"
+
+#include <boost/timer/timer.hpp>
+
+using namespace std;
+
+/** Describes a road network independently of how its vertices, edges and streets are numbered, as sorted lines: one per
+ * intersection (node ID & coordinates) and one per edge (end node IDs, way, one-way direction, speed, curve points) with
+ * its street's name and first edge, so that a patched network can be compared with a full rebuild.
+ */
+
+vector<string> describeNetwork(const PathNetwork& G,const vector<string>& streets)
+{
+	vector<string> lines;
+
+	for(const auto v : boost::make_iterator_range(vertices(G)))
+	{
+		ostringstream os;
+		os << "v " << G[v].osmid << ' ' << G[v].latlon.lat << ' ' << G[v].latlon.lon;
+		lines.push_back(os.str());
+	}
+
+	vector<string> edgeLines;
+	vector<unsigned> edgeStreets;
+
+	for(const auto e : boost::make_iterator_range(edges(G)))
+	{
+		const auto s = source(e,G), t = target(e,G);
+		OSMID a = G[s].osmid, b = G[t].osmid;
+		vector<FixedLatLon> pts = G[e].curvePoints;
+		vector<FixedLatLon> rpts(pts.rbegin(),pts.rend());
+
+		auto less = [](const vector<FixedLatLon>& x,const vector<FixedLatLon>& y){
+			return lexicographical_compare(x.begin(),x.end(),y.begin(),y.end(),[](FixedLatLon p,FixedLatLon q){
+				return make_pair(p.lat,p.lon) < make_pair(q.lat,q.lon); }); };
+
+		// one-way direction is stored relative to the vertex numbers; express it as the node ID it leads to
+		string dir = "bidir";
+		if (G[e].oneWay != EdgeProperties::Bidir)
+		{
+			if (s == t)
+				dir = "loop" + to_string(G[e].oneWay);
+			else
+				dir = to_string((G[e].oneWay == EdgeProperties::ToGreaterVertexNumber) == (t > s) ? b : a);
+		}
+
+		if (a > b || (a == b && less(rpts,pts)))
+		{
+			swap(a,b);
+			swap(pts,rpts);
+		}
+
+		ostringstream os;
+		os << "e " << a << ' ' << b << " way " << G[e].wayOSMID << ' ' << dir << ' ' << G[e].maxspeed;
+		for(const FixedLatLon p : pts)
+			os << ' ' << p.lat << ',' << p.lon;
+
+		edgeLines.push_back(os.str());
+		edgeStreets.push_back(G[e].streetVectorIndex);
+	}
+
+	// identify each street by its (canonically) first edge
+	vector<string> streetFirstEdge(streets.size());
+	for(unsigned i=0;i<edgeLines.size();++i)
+	{
+		string& f = streetFirstEdge.at(edgeStreets[i]);
+		if (f.empty() || edgeLines[i] < f)
+			f = edgeLines[i];
+	}
+
+	for(unsigned i=0;i<edgeLines.size();++i)
+		lines.push_back(edgeLines[i] + " street \"" + streets[edgeStreets[i]] + "\" from " + streetFirstEdge[edgeStreets[i]]);
+
+	boost::sort(lines);
+	return lines;
+}
+
+/** Applies OsmChange (.osc, optionally compressed) files to an .osm.bin in order and writes the result, which may replace the
+ * input. Tags in the changes are filtered with the given profile, which should be the one the .osm.bin was built with.
+ *
+ * With --streets, the road network of the input is loaded from the .streets.bin beside it (which must have been made from
+ * that .osm.bin, as osm2bin does) or built if there is none, patched with updateNetwork after each change, and written
+ * with the streets to the .streets.bin beside the output; POIs and features are re-extracted from the result (a pass
+ * over the database, as in osm2bin), but the road network is not rebuilt.
+ *
+ * With --check-network, the patched road network is also compared with a full rebuild (buildNetwork + assignStreets) of
+ * the result; the exit status is 1 if they differ.
+ */
+
+int main(int argc,char **argv)
+{
+	OSMTagFilterProfile filters=defaultTagFilterProfile();
+	OSMBin::Encoding binEncoding=OSMBin::Plain;
+	bool checkNetwork=false;
+	bool writeStreets=false;
+
+	// usage: osmApplyChange [--tag-filter profile] [--compact] [--streets] [--check-network] input.osm.bin change.osc [change.osc ...] output.osm.bin
+	// (--compact: delta/varint-coded output, as for osm2bin)
+	vector<string> args;
+	for(int i=1;i<argc;++i)
+	{
+		if (string(argv[i]) == "--tag-filter" && i+1 < argc)
+		{
+			cout << "Loading tag filter profile " << argv[i+1] << endl;
+			filters = loadTagFilterProfile(argv[++i]);
+		}
+		else if (string(argv[i]) == "--compact")
+			binEncoding = OSMBin::DeltaVarint;
+		else if (string(argv[i]) == "--streets")
+			writeStreets = true;
+		else if (string(argv[i]) == "--check-network")
+			checkNetwork = true;
+		else
+			args.push_back(argv[i]);
+	}
+
+	if (args.size() < 3)
+	{
+		cerr << "usage: osmApplyChange [--tag-filter profile] [--compact] [--streets] [--check-network] input.osm.bin change.osc[.gz|.bz2|.zst|.xz|.lz4] [change ...] output.osm.bin" << endl;
+		return 1;
+	}
+
+	const string iFn = args.front(), oFn = args.back();
+
+	if (iFn.size() < 8 || iFn.substr(iFn.size()-8) != ".osm.bin")
+	{
+		cerr << "Input must be an .osm.bin file: " << iFn << endl;
+		return 1;
+	}
+
+	if (writeStreets && (oFn.size() < 8 || oFn.substr(oFn.size()-8) != ".osm.bin"))
+	{
+		cerr << "With --streets, the output must be an .osm.bin file: " << oFn << endl;
+		return 1;
+	}
+
+	const string iStreetsFn = iFn.substr(0,iFn.size()-8) + ".streets.bin";
+	const string oStreetsFn = oFn.substr(0,oFn.size()-8) + ".streets.bin";
+
+	OSMDatabase db = loadOSM(iFn);
+
+	PathNetwork G;
+	vector<string> streets;
+	RoadNodeIndex roadNodes;
+
+	if (writeStreets || checkNetwork)
+	{
+		OSMWayFilterRoads hwyFilt(db,db.nodes());
+
+		if (writeStreets && flatFileHasMagic(iStreetsFn,FlatStreetsDatabase::s_magic))
+		{
+			cout << "Loading road network from " << iStreetsFn << endl;
+			StreetsDatabase sdb = FlatStreetsDatabase(iStreetsFn).toStreetsDatabase();
+			G = sdb.roads();
+			streets = sdb.streets();
+		}
+		else
+		{
+			G = buildNetwork(db,hwyFilt);
+			streets = assignStreets(&db,G);
+		}
+		roadNodes = RoadNodeIndex(db,hwyFilt);
+	}
+
+	for(unsigned i=1;i+1<args.size();++i)
+	{
+		boost::timer::auto_cpu_timer t;
+		const OSMChangedIDs changed = db.applyChange(parseOSMChange(args[i],filters));
+
+		if (writeStreets || checkNetwork)
+		{
+			// made after the change, which may have added the highway tag values the filter looks up
+			OSMWayFilterRoads hwyFilt(db,db.nodes());
+			updateNetwork(G,streets,&db,hwyFilt,roadNodes,changed.ways,changed.nodes);
+		}
+	}
+
+	// write beside the output and rename, so the input can be replaced in place
+	const string tmpFn = oFn + ".tmp";
+
+	cout << "Writing to binary file " << oFn << endl;
+	{
+		boost::timer::auto_cpu_timer t;
+		writeFlatOSMDatabase(db,tmpFn,binEncoding);
+	}
+
+	if (rename(tmpFn.c_str(),oFn.c_str()) != 0)
+	{
+		cerr << "Failed to rename " << tmpFn << " to " << oFn << endl;
+		return 1;
+	}
+
+	if (writeStreets)
+	{
+		const string tmpStreetsFn = oStreetsFn + ".tmp";
+
+		cout << "Writing patched road network, POIs and features to " << oStreetsFn << endl;
+		{
+			boost::timer::auto_cpu_timer t;
+			StreetsDatabase sdb(G,streets);
+			sdb.pois(extractPOIs(db));
+			sdb.features(extractFeatures(db));
+			writeFlatStreetsDatabase(sdb,tmpStreetsFn);
+		}
+
+		if (rename(tmpStreetsFn.c_str(),oStreetsFn.c_str()) != 0)
+		{
+			cerr << "Failed to rename " << tmpStreetsFn << " to " << oStreetsFn << endl;
+			return 1;
+		}
+	}
+
+	db.print();
+
+	if (checkNetwork)
+	{
+		OSMWayFilterRoads hwyFilt(db,db.nodes());
+		PathNetwork R = buildNetwork(db,hwyFilt);
+		const vector<string> rStreets = assignStreets(&db,R);
+
+		const vector<string> patched = describeNetwork(G,streets), rebuilt = describeNetwork(R,rStreets);
+
+		if (patched != rebuilt)
+		{
+			vector<string> diff;
+			set_symmetric_difference(patched.begin(),patched.end(),rebuilt.begin(),rebuilt.end(),back_inserter(diff));
+			cerr << "Patched road network differs from a full rebuild in " << diff.size() << " lines, eg." << endl;
+			for(unsigned i=0;i<diff.size() && i<10;++i)
+				cerr << "  " << (binary_search(patched.begin(),patched.end(),diff[i]) ? "patched: " : "rebuilt: ") << diff[i] << endl;
+			return 1;
+		}
+
+		cout << "Patched road network matches a full rebuild: " << num_vertices(G) << " intersections, " << num_edges(G) <<
+				" edges, " << streets.size() << " streets" << endl;
+	}
+
+	return 0;
+}
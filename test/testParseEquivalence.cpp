@@ -0,0 +1,217 @@
+/*
+ * testParseEquivalence.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jcassidy
+ *
+ * Checks that every parser produces the same database: Xerces SAX2, the OSM XML tokenizer on one thread and on several,
+ * and the PBF parser. Entities are compared by their strings (tag and role indices differ between XML and PBF, whose
+ * string table order is the writer's).
+ *
+ * The tokenizer is also run on a generated document large enough to be cut into several ranges, with comments and
+ * CDATA sections full of entity start tags placed across each cut, so that every range boundary first falls inside one
+ * of them.
+ *
+ * usage: testParseEquivalence fixture.osm fixture.osm.pbf
+ *
+ * The generated document is written to the current directory. Exits with status 1 if any database differs.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+#include "XercesUtils.hpp"
+#include "LoadOSM.hpp"
+#include "OSMDatabase.hpp"
+
+using namespace std;
+
+/// Every entity of db as one line, with its tags as sorted key=value strings
+vector<string> describe(const OSMDatabase& db)
+{
+	vector<string> lines;
+
+	auto tagString = [](const KeyValueTable& t,const std::vector<std::pair<unsigned,unsigned>>& tags)
+	{
+		vector<string> kv;
+		for(const auto& p : tags)
+			kv.push_back(t.getKey(p.first).to_string() + '=' + t.getValue(p.second).to_string());
+		sort(kv.begin(),kv.end());
+
+		string s;
+		for(const auto& x : kv)
+			s += ' ' + x;
+		return s;
+	};
+
+	{
+		ostringstream os;
+		os << setprecision(9) << "bounds " << db.bounds().first.lat << ' ' << db.bounds().first.lon << ' ' <<
+				db.bounds().second.lat << ' ' << db.bounds().second.lon;
+		lines.push_back(os.str());
+	}
+
+	for(const auto n : db.nodes())
+	{
+		ostringstream os;
+		os << "node " << n.id() << ' ' << n.fixedCoords().lat << ' ' << n.fixedCoords().lon <<
+				tagString(db.nodeTags(),vector<pair<unsigned,unsigned>>(n.tags().begin(),n.tags().end()));
+		lines.push_back(os.str());
+	}
+
+	for(const auto& w : db.ways())
+	{
+		ostringstream os;
+		os << "way " << w.id() << " nds";
+		for(const auto nd : w.ndrefs())
+			os << ' ' << nd;
+		os << tagString(db.wayTags(),w.tags());
+		lines.push_back(os.str());
+	}
+
+	for(const auto& r : db.relations())
+	{
+		ostringstream os;
+		os << "relation " << r.id() << " members";
+		for(const auto& m : r.members())
+			os << ' ' << m.type << ':' << m.id << ':' << db.relationRoles().getValue(m.role);
+		os << tagString(db.relationTags(),r.tags());
+		lines.push_back(os.str());
+	}
+
+	return lines;
+}
+
+/// Prints the first differences between two descriptions; returns true if they are equal
+bool compare(const string& what,const vector<string>& ref,const vector<string>& x)
+{
+	if (ref == x)
+	{
+		cout << "PASS " << what << " (" << x.size() << " lines)" << endl;
+		return true;
+	}
+
+	cout << "FAIL " << what << ": " << ref.size() << " lines expected, " << x.size() << " found" << endl;
+
+	unsigned shown=0;
+	for(size_t i=0; i<max(ref.size(),x.size()) && shown < 10; ++i)
+		if (i >= ref.size() || i >= x.size() || ref[i] != x[i])
+		{
+			cout << "  expected: " << (i < ref.size() ? ref[i] : "(none)") << endl;
+			cout << "  found:    " << (i < x.size() ? x[i] : "(none)") << endl;
+			++shown;
+		}
+	return false;
+}
+
+/** Writes an OSM XML document of about nCuts+1 tokenizer ranges (64 kiB each, the smallest range cut), with a trap
+ * straddling each 64 kiB boundary: in turn a comment between entities, a CDATA section between entities and a comment
+ * among the <nd> of a way, each holding fake <node>, <way> and <relation> start tags.
+ */
+void writeCutFixture(const string& fn,unsigned nCuts)
+{
+	const size_t rangeSize = size_t(1) << 16;
+
+	string doc = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<osm version=\"0.6\">\n"
+			" <bounds minlat=\"43\" minlon=\"-80\" maxlat=\"44\" maxlon=\"-79\"/>\n";
+
+	auto fakes = [](unsigned n)
+	{
+		ostringstream os;
+		for(unsigned i=0;i<n;++i)
+			os << "  <node id=\"" << 900000+i << "\" lat=\"1\" lon=\"1\"/> <way id=\"" << 900000+i <<
+				"\"> <relation id=\"" << 900000+i << "\">\n";
+		return os.str();
+	};
+
+	unsigned long long id=1;
+	unsigned trap=0;
+
+	while(trap < nCuts || doc.size() < (nCuts+1)*rangeSize)
+	{
+		ostringstream os;
+
+		if (trap < nCuts && doc.size() + 1024 >= (trap+1)*rangeSize)
+		{
+			// start the trap just before the boundary and run well past it
+			switch(trap++ % 3)
+			{
+			case 0:
+				os << " <!-- commented out:\n" << fakes(60) << " -->\n";
+				break;
+			case 1:
+				os << " <![CDATA[\n" << fakes(60) << " ]]>\n";
+				break;
+			case 2:
+				os << " <way id=\"" << id << "\">\n  <nd ref=\"" << id-1 << "\"/>\n  <!--\n" << fakes(60) <<
+					"  -->\n  <nd ref=\"" << id-2 << "\"/>\n  <tag k=\"highway\" v=\"service\"/>\n </way>\n";
+				++id;
+				break;
+			}
+		}
+		else if (id % 5 == 0)
+			os << " <way id=\"" << id << "\"><nd ref=\"" << id-1 << "\"/><nd ref=\"" << id-2 << "\"/>" <<
+				"<tag k=\"highway\" v=\"residential\"/><tag k=\"name\" v=\"Street " << id << "\"/></way>\n";
+		else if (id % 7 == 0)
+			os << " <relation id=\"" << id << "\"><member type=\"node\" ref=\"" << id-1 << "\" role=\"stop\"/>" <<
+				"<member type=\"way\" ref=\"" << id-2 << "\" role=\"\"/><tag k=\"type\" v=\"route\"/></relation>\n";
+		else
+			os << " <node id=\"" << id << "\" lat=\"43." << setw(7) << setfill('0') << id*7919 % 10000000 <<
+				"\" lon=\"-79." << setw(7) << setfill('0') << id*104729 % 10000000 << "\"><tag k=\"name\" v=\"N" <<
+				id << "\"/></node>\n";
+
+		++id;
+		doc += os.str();
+	}
+
+	doc += "</osm>\n";
+
+	ofstream(fn.c_str(),ios_base::out | ios_base::binary) << doc;
+}
+
+int main(int argc,char **argv)
+{
+	if (argc != 3)
+	{
+		cerr << "usage: testParseEquivalence fixture.osm fixture.osm.pbf" << endl;
+		return 1;
+	}
+
+	const string xmlFn = argv[1], pbfFn = argv[2];
+
+	// init/terminate the xerces XMLPlatform using RAII
+	XMLPlatform plat;
+
+	// store every tag so all of them are compared
+	const OSMTagFilterProfile keepAll = OSMTagFilterProfile();
+
+	auto load = [&keepAll](const string& fn,OSMXMLParser parser,unsigned nThreads)
+	{
+		return describe(loadOSM(fn,parser,keepAll,AllNodes,OSMClipRegion(),nThreads));
+	};
+
+	bool ok=true;
+
+	const vector<string> ref = load(xmlFn,XercesSAX2,1);
+
+	ok &= compare("tokenizer, 1 thread",ref,load(xmlFn,OSMTokenizer,1));
+	ok &= compare("tokenizer, 4 threads",ref,load(xmlFn,OSMTokenizer,4));
+	ok &= compare("PBF",ref,load(pbfFn,XercesSAX2,1));
+
+	const string cutFn = "testParseEquivalence.cuts.osm";
+	writeCutFixture(cutFn,6);
+
+	const vector<string> cutRef = load(cutFn,XercesSAX2,1);
+
+	ok &= compare("cuts: tokenizer, 1 thread",cutRef,load(cutFn,OSMTokenizer,1));
+	ok &= compare("cuts: tokenizer, 2 threads",cutRef,load(cutFn,OSMTokenizer,2));
+	ok &= compare("cuts: tokenizer, 4 threads",cutRef,load(cutFn,OSMTokenizer,4));
+
+	return ok ? 0 : 1;
+}